@@ -0,0 +1,171 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cerrno>
+#include <atomic>
+#include <new>
+
+/* for My modules */
+#include "alloc_counter.h"
+
+#ifdef COMMON_HELPER_COUNT_ALLOC
+static std::atomic<int64_t> s_count(0);
+static std::atomic<int64_t> s_size(0);
+
+static inline void CountAlloc(size_t size)
+{
+    s_count.fetch_add(1, std::memory_order_relaxed);
+    s_size.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+}
+
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t num, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void  __libc_free(void* p);
+
+void* malloc(size_t size)
+{
+    CountAlloc(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t num, size_t size)
+{
+    CountAlloc(num * size);
+    return __libc_calloc(num, size);
+}
+
+void* realloc(void* p, size_t size)
+{
+    CountAlloc(size);
+    return __libc_realloc(p, size);
+}
+
+int posix_memalign(void** p, size_t alignment, size_t size)
+{
+    CountAlloc(size);
+    *p = __libc_memalign(alignment, size);
+    return (*p) ? 0 : ENOMEM;
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    CountAlloc(size);
+    return __libc_memalign(alignment, size);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    CountAlloc(size);
+    return __libc_memalign(alignment, size);
+}
+
+void free(void* p)
+{
+    __libc_free(p);
+}
+}
+#else
+void* operator new(size_t size)
+{
+    CountAlloc(size);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    CountAlloc(size);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& nothrow) noexcept
+{
+    return operator new(size, nothrow);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    std::free(p);
+}
+#endif
+
+bool AllocCounter::IsAvailable()
+{
+    return true;
+}
+
+void AllocCounter::Reset()
+{
+    s_count = 0;
+    s_size = 0;
+}
+
+int64_t AllocCounter::GetCount()
+{
+    return s_count;
+}
+
+int64_t AllocCounter::GetSize()
+{
+    return s_size;
+}
+
+#else
+bool AllocCounter::IsAvailable()
+{
+    return false;
+}
+
+void AllocCounter::Reset()
+{
+}
+
+int64_t AllocCounter::GetCount()
+{
+    return 0;
+}
+
+int64_t AllocCounter::GetSize()
+{
+    return 0;
+}
+#endif
@@ -0,0 +1,32 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef ALLOC_COUNTER_
+#define ALLOC_COUNTER_
+
+#include <cstdint>
+
+/* Count heap allocations of the whole process to check that there is no allocation in steady state */
+/* The hook is built only when COMMON_HELPER_COUNT_ALLOC is on (cmake option). Otherwise, the count is always 0 */
+/*   glibc: malloc/calloc/realloc/posix_memalign/aligned_alloc are interposed (also covers new and OpenCV) */
+/*   others: operator new is replaced */
+namespace AllocCounter
+{
+    bool IsAvailable();
+    void Reset();
+    int64_t GetCount();     /* number of allocations since Reset */
+    int64_t GetSize();      /* [byte] total size of allocations since Reset */
+}
+
+#endif
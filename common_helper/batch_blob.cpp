@@ -0,0 +1,112 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+/* for My modules */
+#include "common_helper.h"
+#include "common_helper_cv.h"
+#include "host_tensor.h"
+#include "batch_blob.h"
+
+/*** Function ***/
+BatchBlob::BatchBlob()
+    : width_(0), height_(0), host_tensor_type_(CommonHelper::kHostTensorTypeFp32), mean_{ 0, 0, 0 }, norm_{ 1, 1, 1 }, is_rgb_(true), item_size_(0)
+{
+}
+
+void BatchBlob::Create(int32_t batch_size, int32_t width, int32_t height, int32_t host_tensor_type, const float mean[3], const float norm[3], bool is_rgb)
+{
+    batch_size = (std::max)(batch_size, 1);
+    width_ = width;
+    height_ = height;
+    host_tensor_type_ = host_tensor_type;
+    for (int32_t c = 0; c < 3; c++) {
+        mean_[c] = mean[c];
+        norm_[c] = norm[c];
+    }
+    is_rgb_ = is_rgb;
+    item_size_ = 3 * width * height * CommonHelper::GetHostTensorElementSize(host_tensor_type);
+    blob_.resize(batch_size * item_size_);
+    plan_list_.resize(batch_size);
+    crop_list_.resize(batch_size);
+    image_crop_list_.resize(batch_size);
+    tile_list_.reserve(batch_size);
+}
+
+void BatchBlob::SetQuantization(float scale, int32_t zero_point)
+{
+    for (auto& plan : plan_list_) plan.SetQuantization(scale, zero_point);
+}
+
+int32_t BatchBlob::Write(int32_t index, const cv::Mat& mat, const cv::Rect& crop)
+{
+    cv::Rect& crop_item = crop_list_[index];
+    crop_item = crop;
+    if (!CommonHelper::CropResizeNormalizeNchw(mat, GetItem(index), host_tensor_type_, plan_list_[index], width_, height_,
+        crop_item.x, crop_item.y, crop_item.width, crop_item.height, mean_, norm_, is_rgb_, CommonHelper::kCropTypeExpand)) {
+        return kRetErr;
+    }
+    image_crop_list_[index] = crop_item & cv::Rect(0, 0, mat.cols, mat.rows);
+    return kRetOk;
+}
+
+int32_t BatchBlob::WriteImageList(const cv::Mat* mat_list, int32_t num)
+{
+    /* Items are processed in parallel when there are enough items for the threads (rows of each item are processed by one thread) */
+    /* Otherwise, items are processed one by one and rows of each item are processed in parallel */
+    int32_t error_num = 0;
+    const int32_t thread_num = CommonHelper::GetParallelThreadNum();
+    if (thread_num > 1 && num >= thread_num) {
+#pragma omp parallel for schedule(dynamic) reduction(+:error_num)
+        for (int32_t i = 0; i < num; i++) {
+            if (Write(i, mat_list[i], cv::Rect(0, 0, mat_list[i].cols, mat_list[i].rows)) != kRetOk) error_num++;
+        }
+    } else {
+        for (int32_t i = 0; i < num; i++) {
+            if (Write(i, mat_list[i], cv::Rect(0, 0, mat_list[i].cols, mat_list[i].rows)) != kRetOk) error_num++;
+        }
+    }
+    return (error_num == 0) ? kRetOk : kRetErr;
+}
+
+int32_t BatchBlob::WriteTileList(const cv::Mat& mat, int32_t tile_num_x, int32_t tile_num_y, float overlap_ratio)
+{
+    CommonHelper::CreateTileList(mat.cols, mat.rows, tile_num_x, tile_num_y, overlap_ratio, tile_list_);
+    const int32_t num = static_cast<int32_t>(tile_list_.size());
+    if (num > GetBatchSize()) return kRetErr;
+    /* Keep aspect ratio of each tile. crop area is updated to the area of the original image corresponding to the model input */
+    /* Tiles are processed in parallel in the same way as WriteImageList */
+    int32_t error_num = 0;
+    const int32_t thread_num = CommonHelper::GetParallelThreadNum();
+    if (thread_num > 1 && num >= thread_num) {
+#pragma omp parallel for reduction(+:error_num)
+        for (int32_t i = 0; i < num; i++) {
+            if (Write(i, mat, tile_list_[i]) != kRetOk) error_num++;
+        }
+    } else {
+        for (int32_t i = 0; i < num; i++) {
+            if (Write(i, mat, tile_list_[i]) != kRetOk) error_num++;
+        }
+    }
+    return (error_num == 0) ? kRetOk : kRetErr;
+}
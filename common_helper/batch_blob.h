@@ -0,0 +1,80 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef BATCH_BLOB_
+#define BATCH_BLOB_
+
+/* for general */
+#include <cstdint>
+#include <vector>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+/* for My modules */
+#include "image_preprocess.h"
+
+/* NCHW blob of batch_size model inputs for batch mode (an image for each item) and tiled mode (a tile of an image for each item) */
+/* Each item is written by its own ResizePlan (kCropTypeExpand), so the tables are re-created only when the geometry of the item changes */
+/* The padding of each item is written only when its plan changes. So, the blob must not be written by others */
+/* The crop area of each item is kept to convert the coordinate in the model input to the original image: x_org = x * GetScaleX + crop.x */
+class BatchBlob {
+public:
+    enum {
+        kRetOk = 0,
+        kRetErr = -1,
+    };
+
+public:
+    BatchBlob();
+    ~BatchBlob() {}
+    /* width x height x 3 for each item in host_tensor_type (kHostTensorType*). mean and norm are in the order of the model input */
+    void Create(int32_t batch_size, int32_t width, int32_t height, int32_t host_tensor_type, const float mean[3], const float norm[3], bool is_rgb);
+    /* Quantization of uint8 blob (see ResizePlan::SetQuantization) */
+    void SetQuantization(float scale, int32_t zero_point);
+
+    /* Write the crop area of mat to the item. Return kRetErr if mat is not 3-channel uint8 */
+    int32_t Write(int32_t index, const cv::Mat& mat, const cv::Rect& crop);
+    /* Write the whole image of each mat to the items from 0 (num <= batch size). Items are processed in parallel if num >= the number of threads */
+    int32_t WriteImageList(const cv::Mat* mat_list, int32_t num);
+    /* Write tile_num_x * tile_num_y overlapping tiles of mat to the items from 0 (see CreateTileList. the number of tiles <= batch size) */
+    int32_t WriteTileList(const cv::Mat& mat, int32_t tile_num_x, int32_t tile_num_y, float overlap_ratio);
+
+    void* GetData() { return blob_.data(); }
+    uint8_t* GetItem(int32_t index) { return blob_.data() + index * item_size_; }
+    int32_t GetBatchSize() const { return static_cast<int32_t>(plan_list_.size()); }
+    int32_t GetItemSize() const { return item_size_; }  /* [byte] */
+    /* Area of the original image which corresponds to the whole item (including padding) */
+    const cv::Rect& GetCrop(int32_t index) const { return crop_list_[index]; }
+    /* Area of the original image which is written in the item (GetCrop without padding) */
+    const cv::Rect& GetImageCrop(int32_t index) const { return image_crop_list_[index]; }
+    float GetScaleX(int32_t index) const { return static_cast<float>(crop_list_[index].width) / width_; }
+    float GetScaleY(int32_t index) const { return static_cast<float>(crop_list_[index].height) / height_; }
+
+private:
+    int32_t width_;
+    int32_t height_;
+    int32_t host_tensor_type_;
+    float mean_[3];
+    float norm_[3];
+    bool is_rgb_;
+    int32_t item_size_;
+    std::vector<uint8_t> blob_;
+    std::vector<CommonHelper::ResizePlan> plan_list_;
+    std::vector<cv::Rect> crop_list_;
+    std::vector<cv::Rect> image_crop_list_;
+    std::vector<cv::Rect> tile_list_;       /* work buffer for WriteTileList */
+};
+
+#endif
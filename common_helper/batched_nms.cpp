@@ -0,0 +1,179 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/* for general */
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+/* for My modules */
+#include "bounding_box.h"
+#include "box_batch.h"
+#include "batched_nms.h"
+
+
+BatchedNms::BatchedNms()
+    : threshold_nms_iou_(0.5f), num_max_pre_nms_(0), num_max_detection_(0), check_class_id_(false)
+{
+}
+
+BatchedNms::~BatchedNms()
+{
+}
+
+void BatchedNms::SetParam(float threshold_nms_iou, int32_t num_max_pre_nms, int32_t num_max_detection, bool check_class_id)
+{
+    threshold_nms_iou_ = threshold_nms_iou;
+    num_max_pre_nms_ = num_max_pre_nms;
+    num_max_detection_ = num_max_detection;
+    check_class_id_ = check_class_id;
+}
+
+void BatchedNms::Reserve(int32_t num_max_input)
+{
+    order_.reserve(num_max_input);
+    is_suppressed_.reserve(num_max_input);
+    iou_list_.reserve(num_max_input);
+    index_list_nms_.reserve(num_max_input);
+    box_batch_input_.Reserve(num_max_input);
+    box_batch_sorted_.Reserve(num_max_input);
+}
+
+int32_t BatchedNms::SortAndGather(const BoxBatch& batch)
+{
+    const int32_t num_input = batch.Size();
+
+    /*** Sort indices by score (ties are broken by index to make the result stable) ***/
+    order_.resize(num_input);
+    for (int32_t i = 0; i < num_input; i++) order_[i] = i;
+    const float* score = batch.score;
+    auto compare = [score](int32_t lhs, int32_t rhs) {
+        if (score[lhs] != score[rhs]) return score[lhs] > score[rhs];
+        return lhs < rhs;
+    };
+    const int32_t num = (num_max_pre_nms_ > 0) ? (std::min)(num_max_pre_nms_, num_input) : num_input;
+    if (num < num_input) {
+        std::partial_sort(order_.begin(), order_.begin() + num, order_.end(), compare);
+    } else {
+        std::sort(order_.begin(), order_.end(), compare);
+    }
+
+    /*** Gather boxes in sorted order. Shift boxes of each class not to overlap with other classes ***/
+    float offset = 0;
+    if (check_class_id_) {
+        float coord_min = 0;
+        float coord_max = 0;
+        for (int32_t i = 0; i < num; i++) {
+            const int32_t index = order_[i];
+            coord_min = (std::min)({ coord_min, batch.x0[index], batch.y0[index] });
+            coord_max = (std::max)({ coord_max, batch.x1[index], batch.y1[index] });
+        }
+        offset = coord_max - coord_min + 1;
+    }
+    box_batch_sorted_.Clear();
+    box_batch_sorted_.Reserve(num);
+    for (int32_t i = 0; i < num; i++) {
+        const int32_t index = order_[i];
+        const float shift = offset * batch.class_id[index];
+        box_batch_sorted_.Push(batch.x0[index] + shift, batch.y0[index] + shift, batch.x1[index] + shift, batch.y1[index] + shift, batch.score[index], batch.class_id[index]);
+    }
+
+    return num;
+}
+
+int32_t BatchedNms::Run(const BoxBatch& batch, int32_t* index_list_nms, int32_t index_list_nms_size)
+{
+    const int32_t num_input = batch.Size();
+    if (num_input == 0 || index_list_nms_size <= 0) return 0;
+
+    const int32_t num = SortAndGather(batch);
+
+    /*** Greedy suppression ***/
+    const int32_t num_max_output = (num_max_detection_ > 0) ? (std::min)(num_max_detection_, index_list_nms_size) : index_list_nms_size;
+    is_suppressed_.assign(num, 0);
+    iou_list_.resize(num);
+    int32_t num_output = 0;
+    for (int32_t i = 0; i < num && num_output < num_max_output; i++) {
+        if (is_suppressed_[i]) continue;
+        index_list_nms[num_output++] = order_[i];
+        if (num_output >= num_max_output) break;
+        BoundingBoxUtils::CalculateIoU(box_batch_sorted_, i, box_batch_sorted_, i + 1, num, iou_list_.data());
+        for (int32_t j = i + 1; j < num; j++) {
+            if (iou_list_[j - i - 1] > threshold_nms_iou_) is_suppressed_[j] = 1;
+        }
+    }
+
+    return num_output;
+}
+
+void BatchedNms::Run(const std::vector<BoundingBox>& bbox_list, std::vector<BoundingBox>& bbox_nms_list)
+{
+    box_batch_input_.Set(bbox_list);
+    index_list_nms_.resize(bbox_list.size());
+    const int32_t num_output = Run(box_batch_input_, index_list_nms_.data(), static_cast<int32_t>(index_list_nms_.size()));
+    bbox_nms_list.clear();
+    for (int32_t i = 0; i < num_output; i++) {
+        bbox_nms_list.push_back(bbox_list[index_list_nms_[i]]);
+    }
+}
+
+void BatchedNms::RunTiled(const std::vector<BoundingBox>& bbox_list, const std::vector<int32_t>& tile_id_list, float threshold_merge_ios, std::vector<BoundingBox>& bbox_nms_list)
+{
+    bbox_nms_list.clear();
+    if (bbox_list.empty()) return;
+
+    box_batch_input_.Set(bbox_list);
+    const int32_t num = SortAndGather(box_batch_input_);
+
+    const int32_t num_max_output = (num_max_detection_ > 0) ? num_max_detection_ : num;
+    is_suppressed_.assign(num, 0);
+    iou_list_.resize(num);
+    for (int32_t i = 0; i < num && static_cast<int32_t>(bbox_nms_list.size()) < num_max_output; i++) {
+        if (is_suppressed_[i]) continue;
+        const int32_t index = order_[i];
+        int32_t x0 = bbox_list[index].x;
+        int32_t y0 = bbox_list[index].y;
+        int32_t x1 = bbox_list[index].x + bbox_list[index].w;
+        int32_t y1 = bbox_list[index].y + bbox_list[index].h;
+        BoundingBoxUtils::CalculateIoU(box_batch_sorted_, i, box_batch_sorted_, i + 1, num, iou_list_.data());
+        for (int32_t j = i + 1; j < num; j++) {
+            if (is_suppressed_[j]) continue;
+            const float iou = iou_list_[j - i - 1];
+            if (iou > threshold_nms_iou_) {
+                is_suppressed_[j] = 1;
+                continue;
+            }
+            const int32_t index_j = order_[j];
+            if (iou <= 0 || tile_id_list[index_j] == tile_id_list[index] || bbox_list[index_j].class_id != bbox_list[index].class_id) continue;
+            /* intersection = iou * (area0 + area1) / (1 + iou) */
+            const float area0 = box_batch_sorted_.area[i];
+            const float area1 = box_batch_sorted_.area[j];
+            const float ios = iou * (area0 + area1) / (1 + iou) / (std::min)(area0, area1);
+            if (ios > threshold_merge_ios) {
+                is_suppressed_[j] = 1;
+                x0 = (std::min)(x0, bbox_list[index_j].x);
+                y0 = (std::min)(y0, bbox_list[index_j].y);
+                x1 = (std::max)(x1, bbox_list[index_j].x + bbox_list[index_j].w);
+                y1 = (std::max)(y1, bbox_list[index_j].y + bbox_list[index_j].h);
+            }
+        }
+        BoundingBox bbox = bbox_list[index];
+        bbox.x = x0;
+        bbox.y = y0;
+        bbox.w = x1 - x0;
+        bbox.h = y1 - y0;
+        bbox_nms_list.push_back(bbox);
+    }
+}
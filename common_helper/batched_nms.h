@@ -0,0 +1,62 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef BATCHED_NMS_
+#define BATCHED_NMS_
+
+#include <cstdint>
+#include <vector>
+
+#include "bounding_box.h"
+#include "box_batch.h"
+
+/* Greedy NMS which sorts indices instead of boxes and reuses work buffers (no allocation once buffers are large enough) */
+/* Class-aware suppression is done in one pass by shifting coordinates of each class so that boxes of different classes never overlap */
+class BatchedNms {
+public:
+    BatchedNms();
+    ~BatchedNms();
+
+    /* num_max_pre_nms: use only the top N boxes as input. num_max_detection: stop when N boxes are kept. (<= 0: no limit) */
+    void SetParam(float threshold_nms_iou, int32_t num_max_pre_nms = 0, int32_t num_max_detection = 0, bool check_class_id = false);
+    void Reserve(int32_t num_max_input);
+
+    /* Write indices (in batch) of kept boxes in descending order of score. Return the number of kept boxes */
+    int32_t Run(const BoxBatch& batch, int32_t* index_list_nms, int32_t index_list_nms_size);
+    void Run(const std::vector<BoundingBox>& bbox_list, std::vector<BoundingBox>& bbox_nms_list);
+
+    /* Tile-aware NMS for boxes detected in overlapping tiles (tile_id_list[i] is the tile of bbox_list[i]) */
+    /* An object cut at a tile border is detected as a partial box, whose IoU with the whole box is small. So, in addition to the usual suppression, */
+    /* a box from another tile with the same class is merged into the kept box (union) if intersection over the smaller area > threshold_merge_ios */
+    void RunTiled(const std::vector<BoundingBox>& bbox_list, const std::vector<int32_t>& tile_id_list, float threshold_merge_ios, std::vector<BoundingBox>& bbox_nms_list);
+
+private:
+    int32_t SortAndGather(const BoxBatch& batch);
+
+private:
+    float   threshold_nms_iou_;
+    int32_t num_max_pre_nms_;
+    int32_t num_max_detection_;
+    bool    check_class_id_;
+
+    /* work buffer */
+    std::vector<int32_t> order_;
+    std::vector<uint8_t> is_suppressed_;
+    std::vector<float>   iou_list_;
+    std::vector<int32_t> index_list_nms_;
+    BoxBatch box_batch_input_;
+    BoxBatch box_batch_sorted_;
+};
+
+#endif
@@ -0,0 +1,192 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <random>
+
+/* for My modules */
+#include "bounding_box.h"
+#include "batched_nms.h"
+#include "matrix_nms.h"
+#include "tracker.h"
+#include "tracker_manager.h"
+#include "image_preprocess.h"
+#include "host_tensor.h"
+#include "alloc_counter.h"
+
+/* Check that the per-frame host work of the detection apps doesn't allocate heap memory in steady state */
+/* (pre-process into the blob, read of the output tensor, NMS, Matrix NMS, tracker update of each stream and extrapolation for display) */
+/* The scene is periodic, so every size of the work buffers has been seen in the warmup. Return non-zero if any allocation happens after that */
+/* Build with COMMON_HELPER_COUNT_ALLOC=on */
+
+/*** Macro ***/
+#define IMAGE_WIDTH         1280
+#define IMAGE_HEIGHT        720
+#define INPUT_WIDTH         640
+#define INPUT_HEIGHT        640
+#define NUM_CLASS           80
+#define STREAM_NUM          2
+#define OBJECT_NUM          100
+#define BOX_NUM_PER_OBJECT  3
+#define HIDE_PERIOD         40      /* [frame] each object is hidden for HIDE_PERIOD frames in every HIDE_PERIOD * HIDE_CYCLE frames (tracks are deleted and created) */
+#define HIDE_CYCLE          5
+#define THRESHOLD_NMS_IOU   0.5f
+#define THRESHOLD_MERGE_IOS 0.8f
+#define THRESHOLD_SCORE     0.3f    /* for Matrix NMS */
+
+/*** Type ***/
+typedef struct {
+    const char* name;
+    int64_t count;
+    int64_t size;
+} StageAlloc;
+
+/*** Function ***/
+/* Detector output before NMS. Objects bounce in the image, so the scene is the same every 2 * IMAGE_WIDTH frames at most */
+static void CreateCandidateList(int32_t stream, int32_t frame, std::mt19937& engine, std::vector<BoundingBox>& bbox_list, std::vector<int32_t>& tile_id_list)
+{
+    std::uniform_int_distribution<int32_t> dist_jitter(-2, 2);
+    std::uniform_real_distribution<float> dist_score(0.3f, 1.0f);
+    bbox_list.clear();
+    tile_id_list.clear();
+    for (int32_t i = 0; i < OBJECT_NUM; i++) {
+        if (((frame / HIDE_PERIOD) + i) % HIDE_CYCLE == 0) continue;
+        const int32_t w = 32 + (i * 7) % 64;
+        const int32_t h = 32 + (i * 13) % 64;
+        const int32_t range_x = IMAGE_WIDTH - w;
+        const int32_t range_y = IMAGE_HEIGHT - h;
+        int32_t x = (i * 97 + stream * 31 + frame * (1 + i % 3)) % (2 * range_x);
+        int32_t y = (i * 61 + stream * 17 + frame * (1 + i % 2)) % (2 * range_y);
+        if (x > range_x) x = 2 * range_x - x;
+        if (y > range_y) y = 2 * range_y - y;
+        for (int32_t k = 0; k < BOX_NUM_PER_OBJECT; k++) {
+            BoundingBox bbox(i % NUM_CLASS, dist_score(engine), x + dist_jitter(engine), y + dist_jitter(engine), w + dist_jitter(engine), h + dist_jitter(engine));
+            bbox_list.push_back(bbox);
+            tile_id_list.push_back((bbox.x + bbox.w / 2 < IMAGE_WIDTH / 2) ? 0 : 1);
+        }
+    }
+}
+
+static void Measure(StageAlloc& stage, bool is_measured)
+{
+    if (is_measured) {
+        stage.count += AllocCounter::GetCount();
+        stage.size += AllocCounter::GetSize();
+    }
+    AllocCounter::Reset();
+}
+
+int32_t main(int argc, char* argv[])
+{
+    const int32_t warmup_frame_num = (argc > 1) ? std::atoi(argv[1]) : 2 * HIDE_PERIOD * HIDE_CYCLE;
+    const int32_t frame_num = (argc > 2) ? std::atoi(argv[2]) : 2 * HIDE_PERIOD * HIDE_CYCLE;
+    if (!AllocCounter::IsAvailable()) {
+        printf("Allocation counter is not available. Build with COMMON_HELPER_COUNT_ALLOC=on\n");
+        return -1;
+    }
+
+    /* Work buffers which the apps keep (allocated here, not counted) */
+    std::mt19937 engine(1234);
+    std::vector<uint8_t> image(IMAGE_WIDTH * IMAGE_HEIGHT * 3);
+    for (auto& value : image) value = static_cast<uint8_t>(engine() & 0xFF);
+    const int32_t element_num = 3 * INPUT_WIDTH * INPUT_HEIGHT;
+    const int32_t type_list[] = { CommonHelper::kHostTensorTypeFp32, CommonHelper::kHostTensorTypeFp16, CommonHelper::kHostTensorTypeUint8 };
+    std::vector<uint8_t> blob(element_num * sizeof(float));
+    const float mean[3] = { 0.485f, 0.456f, 0.406f };
+    const float norm[3] = { 0.229f, 0.224f, 0.225f };
+    CommonHelper::ResizePlan plan;
+    float work[INPUT_WIDTH];
+    BatchedNms nms;
+    nms.SetParam(THRESHOLD_NMS_IOU, 1000, 100, false);
+    MatrixNms matrix_nms;
+    matrix_nms.SetParam(THRESHOLD_SCORE, MatrixNms::kKernelGaussian, 2.0f, false, 1000, 100);
+    matrix_nms.Reserve(OBJECT_NUM * BOX_NUM_PER_OBJECT);
+    std::vector<BoundingBox> matrix_nms_list;
+    TrackerManager tracker_manager;
+    std::vector<std::vector<BoundingBox>> candidate_list(STREAM_NUM);
+    std::vector<std::vector<int32_t>> tile_id_list(STREAM_NUM);
+    std::vector<std::vector<BoundingBox>> det_list(STREAM_NUM);
+    std::vector<TrackerManager::StreamUpdate> update_list(STREAM_NUM);
+    std::vector<BoundingBox> render_bbox_list;
+    std::vector<const Track*> render_track_list;
+
+    StageAlloc stage_list[] = { { "pre_process", 0, 0 }, { "output_read", 0, 0 }, { "nms", 0, 0 }, { "matrix_nms", 0, 0 }, { "tracker_update", 0, 0 }, { "extrapolate", 0, 0 } };
+    for (int32_t frame = 0; frame < warmup_frame_num + frame_num; frame++) {
+        const bool is_measured = frame >= warmup_frame_num;
+        for (int32_t stream = 0; stream < STREAM_NUM; stream++) {
+            CreateCandidateList(stream, frame, engine, candidate_list[stream], tile_id_list[stream]);
+        }
+        AllocCounter::Reset();
+
+        /* Input tensor of each type (the plan is created at the first frame) */
+        const int32_t type = type_list[frame % 3];
+        if (!plan.IsSame(INPUT_WIDTH, INPUT_HEIGHT, 0, 0, IMAGE_WIDTH, IMAGE_HEIGHT, CommonHelper::kCropTypeExpand, mean, norm, true)) {
+            plan.Create(INPUT_WIDTH, INPUT_HEIGHT, 0, 0, IMAGE_WIDTH, IMAGE_HEIGHT, CommonHelper::kCropTypeExpand, mean, norm, true);
+        }
+        plan.Apply(image.data(), IMAGE_WIDTH * 3, blob.data(), type);
+        Measure(stage_list[0], is_measured);
+
+        /* Output tensor (the blob is used as the output) */
+        const CommonHelper::HostTensorView view(blob.data(), type, 1.0f / 255, 0);
+        float max_value;
+        view.ArgMax(0, element_num, max_value);
+        view.Read(0, INPUT_WIDTH, work);
+        Measure(stage_list[1], is_measured);
+
+        for (int32_t stream = 0; stream < STREAM_NUM; stream++) {
+            if (stream == 0) {
+                nms.Run(candidate_list[stream], det_list[stream]);
+            } else {
+                nms.RunTiled(candidate_list[stream], tile_id_list[stream], THRESHOLD_MERGE_IOS, det_list[stream]);
+            }
+            update_list[stream].stream_id = stream;
+            update_list[stream].det_list = &det_list[stream];
+            update_list[stream].timestamp = frame / 30.0;
+        }
+        Measure(stage_list[2], is_measured);
+
+        for (int32_t stream = 0; stream < STREAM_NUM; stream++) {
+            matrix_nms.Run(candidate_list[stream], matrix_nms_list);
+        }
+        Measure(stage_list[3], is_measured);
+
+        tracker_manager.Update(update_list);
+        Measure(stage_list[4], is_measured);
+
+        for (int32_t stream = 0; stream < STREAM_NUM; stream++) {
+            tracker_manager.GetOrCreateTracker(stream).GetExtrapolatedBoundingBoxList(frame / 30.0 + 0.01, render_bbox_list, render_track_list);
+        }
+        Measure(stage_list[5], is_measured);
+    }
+
+    printf("=== Heap allocation in %d frames after %d frames warmup ===\n", frame_num, warmup_frame_num);
+    int64_t count_total = 0;
+    for (const auto& stage : stage_list) {
+        printf("  %-16s %6lld [times] %9lld [byte]\n", stage.name, static_cast<long long>(stage.count), static_cast<long long>(stage.size));
+        count_total += stage.count;
+    }
+    if (count_total > 0) {
+        printf("NG: heap memory is allocated in steady state\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,113 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <functional>
+
+/* for My modules */
+#include "image_preprocess.h"
+#include "host_tensor.h"
+
+/*** Macro ***/
+#define IMAGE_WIDTH     1920
+#define IMAGE_HEIGHT    1080
+#define INPUT_WIDTH     1920    /* e.g. Robust Video Matting 1088x1920 */
+#define INPUT_HEIGHT    1088
+
+/*** Function ***/
+static double Measure(int32_t loop_num, std::function<void(void)> func)
+{
+    double time_total = 0;
+    for (int32_t i = 0; i < loop_num; i++) {
+        const auto& t0 = std::chrono::steady_clock::now();
+        func();
+        const auto& t1 = std::chrono::steady_clock::now();
+        time_total += (t1 - t0).count() / 1000000.0;
+    }
+    return time_total / loop_num;
+}
+
+static const char* GetTypeName(int32_t type)
+{
+    switch (type) {
+    case CommonHelper::kHostTensorTypeFp16:  return "fp16";
+    case CommonHelper::kHostTensorTypeUint8: return "uint8";
+    default:                                 return "fp32";
+    }
+}
+
+int32_t main(int argc, char* argv[])
+{
+    const int32_t loop_num = (argc > 1) ? std::atoi(argv[1]) : 10;
+    const int32_t type_list[] = { CommonHelper::kHostTensorTypeFp32, CommonHelper::kHostTensorTypeFp16, CommonHelper::kHostTensorTypeUint8 };
+    const int32_t element_num = 3 * INPUT_WIDTH * INPUT_HEIGHT;
+
+    std::mt19937 engine(1234);
+    std::vector<uint8_t> image(IMAGE_WIDTH * IMAGE_HEIGHT * 3);
+    for (auto& value : image) value = static_cast<uint8_t>(engine() & 0xFF);
+
+    /* Input: crop, resize and normalize into the blob of each type. Value range is 0.0 - 1.0 (the same as pixel value for uint8) */
+    printf("=== Input: %dx%d -> blob %dx%dx3 ===\n", IMAGE_WIDTH, IMAGE_HEIGHT, INPUT_WIDTH, INPUT_HEIGHT);
+    const float mean[3] = { 0.0f, 0.0f, 0.0f };
+    const float norm[3] = { 1.0f, 1.0f, 1.0f };
+    CommonHelper::ResizePlan plan;
+    plan.Create(INPUT_WIDTH, INPUT_HEIGHT, 0, 0, IMAGE_WIDTH, IMAGE_HEIGHT, CommonHelper::kCropTypeStretch, mean, norm, true);
+    std::vector<float> blob_fp32(element_num);
+    plan.Apply(image.data(), IMAGE_WIDTH * 3, blob_fp32.data());
+    for (const auto& type : type_list) {
+        std::vector<uint8_t> blob(element_num * CommonHelper::GetHostTensorElementSize(type));
+        const double time = Measure(loop_num, [&]() { plan.Apply(image.data(), IMAGE_WIDTH * 3, blob.data(), type); });
+        /* error against fp32 blob */
+        const CommonHelper::HostTensorView view(blob.data(), type, 1.0f / 255.0f, 0);
+        float error_max = 0;
+        for (int32_t i = 0; i < element_num; i++) {
+            error_max = (std::max)(error_max, std::fabs(view.Get(i) - blob_fp32[i]));
+        }
+        printf("  %-6s %9.3lf [msec] (%6.2f MB, error max = %.6f)\n", GetTypeName(type), time, blob.size() / 1024.0 / 1024.0, error_max);
+    }
+
+    /* Output: read the tensor as float (e.g. copy to cv::Mat). Value range of the tensor is 0.0 - 1.0 */
+    printf("=== Output: tensor %dx%dx3 -> float ===\n", INPUT_WIDTH, INPUT_HEIGHT);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    std::vector<float> output_fp32(element_num);
+    for (auto& value : output_fp32) value = dist(engine);
+    const float quant_scale = 1.0f / 255.0f;
+    const int32_t quant_zero_point = 0;
+    std::vector<float> output_read(element_num);
+    for (const auto& type : type_list) {
+        std::vector<uint8_t> tensor(element_num * CommonHelper::GetHostTensorElementSize(type));
+        CommonHelper::ConvertFloatToHostTensor(output_fp32.data(), tensor.data(), element_num, type, quant_scale, quant_zero_point);
+        const CommonHelper::HostTensorView view(tensor.data(), type, quant_scale, quant_zero_point);
+        const double time = Measure(loop_num, [&]() {
+            const float* src = view.Read(0, element_num, output_read.data());
+            if (src != output_read.data()) std::copy(src, src + element_num, output_read.data());
+        });
+        float error_max = 0;
+        for (int32_t i = 0; i < element_num; i++) {
+            error_max = (std::max)(error_max, std::fabs(output_read[i] - output_fp32[i]));
+        }
+        printf("  %-6s %9.3lf [msec] (%6.2f MB, error max = %.6f)\n", GetTypeName(type), time, tensor.size() / 1024.0 / 1024.0, error_max);
+    }
+
+    return 0;
+}
@@ -0,0 +1,270 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <random>
+
+/* for My modules */
+#include "image_preprocess.h"
+#include "host_tensor.h"
+
+/* Check that the conversions of num elements (SIMD path of this build: F16C, SSE2, NEON or scalar) give */
+/* bit-exact results of the scalar conversion of each element, including subnormal, inf, NaN (payload) and rounding ties */
+/* Build with each X64_SIMD / ARM setting to check each path. Return non-zero if there is any mismatch */
+
+/*** Macro ***/
+#define MISMATCH_PRINT_NUM  5
+#define RANDOM_NUM          (1 << 20)
+
+/*** Function ***/
+static uint32_t FloatToBits(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float BitsToFloat(uint32_t bits)
+{
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static int32_t Report(const char* name, int32_t mismatch_num, int32_t total_num)
+{
+    printf("  %-24s %s (%d / %d mismatch)\n", name, mismatch_num == 0 ? "OK" : "NG", mismatch_num, total_num);
+    return mismatch_num;
+}
+
+/* Every half value. Converted at an odd offset so that the vector loop and the tail are both used */
+static int32_t CheckHalfToFloat()
+{
+    std::vector<uint16_t> src(65536 + 3);
+    for (int32_t i = 0; i < 65536; i++) src[3 + i] = static_cast<uint16_t>(i);
+    std::vector<float> dst(src.size());
+    CommonHelper::ConvertHalfToFloat(src.data() + 3, dst.data() + 3, 65536);
+    int32_t mismatch_num = 0;
+    for (int32_t i = 0; i < 65536; i++) {
+        const uint32_t expected = FloatToBits(CommonHelper::ConvertHalfToFloat(static_cast<uint16_t>(i)));
+        const uint32_t actual = FloatToBits(dst[3 + i]);
+        if (actual != expected && mismatch_num++ < MISMATCH_PRINT_NUM) printf("    half %04X: %08X (expected %08X)\n", i, actual, expected);
+    }
+    return Report("half -> float", mismatch_num, 65536);
+}
+
+static int32_t CheckFloatToHalf()
+{
+    std::vector<float> src;
+    /* values of every half, midpoints between adjacent halves (ties) and their neighbors */
+    for (uint32_t h = 0; h < 65536; h++) {
+        const uint32_t bits = FloatToBits(CommonHelper::ConvertHalfToFloat(static_cast<uint16_t>(h)));
+        src.push_back(BitsToFloat(bits));
+        if ((h & 0x7C00) != 0x7C00 && (h & 0x7FFF) != 0x7BFF) {
+            const float next = CommonHelper::ConvertHalfToFloat(static_cast<uint16_t>(h + 1));
+            const float mid = (BitsToFloat(bits) + next) / 2;
+            src.push_back(mid);
+            src.push_back(BitsToFloat(FloatToBits(mid) + 1));
+            src.push_back(BitsToFloat(FloatToBits(mid) - 1));
+        }
+    }
+    /* boundaries of overflow and subnormal, inf and NaN with payload */
+    const uint32_t special_list[] = { 0x47800000, 0x477FEFFF, 0x477FF000, 0x38800000, 0x387FFFFF, 0x33000000, 0x33000001, 0x32FFFFFF,
+        0x7F800000, 0x7F800001, 0x7FC00000, 0x7FC00001, 0x7FBFFFFF, 0x7FFFFFFF, 0x7F802000, 0x00000001, 0x00000000 };
+    for (const auto& bits : special_list) {
+        src.push_back(BitsToFloat(bits));
+        src.push_back(BitsToFloat(bits | 0x80000000));
+    }
+    /* random bit patterns */
+    std::mt19937 engine(1234);
+    for (int32_t i = 0; i < RANDOM_NUM; i++) src.push_back(BitsToFloat(engine()));
+
+    std::vector<uint16_t> dst(src.size());
+    CommonHelper::ConvertFloatToHalf(src.data(), dst.data(), static_cast<int32_t>(src.size()));
+    int32_t mismatch_num = 0;
+    for (size_t i = 0; i < src.size(); i++) {
+        const uint16_t expected = CommonHelper::ConvertFloatToHalf(src[i]);
+        if (dst[i] != expected && mismatch_num++ < MISMATCH_PRINT_NUM) printf("    float %08X: %04X (expected %04X)\n", FloatToBits(src[i]), dst[i], expected);
+    }
+    return Report("float -> half", mismatch_num, static_cast<int32_t>(src.size()));
+}
+
+/* Every length up to 64 (vector loop and tail) with some zero points */
+static int32_t CheckDequantize()
+{
+    std::vector<uint8_t> src(256 + 64);
+    for (size_t i = 0; i < src.size(); i++) src[i] = static_cast<uint8_t>(i * 37 + 11);
+    std::vector<float> dst(src.size());
+    const int32_t zero_point_list[] = { -300, 0, 1, 113, 255, 1000 };
+    const float scale = 0.0188f;
+    int32_t mismatch_num = 0;
+    int32_t total_num = 0;
+    for (const auto& zero_point : zero_point_list) {
+        for (int32_t num = 0; num <= 64; num++) {
+            CommonHelper::DequantizeUint8(src.data() + 1, dst.data(), num, scale, zero_point);
+            for (int32_t i = 0; i < num; i++) {
+                const float expected = (src[1 + i] - zero_point) * scale;
+                if (FloatToBits(dst[i]) != FloatToBits(expected) && mismatch_num++ < MISMATCH_PRINT_NUM) printf("    q %d (zp %d): %f (expected %f)\n", src[1 + i], zero_point, dst[i], expected);
+                total_num++;
+            }
+        }
+    }
+    return Report("dequantize uint8", mismatch_num, total_num);
+}
+
+/* Read and ArgMax of HostTensorView against Get of each element */
+static int32_t CheckView()
+{
+    const int32_t num = 1000;
+    std::mt19937 engine(1234);
+    std::uniform_real_distribution<float> dist(-10.0f, 10.0f);
+    std::vector<float> value_list(num);
+    for (auto& value : value_list) value = dist(engine);
+    value_list[777] = 20.0f;
+    value_list[888] = 20.0f;
+    const int32_t type_list[] = { CommonHelper::kHostTensorTypeFp32, CommonHelper::kHostTensorTypeFp16, CommonHelper::kHostTensorTypeUint8 };
+    int32_t mismatch_num = 0;
+    for (const auto& type : type_list) {
+        std::vector<uint8_t> tensor(num * CommonHelper::GetHostTensorElementSize(type));
+        CommonHelper::ConvertFloatToHostTensor(value_list.data(), tensor.data(), num, type, 0.1f, 128);
+        const CommonHelper::HostTensorView view(tensor.data(), type, 0.1f, 128);
+        std::vector<float> work(num);
+        const float* read = view.Read(5, num - 5, work.data());
+        int32_t expected_index = 0;
+        for (int32_t i = 0; i < num - 5; i++) {
+            if (FloatToBits(read[i]) != FloatToBits(view.Get(5 + i))) mismatch_num++;
+            if (view.Get(5 + i) > view.Get(5 + expected_index)) expected_index = i;
+        }
+        float max_value;
+        const int32_t index = view.ArgMax(5, num - 5, max_value);
+        if (index != expected_index || max_value != view.Get(5 + expected_index)) {
+            if (mismatch_num++ < MISMATCH_PRINT_NUM) printf("    type %d: ArgMax %d (expected %d)\n", type, index, expected_index);
+        }
+    }
+    return Report("view read / argmax", mismatch_num, 3 * num);
+}
+
+/* Blob of fp16 / uint8 by the table of each type against the conversion of fp32 blob */
+static int32_t CheckResizePlan()
+{
+    const int32_t src_w = 333;
+    const int32_t src_h = 199;
+    const int32_t dst_w = 160;
+    const int32_t dst_h = 128;
+    const int32_t element_num = 3 * dst_w * dst_h;
+    std::mt19937 engine(1234);
+    std::vector<uint8_t> image(src_w * src_h * 3);
+    for (auto& value : image) value = static_cast<uint8_t>(engine() & 0xFF);
+    const float mean[3] = { 0.485f, 0.456f, 0.406f };
+    const float norm[3] = { 0.229f, 0.224f, 0.225f };
+    const float quant_scale = 0.02f;
+    const int32_t quant_zero_point = 110;
+    int32_t mismatch_num = 0;
+    for (int32_t crop_type = CommonHelper::kCropTypeStretch; crop_type <= CommonHelper::kCropTypeExpand; crop_type++) {
+        CommonHelper::ResizePlan plan;
+        plan.Create(dst_w, dst_h, 10, 5, src_w - 20, src_h - 10, crop_type, mean, norm, true);
+        plan.SetQuantization(quant_scale, quant_zero_point);
+        std::vector<float> blob_fp32(element_num);
+        std::vector<uint16_t> blob_fp16(element_num);
+        std::vector<uint8_t> blob_uint8(element_num);
+        plan.Apply(image.data(), src_w * 3, blob_fp32.data());
+        plan.Apply(image.data(), src_w * 3, blob_fp16.data());
+        plan.Apply(image.data(), src_w * 3, blob_uint8.data());
+        std::vector<uint16_t> expected_fp16(element_num);
+        std::vector<uint8_t> expected_uint8(element_num);
+        for (int32_t i = 0; i < element_num; i++) expected_fp16[i] = CommonHelper::ConvertFloatToHalf(blob_fp32[i]);
+        CommonHelper::QuantizeToUint8(blob_fp32.data(), expected_uint8.data(), element_num, quant_scale, quant_zero_point);
+        for (int32_t i = 0; i < element_num; i++) {
+            if (blob_fp16[i] != expected_fp16[i] || blob_uint8[i] != expected_uint8[i]) mismatch_num++;
+        }
+    }
+    return Report("resize plan fp16 / uint8", mismatch_num, 3 * element_num);
+}
+
+/* Plan written into a cell of a larger blob (SetDstLayout) and Fill, against the blob of the cell size */
+static int32_t CheckResizePlanCell()
+{
+    const int32_t src_w = 333;
+    const int32_t src_h = 199;
+    const int32_t blob_w = 160;
+    const int32_t blob_h = 128;
+    const int32_t cell_w = blob_w / 2;
+    const int32_t cell_h = blob_h / 2;
+    const int32_t cell_x = cell_w;
+    const int32_t cell_y = cell_h;
+    std::mt19937 engine(1234);
+    std::vector<uint8_t> image(src_w * src_h * 3);
+    for (auto& value : image) value = static_cast<uint8_t>(engine() & 0xFF);
+    const float mean[3] = { 0.485f, 0.456f, 0.406f };
+    const float norm[3] = { 0.229f, 0.224f, 0.225f };
+    const float kGuard = -12345.0f;
+    int32_t mismatch_num = 0;
+    for (int32_t crop_type = CommonHelper::kCropTypeStretch; crop_type <= CommonHelper::kCropTypeExpand; crop_type++) {
+        CommonHelper::ResizePlan plan;
+        plan.Create(cell_w, cell_h, 10, 5, src_w / 2, src_h - 10, crop_type, mean, norm, true);
+        std::vector<float> expected(3 * cell_w * cell_h);
+        plan.Apply(image.data(), src_w * 3, expected.data());
+
+        std::vector<float> blob(3 * blob_w * blob_h, kGuard);
+        plan.SetDstLayout(blob_w, blob_w * blob_h);
+        plan.Apply(image.data(), src_w * 3, blob.data() + cell_y * blob_w + cell_x);
+        for (int32_t c = 0; c < 3; c++) {
+            for (int32_t y = 0; y < blob_h; y++) {
+                for (int32_t x = 0; x < blob_w; x++) {
+                    const bool is_cell = (x >= cell_x && x < cell_x + cell_w && y >= cell_y && y < cell_y + cell_h);
+                    const float actual = blob[(c * blob_h + y) * blob_w + x];
+                    const float value = is_cell ? expected[(c * cell_h + y - cell_y) * cell_w + x - cell_x] : kGuard;
+                    if (FloatToBits(actual) != FloatToBits(value)) mismatch_num++;
+                }
+            }
+        }
+
+        /* Fill writes the value of src = 0 to the whole cell */
+        plan.Fill(blob.data(), CommonHelper::kHostTensorTypeFp32);
+        for (int32_t c = 0; c < 3; c++) {
+            for (int32_t y = 0; y < cell_h; y++) {
+                for (int32_t x = 0; x < cell_w; x++) {
+                    if (blob[(c * blob_h + y) * blob_w + x] != -mean[c] / norm[c]) mismatch_num++;
+                }
+            }
+        }
+    }
+    return Report("resize plan cell / fill", mismatch_num, 3 * 3 * (blob_w * blob_h + cell_w * cell_h));
+}
+
+int32_t main(int argc, char* argv[])
+{
+    printf("=== Host tensor conversion against scalar ===\n");
+    int32_t mismatch_num = 0;
+    mismatch_num += CheckHalfToFloat();
+    mismatch_num += CheckFloatToHalf();
+    mismatch_num += CheckDequantize();
+    mismatch_num += CheckView();
+    mismatch_num += CheckResizePlan();
+    mismatch_num += CheckResizePlanCell();
+    if (mismatch_num > 0) {
+        printf("NG\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
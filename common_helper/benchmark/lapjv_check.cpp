@@ -0,0 +1,154 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <random>
+
+/* for My modules */
+#include "lapjv_algorithm.h"
+
+/* Check that LapjvAlgorithm gives the optimal assignment (the same total cost as exhaustive search by DP over subsets) */
+/* with and without warm start. Warm start uses the duals of the previous frame, whose size is different from the current one */
+/* (objects appear and disappear, and the matrix may turn from wide to tall). Return non-zero if there is any mismatch */
+
+/*** Macro ***/
+#define FRAME_NUM       2000
+#define SIZE_MAX_NUM    12
+#define COST_EPSILON    1e-4f
+
+/*** Function ***/
+/* Minimum total cost when all items of the smaller side are assigned. dp[set of used items of the larger side] */
+static float CalculateOptimalCost(const std::vector<float>& cost_matrix, int32_t rows, int32_t cols, std::vector<float>& dp)
+{
+    const bool is_transposed = rows > cols;
+    const int32_t n = (std::min)(rows, cols);
+    const int32_t m = (std::max)(rows, cols);
+    const float kInf = 1e30f;
+    dp.assign(static_cast<size_t>(1) << m, kInf);
+    dp[0] = 0;
+    float best = kInf;
+    for (uint32_t used = 0; used < dp.size(); used++) {
+        if (dp[used] >= kInf) continue;
+        int32_t i = 0;      /* items of the smaller side are assigned in order, so the number of used items is the next item */
+        for (uint32_t bits = used; bits; bits &= bits - 1) i++;
+        if (i == n) {
+            best = (std::min)(best, dp[used]);
+            continue;
+        }
+        for (int32_t j = 0; j < m; j++) {
+            if (used & (1u << j)) continue;
+            const float cost = is_transposed ? cost_matrix[j * cols + i] : cost_matrix[i * cols + j];
+            float& next = dp[used | (1u << j)];
+            next = (std::min)(next, dp[used] + cost);
+        }
+    }
+    return best;
+}
+
+static float CalculateTotalCost(const std::vector<float>& cost_matrix, int32_t cols, const std::vector<int32_t>& assign_for_row)
+{
+    float total = 0;
+    for (size_t y = 0; y < assign_for_row.size(); y++) {
+        if (assign_for_row[y] >= 0) total += cost_matrix[y * cols + assign_for_row[y]];
+    }
+    return total;
+}
+
+/* Return true if all items of the smaller side are assigned, and assign_for_row and assign_for_col are consistent */
+static bool IsValidAssignment(int32_t rows, int32_t cols, const std::vector<int32_t>& assign_for_row, const std::vector<int32_t>& assign_for_col)
+{
+    if (static_cast<int32_t>(assign_for_row.size()) != rows || static_cast<int32_t>(assign_for_col.size()) != cols) return false;
+    int32_t num = 0;
+    for (int32_t y = 0; y < rows; y++) {
+        const int32_t x = assign_for_row[y];
+        if (x < 0) continue;
+        if (x >= cols || assign_for_col[x] != y) return false;
+        num++;
+    }
+    return num == (std::min)(rows, cols);
+}
+
+int32_t main(int argc, char* argv[])
+{
+    printf("=== LAPJV against exhaustive search ===\n");
+    std::mt19937 engine(1234);
+    std::uniform_int_distribution<int32_t> dist_size(1, SIZE_MAX_NUM);
+    std::uniform_int_distribution<int32_t> dist_step(-3, 3);
+    std::uniform_real_distribution<float> dist_cost(0.0f, 1.0f);
+
+    LapjvAlgorithm<float> lapjv_cold;
+    LapjvAlgorithm<float> lapjv_warm;
+    std::vector<float> cost_matrix;
+    std::vector<float> dp;
+    std::vector<int32_t> assign_for_row;
+    std::vector<int32_t> assign_for_col;
+    std::vector<float> row_dual_prev;
+    std::vector<float> col_dual_prev;
+
+    int32_t mismatch_cold = 0;
+    int32_t mismatch_warm = 0;
+    int32_t smaller_prev_num = 0;
+    int32_t rows = dist_size(engine);
+    int32_t cols = dist_size(engine);
+    for (int32_t frame = 0; frame < FRAME_NUM; frame++) {
+        /* The size changes a little every frame (sometimes jumps) */
+        if (frame % 50 == 0) {
+            rows = dist_size(engine);
+            cols = dist_size(engine);
+        } else {
+            rows = (std::min)((std::max)(rows + dist_step(engine), 1), SIZE_MAX_NUM);
+            cols = (std::min)((std::max)(cols + dist_step(engine), 1), SIZE_MAX_NUM);
+        }
+        const int32_t larger_num = (std::max)(rows, cols);
+        const std::vector<float>& dual_prev = (rows > cols) ? row_dual_prev : col_dual_prev;
+        if (!dual_prev.empty() && static_cast<int32_t>(dual_prev.size()) < larger_num) smaller_prev_num++;
+
+        cost_matrix.resize(rows * cols);
+        for (auto& cost : cost_matrix) cost = dist_cost(engine);
+        const float cost_expected = CalculateOptimalCost(cost_matrix, rows, cols, dp);
+
+        lapjv_cold.SetCostMatrix(cost_matrix.data(), rows, cols);
+        lapjv_cold.Solve(assign_for_row, assign_for_col);
+        if (!IsValidAssignment(rows, cols, assign_for_row, assign_for_col) || std::fabs(CalculateTotalCost(cost_matrix, cols, assign_for_row) - cost_expected) > COST_EPSILON) {
+            if (mismatch_cold < 5) printf("  cold start mismatch at frame %d (%d x %d)\n", frame, rows, cols);
+            mismatch_cold++;
+        }
+
+        lapjv_warm.SetCostMatrix(cost_matrix.data(), rows, cols);
+        lapjv_warm.SetInitialDual(row_dual_prev, col_dual_prev);
+        lapjv_warm.Solve(assign_for_row, assign_for_col);
+        if (!IsValidAssignment(rows, cols, assign_for_row, assign_for_col) || std::fabs(CalculateTotalCost(cost_matrix, cols, assign_for_row) - cost_expected) > COST_EPSILON) {
+            if (mismatch_warm < 5) printf("  warm start mismatch at frame %d (%d x %d)\n", frame, rows, cols);
+            mismatch_warm++;
+        }
+        row_dual_prev = lapjv_warm.GetRowDual();
+        col_dual_prev = lapjv_warm.GetColDual();
+    }
+
+    printf("  %-24s %s (%d / %d mismatch)\n", "cold start", mismatch_cold == 0 ? "OK" : "NG", mismatch_cold, FRAME_NUM);
+    printf("  %-24s %s (%d / %d mismatch, %d frames from smaller duals)\n", "warm start", mismatch_warm == 0 ? "OK" : "NG", mismatch_warm, FRAME_NUM, smaller_prev_num);
+    if (mismatch_cold + mismatch_warm > 0) {
+        printf("NG\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,125 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <functional>
+
+/* for My modules */
+#include "bounding_box.h"
+#include "batched_nms.h"
+#include "matrix_nms.h"
+
+/*** Macro ***/
+#define IMAGE_WIDTH         3840
+#define IMAGE_HEIGHT        2160
+#define NUM_CLASS           80
+#define BOX_NUM_PER_OBJECT  10      /* number of candidates around one object (like the output of detector before NMS) */
+#define THRESHOLD_NMS_IOU   0.5f
+#define THRESHOLD_SCORE     0.1f    /* for Matrix NMS */
+
+/*** Function ***/
+static std::vector<BoundingBox> CreateCandidateList(int32_t num, uint32_t seed)
+{
+    std::mt19937 engine(seed);
+    std::uniform_int_distribution<int32_t> dist_x(0, IMAGE_WIDTH - 1);
+    std::uniform_int_distribution<int32_t> dist_y(0, IMAGE_HEIGHT - 1);
+    std::uniform_int_distribution<int32_t> dist_size(16, 256);
+    std::uniform_int_distribution<int32_t> dist_class(0, NUM_CLASS - 1);
+    std::normal_distribution<float> dist_jitter(0.0f, 0.05f);
+    std::uniform_real_distribution<float> dist_score(0.2f, 1.0f);
+
+    std::vector<BoundingBox> bbox_list;
+    while (static_cast<int32_t>(bbox_list.size()) < num) {
+        const int32_t x = dist_x(engine);
+        const int32_t y = dist_y(engine);
+        const int32_t w = dist_size(engine);
+        const int32_t h = dist_size(engine);
+        const int32_t class_id = dist_class(engine);
+        for (int32_t i = 0; i < BOX_NUM_PER_OBJECT && static_cast<int32_t>(bbox_list.size()) < num; i++) {
+            BoundingBox bbox(class_id, dist_score(engine), x, y, w, h);
+            bbox.x += static_cast<int32_t>(w * dist_jitter(engine));
+            bbox.y += static_cast<int32_t>(h * dist_jitter(engine));
+            bbox.w += static_cast<int32_t>(w * dist_jitter(engine));
+            bbox.h += static_cast<int32_t>(h * dist_jitter(engine));
+            bbox_list.push_back(bbox);
+        }
+    }
+    return bbox_list;
+}
+
+static void Measure(const char* name, int32_t loop_num, const std::vector<BoundingBox>& bbox_list, std::function<void(std::vector<BoundingBox>&, std::vector<BoundingBox>&)> func)
+{
+    double time_total = 0;
+    size_t num_output = 0;
+    for (int32_t i = 0; i < loop_num; i++) {
+        std::vector<BoundingBox> bbox_input = bbox_list;   /* Nms modifies input */
+        std::vector<BoundingBox> bbox_nms_list;
+        const auto& t0 = std::chrono::steady_clock::now();
+        func(bbox_input, bbox_nms_list);
+        const auto& t1 = std::chrono::steady_clock::now();
+        time_total += (t1 - t0).count() / 1000000.0;
+        num_output = bbox_nms_list.size();
+    }
+    printf("  %-28s %9.3lf [msec] (output = %zu)\n", name, time_total / loop_num, num_output);
+}
+
+int32_t main(int argc, char* argv[])
+{
+    const int32_t loop_num = (argc > 1) ? std::atoi(argv[1]) : 10;
+    const int32_t num_list[] = { 100, 1000, 10000 };
+
+    BatchedNms batched_nms;
+    MatrixNms matrix_nms;
+    for (const auto& num : num_list) {
+        const std::vector<BoundingBox> bbox_list = CreateCandidateList(num, 1234);
+        printf("=== %d boxes ===\n", num);
+        Measure("Nms", loop_num, bbox_list, [](std::vector<BoundingBox>& in, std::vector<BoundingBox>& out) {
+            BoundingBoxUtils::Nms(in, out, THRESHOLD_NMS_IOU, false);
+        });
+        Measure("Nms (class)", loop_num, bbox_list, [](std::vector<BoundingBox>& in, std::vector<BoundingBox>& out) {
+            BoundingBoxUtils::Nms(in, out, THRESHOLD_NMS_IOU, true);
+        });
+        Measure("BatchedNms", loop_num, bbox_list, [&batched_nms](std::vector<BoundingBox>& in, std::vector<BoundingBox>& out) {
+            batched_nms.SetParam(THRESHOLD_NMS_IOU, 0, 0, false);
+            batched_nms.Run(in, out);
+        });
+        Measure("BatchedNms (class)", loop_num, bbox_list, [&batched_nms](std::vector<BoundingBox>& in, std::vector<BoundingBox>& out) {
+            batched_nms.SetParam(THRESHOLD_NMS_IOU, 0, 0, true);
+            batched_nms.Run(in, out);
+        });
+        Measure("MatrixNms (linear)", loop_num, bbox_list, [&matrix_nms](std::vector<BoundingBox>& in, std::vector<BoundingBox>& out) {
+            matrix_nms.SetParam(THRESHOLD_SCORE, MatrixNms::kKernelLinear);
+            matrix_nms.Run(in, out);
+        });
+        Measure("MatrixNms (gaussian)", loop_num, bbox_list, [&matrix_nms](std::vector<BoundingBox>& in, std::vector<BoundingBox>& out) {
+            matrix_nms.SetParam(THRESHOLD_SCORE, MatrixNms::kKernelGaussian);
+            matrix_nms.Run(in, out);
+        });
+        Measure("MatrixNms (gaussian, class)", loop_num, bbox_list, [&matrix_nms](std::vector<BoundingBox>& in, std::vector<BoundingBox>& out) {
+            matrix_nms.SetParam(THRESHOLD_SCORE, MatrixNms::kKernelGaussian, 2.0f, true);
+            matrix_nms.Run(in, out);
+        });
+    }
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+/* for My modules */
+#include "bounding_box.h"
+#include "tracker.h"
+#include "detection_trace.h"
+
+/*** Function ***/
+static void PrintUsage()
+{
+    printf("usage: trace_replay trace_file [--loop=1] [--dump]\n");
+    printf("  Feed detection results recorded by DetectionTraceWriter to Tracker at maximum speed\n");
+    printf("  --dump: print tracks of each frame (frame, id, x, y, w, h, class_id, score) to compare results of tracker changes\n");
+}
+
+int32_t main(int argc, char* argv[])
+{
+    std::string trace_file;
+    int32_t loop_num = 1;
+    bool is_dump = false;
+    for (int32_t i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg.find("--loop=") == 0) {
+            loop_num = std::atoi(arg.substr(7).c_str());
+        } else if (arg == "--dump") {
+            is_dump = true;
+        } else if (arg.find("--") != 0 && trace_file.empty()) {
+            trace_file = arg;
+        } else {
+            PrintUsage();
+            return -1;
+        }
+    }
+    if (trace_file.empty()) {
+        PrintUsage();
+        return -1;
+    }
+
+    DetectionTraceReader reader;
+    if (reader.Open(trace_file) != DetectionTrace::kRetOk) {
+        return -1;
+    }
+    const int32_t frame_num = reader.GetFrameNum();
+
+    std::vector<BoundingBox> det_list;
+    std::vector<double> time_list;
+    int64_t det_num = 0;
+    int32_t track_id_max = -1;
+    for (int32_t loop = 0; loop < loop_num; loop++) {
+        Tracker tracker;
+        for (int32_t i = 0; i < frame_num; i++) {
+            const DetectionTrace::Frame frame = reader.GetFrame(i);
+            det_list.assign(frame.bbox_list, frame.bbox_list + frame.header->bbox_num);
+            det_num += frame.header->bbox_num;
+
+            const auto t0 = std::chrono::steady_clock::now();
+            if (frame.header->timestamp < 0) {
+                tracker.Update(det_list);
+            } else {
+                tracker.Update(det_list, frame.header->timestamp);
+            }
+            const auto t1 = std::chrono::steady_clock::now();
+            time_list.push_back((t1 - t0).count() / 1000000.0);
+
+            for (const auto& track : tracker.GetTrackPool()) {
+                track_id_max = (std::max)(track_id_max, track.GetId());
+                if (is_dump && loop == 0) {
+                    const BoundingBox& bbox = track.GetLatestBoundingBox();
+                    printf("%d,%d,%d,%d,%d,%d,%d,%.3f\n", i, track.GetId(), bbox.x, bbox.y, bbox.w, bbox.h, bbox.class_id, bbox.score);
+                }
+            }
+        }
+    }
+
+    if (time_list.empty()) {
+        printf("No frame in %s\n", trace_file.c_str());
+        return 0;
+    }
+    double time_total = 0;
+    for (const auto& time : time_list) time_total += time;
+    std::sort(time_list.begin(), time_list.end());
+    printf("=== %s ===\n", trace_file.c_str());
+    printf("  frames: %d x %d loop, detections: %lld, tracks created: %d (per loop)\n", frame_num, loop_num, static_cast<long long>(det_num), track_id_max + 1);
+    printf("  Tracker::Update: total %.3lf [msec], mean %.3lf, p50 %.3lf, p99 %.3lf, max %.3lf [msec/frame] (%.1lf [frame/sec])\n",
+        time_total, time_total / time_list.size(), time_list[time_list.size() / 2], time_list[(time_list.size() * 99) / 100], time_list.back(), time_list.size() / time_total * 1000.0);
+    return 0;
+}
@@ -0,0 +1,481 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+/* for My modules */
+#include "bounding_box.h"
+#include "box_batch.h"
+#include "tracker.h"
+#include "hungarian_algorithm.h"
+#include "lapjv_algorithm.h"
+#include "alloc_counter.h"
+#include "detection_trace.h"
+
+/*** Macro ***/
+#define IMAGE_WIDTH                 3840
+#define IMAGE_HEIGHT                2160
+#define NUM_CLASS                   80
+#define BOX_NUM_PER_OBJECT          5       /* number of candidates around one object (like the output of detector before NMS) */
+#define THRESHOLD_NMS_IOU           0.5f
+#define THRESHOLD_IOU_TO_MATCH_GT   0.5f    /* a track is regarded as the object when IoU is over this */
+#define OCCLUSION_LENGTH            8       /* [frame] average length of occlusion */
+#define GRID_CELL_SIZE              256     /* [px] cell size of the grid to find objects around a track */
+
+/*** Type ***/
+typedef struct {
+    std::vector<int32_t> object_num_list;
+    int32_t frame_num;
+    int32_t warmup_frame_num;       /* frames not counted (tracks are being created) */
+    float   speed;                  /* [px/frame] max speed of objects */
+    float   occlusion_rate;         /* ratio of objects occluded (not detected for OCCLUSION_LENGTH frames on average) */
+    float   false_positive_rate;    /* number of false positives per frame / number of objects */
+    float   drop_rate;              /* probability that an object is not detected in a frame */
+    int32_t hungarian_max;          /* HungarianAlgorithm runs only when the number of objects is up to this (it's O(n^3)) */
+    uint32_t seed;
+    std::string json_path;          /* "-" = stdout */
+    std::string trace_path;         /* record detections (post-NMS) of the scenes to replay with trace_replay */
+} Param;
+
+typedef struct {
+    BoundingBox bbox;
+    float vx;
+    float vy;
+    float x;
+    float y;
+    int32_t occluded_frame_num;     /* remaining frames of occlusion */
+} Object;
+
+typedef struct {
+    std::string name;
+    std::vector<double> time_list;  /* [msec] */
+} StageTime;
+
+typedef struct {
+    int32_t object_num;
+    std::vector<StageTime> stage_list;
+    int64_t alloc_count;            /* in Tracker::Update after warmup. -1 if not available */
+    int64_t alloc_size;
+    int32_t id_switch_num;
+    int64_t gt_num;                 /* sum of visible objects over frames */
+    int64_t matched_num;            /* sum of objects matched to a track */
+    size_t track_num;               /* at the last frame */
+} Report;
+
+/*** Function ***/
+/* Moving boxes in the image. Objects bounce at the edge of the image */
+class SceneGenerator {
+public:
+    void Initialize(int32_t object_num, const Param& param)
+    {
+        param_ = param;
+        engine_.seed(param.seed);
+        std::uniform_real_distribution<float> dist_x(0, IMAGE_WIDTH);
+        std::uniform_real_distribution<float> dist_y(0, IMAGE_HEIGHT);
+        std::uniform_int_distribution<int32_t> dist_size(24, 160);
+        std::uniform_int_distribution<int32_t> dist_class(0, NUM_CLASS - 1);
+        std::uniform_real_distribution<float> dist_v(-param.speed, param.speed);
+        object_list_.clear();
+        for (int32_t i = 0; i < object_num; i++) {
+            Object object;
+            object.bbox = BoundingBox(dist_class(engine_), 1.0f, 0, 0, dist_size(engine_), dist_size(engine_));
+            object.x = (std::min)(dist_x(engine_), static_cast<float>(IMAGE_WIDTH - object.bbox.w));
+            object.y = (std::min)(dist_y(engine_), static_cast<float>(IMAGE_HEIGHT - object.bbox.h));
+            object.vx = dist_v(engine_);
+            object.vy = dist_v(engine_);
+            object.occluded_frame_num = 0;
+            object_list_.push_back(object);
+        }
+        Step();
+    }
+
+    void Step()
+    {
+        std::uniform_real_distribution<float> dist_01(0, 1);
+        std::uniform_int_distribution<int32_t> dist_occlusion(1, OCCLUSION_LENGTH * 2 - 1);
+        for (auto& object : object_list_) {
+            object.x += object.vx;
+            object.y += object.vy;
+            if (object.x < 0 || object.x + object.bbox.w > IMAGE_WIDTH) object.vx = -object.vx;
+            if (object.y < 0 || object.y + object.bbox.h > IMAGE_HEIGHT) object.vy = -object.vy;
+            object.bbox.x = static_cast<int32_t>(object.x);
+            object.bbox.y = static_cast<int32_t>(object.y);
+            if (object.occluded_frame_num > 0) {
+                object.occluded_frame_num--;
+            } else if (dist_01(engine_) < param_.occlusion_rate / OCCLUSION_LENGTH) {
+                object.occluded_frame_num = dist_occlusion(engine_);
+            }
+        }
+    }
+
+    /* Detector output before NMS: candidates around visible objects, and false positives */
+    void CreateCandidateList(std::vector<BoundingBox>& bbox_list)
+    {
+        std::uniform_real_distribution<float> dist_01(0, 1);
+        std::normal_distribution<float> dist_jitter(0.0f, 0.03f);
+        std::uniform_real_distribution<float> dist_score(0.3f, 1.0f);
+        bbox_list.clear();
+        for (const auto& object : object_list_) {
+            if (object.occluded_frame_num > 0 || dist_01(engine_) < param_.drop_rate) continue;
+            const BoundingBox& gt = object.bbox;
+            for (int32_t i = 0; i < BOX_NUM_PER_OBJECT; i++) {
+                BoundingBox bbox = gt;
+                bbox.score = dist_score(engine_);
+                bbox.x += static_cast<int32_t>(gt.w * dist_jitter(engine_));
+                bbox.y += static_cast<int32_t>(gt.h * dist_jitter(engine_));
+                bbox.w += static_cast<int32_t>(gt.w * dist_jitter(engine_));
+                bbox.h += static_cast<int32_t>(gt.h * dist_jitter(engine_));
+                bbox_list.push_back(bbox);
+            }
+        }
+
+        std::uniform_int_distribution<int32_t> dist_x(0, IMAGE_WIDTH - 1);
+        std::uniform_int_distribution<int32_t> dist_y(0, IMAGE_HEIGHT - 1);
+        std::uniform_int_distribution<int32_t> dist_size(24, 160);
+        std::uniform_int_distribution<int32_t> dist_class(0, NUM_CLASS - 1);
+        const int32_t false_positive_num = static_cast<int32_t>(object_list_.size() * param_.false_positive_rate + dist_01(engine_));
+        for (int32_t i = 0; i < false_positive_num; i++) {
+            bbox_list.push_back(BoundingBox(dist_class(engine_), dist_score(engine_), dist_x(engine_), dist_y(engine_), dist_size(engine_), dist_size(engine_)));
+        }
+    }
+
+    const std::vector<Object>& GetObjectList() const { return object_list_; }
+
+private:
+    Param param_;
+    std::mt19937 engine_;
+    std::vector<Object> object_list_;
+};
+
+
+/* Find the object for each track and count ID switches (an object is matched to a different track from the last time) */
+class IdSwitchCounter {
+public:
+    void Initialize(int32_t object_num)
+    {
+        last_track_id_list_.assign(object_num, -1);
+        id_switch_num_ = 0;
+        gt_num_ = 0;
+        matched_num_ = 0;
+    }
+
+    void Update(const std::vector<Object>& object_list, Tracker& tracker)
+    {
+        /* Objects are registered to grid cells which they overlap */
+        const int32_t cell_num_x = (IMAGE_WIDTH + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE;
+        const int32_t cell_num_y = (IMAGE_HEIGHT + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE;
+        cell_list_.resize(cell_num_x * cell_num_y);
+        for (auto& cell : cell_list_) cell.clear();
+        for (int32_t i = 0; i < static_cast<int32_t>(object_list.size()); i++) {
+            const BoundingBox& bbox = object_list[i].bbox;
+            if (object_list[i].occluded_frame_num > 0) continue;
+            gt_num_++;
+            const int32_t x0 = (std::max)(0, bbox.x / GRID_CELL_SIZE);
+            const int32_t y0 = (std::max)(0, bbox.y / GRID_CELL_SIZE);
+            const int32_t x1 = (std::min)(cell_num_x - 1, (bbox.x + bbox.w) / GRID_CELL_SIZE);
+            const int32_t y1 = (std::min)(cell_num_y - 1, (bbox.y + bbox.h) / GRID_CELL_SIZE);
+            for (int32_t y = y0; y <= y1; y++) {
+                for (int32_t x = x0; x <= x1; x++) cell_list_[y * cell_num_x + x].push_back(i);
+            }
+        }
+
+        /* Only tracks detected in this frame are checked */
+        for (const auto& track : tracker.GetTrackPool()) {
+            if (track.GetUndetectedCount() > 0 || track.GetDetectedCount() < 2) continue;
+            const BoundingBox& bbox = track.GetLatestData().bbox_raw;
+            const int32_t cx = (std::min)((std::max)(0, bbox.x + bbox.w / 2), IMAGE_WIDTH - 1) / GRID_CELL_SIZE;
+            const int32_t cy = (std::min)((std::max)(0, bbox.y + bbox.h / 2), IMAGE_HEIGHT - 1) / GRID_CELL_SIZE;
+            int32_t best_object = -1;
+            float best_iou = THRESHOLD_IOU_TO_MATCH_GT;
+            for (const int32_t i : cell_list_[cy * cell_num_x + cx]) {
+                const float iou = BoundingBoxUtils::CalculateIoU(bbox, object_list[i].bbox);
+                if (iou > best_iou) {
+                    best_iou = iou;
+                    best_object = i;
+                }
+            }
+            if (best_object < 0) continue;
+            matched_num_++;
+            if (last_track_id_list_[best_object] >= 0 && last_track_id_list_[best_object] != track.GetId()) id_switch_num_++;
+            last_track_id_list_[best_object] = track.GetId();
+        }
+    }
+
+    int32_t GetIdSwitchNum() const { return id_switch_num_; }
+    int64_t GetGtNum() const { return gt_num_; }
+    int64_t GetMatchedNum() const { return matched_num_; }
+
+private:
+    std::vector<int32_t> last_track_id_list_;
+    std::vector<std::vector<int32_t>> cell_list_;
+    int32_t id_switch_num_;
+    int64_t gt_num_;
+    int64_t matched_num_;
+};
+
+
+static double GetPercentile(std::vector<double> time_list, double percentile)
+{
+    if (time_list.empty()) return 0;
+    std::sort(time_list.begin(), time_list.end());
+    const size_t index = static_cast<size_t>(std::ceil(percentile / 100.0 * time_list.size()));
+    return time_list[(std::min)(index > 0 ? index - 1 : 0, time_list.size() - 1)];
+}
+
+static double GetMean(const std::vector<double>& time_list)
+{
+    if (time_list.empty()) return 0;
+    double sum = 0;
+    for (const auto& time : time_list) sum += time;
+    return sum / time_list.size();
+}
+
+/* Association solvers with the dense cost matrix of objects (last frame) x detections (1 - IoU), for comparison */
+static void MeasureSolver(const std::vector<BoundingBox>& bbox_prev_list, const std::vector<BoundingBox>& det_list, bool use_hungarian, StageTime& time_lapjv, StageTime& time_hungarian)
+{
+    static BoxBatch box_batch_prev;
+    static BoxBatch box_batch_det;
+    static std::vector<float> cost_matrix;
+    static std::vector<std::vector<float>> cost_matrix_2d;
+    static LapjvAlgorithm<float> lapjv;
+    static HungarianAlgorithm<float> hungarian;
+    static std::vector<int32_t> assign_for_row;
+    static std::vector<int32_t> assign_for_col;
+
+    const int32_t rows = static_cast<int32_t>(bbox_prev_list.size());
+    const int32_t cols = static_cast<int32_t>(det_list.size());
+    if (rows == 0 || cols == 0) return;
+    box_batch_prev.Set(bbox_prev_list);
+    box_batch_det.Set(det_list);
+    cost_matrix.resize(rows * cols);
+    BoundingBoxUtils::CalculateIoUMatrix(box_batch_prev, box_batch_det, cost_matrix.data());
+    for (auto& cost : cost_matrix) cost = 1.0f - cost;
+
+    auto t0 = std::chrono::steady_clock::now();
+    lapjv.SetCostMatrix(cost_matrix.data(), rows, cols);
+    lapjv.Solve(assign_for_row, assign_for_col);
+    auto t1 = std::chrono::steady_clock::now();
+    time_lapjv.time_list.push_back((t1 - t0).count() / 1000000.0);
+
+    if (use_hungarian) {
+        cost_matrix_2d.resize(rows);
+        for (int32_t y = 0; y < rows; y++) cost_matrix_2d[y].assign(cost_matrix.begin() + y * cols, cost_matrix.begin() + (y + 1) * cols);
+        t0 = std::chrono::steady_clock::now();
+        hungarian.SetCostMatrix(cost_matrix_2d, rows, cols);
+        hungarian.Solve(assign_for_row, assign_for_col);
+        t1 = std::chrono::steady_clock::now();
+        time_hungarian.time_list.push_back((t1 - t0).count() / 1000000.0);
+    }
+}
+
+static Report RunScene(int32_t object_num, const Param& param)
+{
+    Report report;
+    report.object_num = object_num;
+    report.stage_list.resize(5);
+    StageTime& time_nms = report.stage_list[0];
+    StageTime& time_tracker = report.stage_list[1];
+    StageTime& time_total = report.stage_list[2];
+    StageTime& time_lapjv = report.stage_list[3];
+    StageTime& time_hungarian = report.stage_list[4];
+    time_nms.name = "nms";
+    time_tracker.name = "tracker_update";
+    time_total.name = "total";
+    time_lapjv.name = "lapjv_dense";
+    time_hungarian.name = "hungarian_dense";
+
+    SceneGenerator scene;
+    scene.Initialize(object_num, param);
+    Tracker tracker;
+    IdSwitchCounter id_switch_counter;
+    id_switch_counter.Initialize(object_num);
+    std::vector<BoundingBox> candidate_list;
+    std::vector<BoundingBox> det_list;
+    std::vector<BoundingBox> bbox_prev_list;
+    const bool use_hungarian = object_num <= param.hungarian_max;
+    DetectionTraceWriter trace_writer;
+    if (!param.trace_path.empty()) {
+        trace_writer.Open((param.object_num_list.size() > 1) ? param.trace_path + "." + std::to_string(object_num) : param.trace_path);
+    }
+    report.alloc_count = AllocCounter::IsAvailable() ? 0 : -1;
+    report.alloc_size = AllocCounter::IsAvailable() ? 0 : -1;
+
+    for (int32_t frame = 0; frame < param.warmup_frame_num + param.frame_num; frame++) {
+        const bool is_measured = frame >= param.warmup_frame_num;
+        scene.CreateCandidateList(candidate_list);
+
+        det_list.clear();   /* Nms appends the result */
+        const auto t0 = std::chrono::steady_clock::now();
+        BoundingBoxUtils::Nms(candidate_list, det_list, THRESHOLD_NMS_IOU, false);
+        const auto t1 = std::chrono::steady_clock::now();
+        AllocCounter::Reset();
+        tracker.Update(det_list);
+        const int64_t alloc_count = AllocCounter::GetCount();
+        const int64_t alloc_size = AllocCounter::GetSize();
+        const auto t2 = std::chrono::steady_clock::now();
+        if (trace_writer.IsOpened()) trace_writer.Write(-1, 0, 0, IMAGE_WIDTH, IMAGE_HEIGHT, det_list);
+
+        if (is_measured) {
+            time_nms.time_list.push_back((t1 - t0).count() / 1000000.0);
+            time_tracker.time_list.push_back((t2 - t1).count() / 1000000.0);
+            time_total.time_list.push_back((t2 - t0).count() / 1000000.0);
+            if (report.alloc_count >= 0) {
+                report.alloc_count += alloc_count;
+                report.alloc_size += alloc_size;
+            }
+            id_switch_counter.Update(scene.GetObjectList(), tracker);
+            MeasureSolver(bbox_prev_list, det_list, use_hungarian, time_lapjv, time_hungarian);
+        }
+
+        bbox_prev_list.clear();
+        for (const auto& object : scene.GetObjectList()) bbox_prev_list.push_back(object.bbox);
+        scene.Step();
+    }
+
+    report.id_switch_num = id_switch_counter.GetIdSwitchNum();
+    report.gt_num = id_switch_counter.GetGtNum();
+    report.matched_num = id_switch_counter.GetMatchedNum();
+    report.track_num = tracker.GetTrackPool().size();
+    return report;
+}
+
+static void PrintReport(FILE* fp, const Report& report)
+{
+    fprintf(fp, "=== %d objects ===\n", report.object_num);
+    fprintf(fp, "  %-16s %9s %9s %9s %9s %9s [msec]\n", "stage", "mean", "p50", "p90", "p99", "max");
+    for (const auto& stage : report.stage_list) {
+        if (stage.time_list.empty()) continue;
+        fprintf(fp, "  %-16s %9.3lf %9.3lf %9.3lf %9.3lf %9.3lf\n", stage.name.c_str(), GetMean(stage.time_list),
+            GetPercentile(stage.time_list, 50), GetPercentile(stage.time_list, 90), GetPercentile(stage.time_list, 99), GetPercentile(stage.time_list, 100));
+    }
+    fprintf(fp, "  allocation in tracker: %lld [times], %lld [byte]%s\n", static_cast<long long>(report.alloc_count), static_cast<long long>(report.alloc_size),
+        report.alloc_count < 0 ? " (build with COMMON_HELPER_COUNT_ALLOC=on)" : "");
+    fprintf(fp, "  id switch: %d, matched: %lld / %lld, tracks: %zu\n", report.id_switch_num, static_cast<long long>(report.matched_num), static_cast<long long>(report.gt_num), report.track_num);
+}
+
+static void WriteJson(FILE* fp, const Param& param, const std::vector<Report>& report_list)
+{
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"param\": {\"frame_num\": %d, \"warmup_frame_num\": %d, \"speed\": %g, \"occlusion_rate\": %g, \"false_positive_rate\": %g, \"drop_rate\": %g, \"seed\": %u, \"image_width\": %d, \"image_height\": %d},\n",
+        param.frame_num, param.warmup_frame_num, param.speed, param.occlusion_rate, param.false_positive_rate, param.drop_rate, param.seed, IMAGE_WIDTH, IMAGE_HEIGHT);
+    fprintf(fp, "  \"result\": [\n");
+    for (size_t i = 0; i < report_list.size(); i++) {
+        const Report& report = report_list[i];
+        fprintf(fp, "    {\"object_num\": %d, \"id_switch\": %d, \"gt_num\": %lld, \"matched_num\": %lld, \"track_num\": %zu, \"alloc_count\": %lld, \"alloc_size\": %lld, \"time_msec\": {",
+            report.object_num, report.id_switch_num, static_cast<long long>(report.gt_num), static_cast<long long>(report.matched_num), report.track_num,
+            static_cast<long long>(report.alloc_count), static_cast<long long>(report.alloc_size));
+        bool is_first = true;
+        for (const auto& stage : report.stage_list) {
+            if (stage.time_list.empty()) continue;
+            fprintf(fp, "%s\"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f}", is_first ? "" : ", ", stage.name.c_str(), GetMean(stage.time_list),
+                GetPercentile(stage.time_list, 50), GetPercentile(stage.time_list, 90), GetPercentile(stage.time_list, 99), GetPercentile(stage.time_list, 100));
+            is_first = false;
+        }
+        fprintf(fp, "}}%s\n", (i + 1 < report_list.size()) ? "," : "");
+    }
+    fprintf(fp, "  ]\n");
+    fprintf(fp, "}\n");
+}
+
+static void PrintUsage()
+{
+    printf("usage: tracker_benchmark [--objects=10,100,1000,5000] [--frames=200] [--warmup=10] [--speed=4]\n");
+    printf("                         [--occlusion=0.1] [--false_positive=0.05] [--drop=0.05] [--hungarian_max=500] [--seed=1234] [--json=path|-] [--trace=path]\n");
+}
+
+int32_t main(int argc, char* argv[])
+{
+    Param param;
+    param.object_num_list = { 10, 100, 1000, 5000 };
+    param.frame_num = 200;
+    param.warmup_frame_num = 10;
+    param.speed = 4.0f;
+    param.occlusion_rate = 0.1f;
+    param.false_positive_rate = 0.05f;
+    param.drop_rate = 0.05f;
+    param.hungarian_max = 500;
+    param.seed = 1234;
+
+    for (int32_t i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const size_t pos = arg.find('=');
+        const std::string key = arg.substr(0, pos);
+        const std::string value = (pos == std::string::npos) ? "" : arg.substr(pos + 1);
+        if (key == "--objects") {
+            param.object_num_list.clear();
+            for (size_t begin = 0; begin < value.size();) {
+                size_t end = value.find(',', begin);
+                if (end == std::string::npos) end = value.size();
+                param.object_num_list.push_back(std::atoi(value.substr(begin, end - begin).c_str()));
+                begin = end + 1;
+            }
+        } else if (key == "--frames") {
+            param.frame_num = std::atoi(value.c_str());
+        } else if (key == "--warmup") {
+            param.warmup_frame_num = std::atoi(value.c_str());
+        } else if (key == "--speed") {
+            param.speed = static_cast<float>(std::atof(value.c_str()));
+        } else if (key == "--occlusion") {
+            param.occlusion_rate = static_cast<float>(std::atof(value.c_str()));
+        } else if (key == "--false_positive") {
+            param.false_positive_rate = static_cast<float>(std::atof(value.c_str()));
+        } else if (key == "--drop") {
+            param.drop_rate = static_cast<float>(std::atof(value.c_str()));
+        } else if (key == "--hungarian_max") {
+            param.hungarian_max = std::atoi(value.c_str());
+        } else if (key == "--seed") {
+            param.seed = static_cast<uint32_t>(std::atoi(value.c_str()));
+        } else if (key == "--json") {
+            param.json_path = value;
+        } else if (key == "--trace") {
+            param.trace_path = value;
+        } else {
+            PrintUsage();
+            return -1;
+        }
+    }
+
+    /* The text report goes to stderr when stdout is used for JSON */
+    FILE* fp_report = (param.json_path == "-") ? stderr : stdout;
+    std::vector<Report> report_list;
+    for (const auto& object_num : param.object_num_list) {
+        report_list.push_back(RunScene(object_num, param));
+        PrintReport(fp_report, report_list.back());
+    }
+
+    if (param.json_path == "-") {
+        WriteJson(stdout, param, report_list);
+    } else if (!param.json_path.empty()) {
+        FILE* fp = fopen(param.json_path.c_str(), "w");
+        if (!fp) {
+            printf("Failed to open %s\n", param.json_path.c_str());
+            return -1;
+        }
+        WriteJson(fp, param, report_list);
+        fclose(fp);
+    }
+
+    return 0;
+}
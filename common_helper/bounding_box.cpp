@@ -22,6 +22,7 @@ limitations under the License.
 
 /* for My modules */
 #include "bounding_box.h"
+#include "box_batch.h"
 
 
 float BoundingBoxUtils::CalculateIoU(const BoundingBox& obj0, const BoundingBox& obj1)
@@ -50,22 +51,25 @@ void BoundingBoxUtils::Nms(std::vector<BoundingBox>& bbox_list, std::vector<Boun
         return false;
         });
 
+    BoxBatch batch;
+    batch.Set(bbox_list);
+    std::vector<float> iou_list(bbox_list.size());
+
     std::unique_ptr<bool[]> is_merged(new bool[bbox_list.size()]);
     for (size_t i = 0; i < bbox_list.size(); i++) is_merged[i] = false;
-    for (size_t index_high_score = 0; index_high_score < bbox_list.size(); index_high_score++) {
-        std::vector<BoundingBox> candidates;
+    const int32_t num = batch.Size();
+    for (int32_t index_high_score = 0; index_high_score < num; index_high_score++) {
         if (is_merged[index_high_score]) continue;
-        candidates.push_back(bbox_list[index_high_score]);
-        for (size_t index_low_score = index_high_score + 1; index_low_score < bbox_list.size(); index_low_score++) {
+        CalculateIoU(batch, index_high_score, batch, index_high_score + 1, num, iou_list.data());
+        for (int32_t index_low_score = index_high_score + 1; index_low_score < num; index_low_score++) {
             if (is_merged[index_low_score]) continue;
-            if (check_class_id && bbox_list[index_high_score].class_id != bbox_list[index_low_score].class_id) continue;
-            if (CalculateIoU(bbox_list[index_high_score], bbox_list[index_low_score]) > threshold_nms_iou) {
-                candidates.push_back(bbox_list[index_low_score]);
+            if (check_class_id && batch.class_id[index_high_score] != batch.class_id[index_low_score]) continue;
+            if (iou_list[index_low_score - index_high_score - 1] > threshold_nms_iou) {
                 is_merged[index_low_score] = true;
             }
         }
 
-        bbox_nms_list.push_back(candidates[0]);
+        bbox_nms_list.push_back(bbox_list[index_high_score]);
     }
 }
 
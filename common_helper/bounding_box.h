@@ -16,26 +16,28 @@ limitations under the License.
 #define BOUNDING_BOX_
 
 #include <cstdint>
-#include <string>
+#include <vector>
+#include <type_traits>
 
+/* Trivially copyable record of a detected object. Label is not kept here. Use class_id to look up the label table of each engine when it's needed (e.g. drawing) */
 class BoundingBox {
 public:
     BoundingBox()
-        :class_id(0), label(""), score(0), x(0), y(0), w(0), h(0)
+        :class_id(0), score(0), x(0), y(0), w(0), h(0)
     {}
 
-    BoundingBox(int32_t _class_id, std::string _label, float _score, int32_t _x, int32_t _y, int32_t _w, int32_t _h)
-        :class_id(_class_id), label(_label), score(_score), x(_x), y(_y), w(_w), h(_h)
+    BoundingBox(int32_t _class_id, float _score, int32_t _x, int32_t _y, int32_t _w, int32_t _h)
+        :class_id(_class_id), score(_score), x(_x), y(_y), w(_w), h(_h)
     {}
 
     int32_t     class_id;
-    std::string label;
     float       score;
     int32_t     x;
     int32_t     y;
     int32_t     w;
     int32_t     h;
 };
+static_assert(std::is_trivially_copyable<BoundingBox>::value, "BoundingBox must be trivially copyable");
 
 
 namespace BoundingBoxUtils
@@ -0,0 +1,247 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+/* for SIMD */
+#if defined(__AVX2__) || defined(__AVX__)
+#include <immintrin.h>
+#define BOX_BATCH_USE_AVX
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#define BOX_BATCH_USE_SSE4
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BOX_BATCH_USE_NEON
+#endif
+
+/* for My modules */
+#include "bounding_box.h"
+#include "box_batch.h"
+
+static constexpr int32_t kNumArray = 7;     /* x0, y0, x1, y1, area, score, class_id */
+static constexpr int32_t kCapacityUnit = BoxBatch::kAlignment / sizeof(float);
+
+static void* AlignedMalloc(size_t size, size_t alignment)
+{
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    void* p = nullptr;
+    if (posix_memalign(&p, alignment, size) != 0) return nullptr;
+    return p;
+#endif
+}
+
+static void AlignedFree(void* p)
+{
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void BoxBatch::AlignedDeleter::operator()(void* p) const
+{
+    AlignedFree(p);
+}
+
+constexpr int32_t BoxBatch::kAlignment;  // for link error in Android Studio (clang)
+BoxBatch::BoxBatch()
+    : x0(nullptr), y0(nullptr), x1(nullptr), y1(nullptr), area(nullptr), score(nullptr), class_id(nullptr), size_(0), capacity_(0)
+{
+}
+
+BoxBatch::~BoxBatch()
+{
+}
+
+void BoxBatch::Reserve(int32_t capacity)
+{
+    if (capacity <= capacity_) return;
+    capacity = (capacity + kCapacityUnit - 1) / kCapacityUnit * kCapacityUnit;
+    std::unique_ptr<void, AlignedDeleter> buffer(AlignedMalloc(sizeof(float) * capacity * kNumArray, kAlignment));
+    if (!buffer) throw std::bad_alloc();
+
+    float* p = static_cast<float*>(buffer.get());
+    float* new_x0 = p + capacity * 0;
+    float* new_y0 = p + capacity * 1;
+    float* new_x1 = p + capacity * 2;
+    float* new_y1 = p + capacity * 3;
+    float* new_area = p + capacity * 4;
+    float* new_score = p + capacity * 5;
+    int32_t* new_class_id = reinterpret_cast<int32_t*>(p + capacity * 6);
+    if (size_ > 0) {
+        std::memcpy(new_x0, x0, sizeof(float) * size_);
+        std::memcpy(new_y0, y0, sizeof(float) * size_);
+        std::memcpy(new_x1, x1, sizeof(float) * size_);
+        std::memcpy(new_y1, y1, sizeof(float) * size_);
+        std::memcpy(new_area, area, sizeof(float) * size_);
+        std::memcpy(new_score, score, sizeof(float) * size_);
+        std::memcpy(new_class_id, class_id, sizeof(int32_t) * size_);
+    }
+
+    buffer_ = std::move(buffer);
+    capacity_ = capacity;
+    x0 = new_x0;
+    y0 = new_y0;
+    x1 = new_x1;
+    y1 = new_y1;
+    area = new_area;
+    score = new_score;
+    class_id = new_class_id;
+}
+
+void BoxBatch::Clear()
+{
+    size_ = 0;
+}
+
+void BoxBatch::Push(float _x0, float _y0, float _x1, float _y1, float _score, int32_t _class_id)
+{
+    if (size_ >= capacity_) {
+        Reserve((std::max)(kCapacityUnit, capacity_ * 2));
+    }
+    x0[size_] = _x0;
+    y0[size_] = _y0;
+    x1[size_] = _x1;
+    y1[size_] = _y1;
+    area[size_] = (_x1 - _x0) * (_y1 - _y0);
+    score[size_] = _score;
+    class_id[size_] = _class_id;
+    size_++;
+}
+
+void BoxBatch::Push(const BoundingBox& bbox)
+{
+    Push(static_cast<float>(bbox.x), static_cast<float>(bbox.y), static_cast<float>(bbox.x + bbox.w), static_cast<float>(bbox.y + bbox.h), bbox.score, bbox.class_id);
+}
+
+void BoxBatch::Set(const std::vector<BoundingBox>& bbox_list)
+{
+    Clear();
+    Reserve(static_cast<int32_t>(bbox_list.size()));
+    for (const auto& bbox : bbox_list) {
+        Push(bbox);
+    }
+}
+
+
+void BoundingBoxUtils::CalculateIoU(const BoxBatch& batch0, int32_t index0, const BoxBatch& batch1, int32_t begin, int32_t end, float* iou_list)
+{
+    const float bx0 = batch0.x0[index0];
+    const float by0 = batch0.y0[index0];
+    const float bx1 = batch0.x1[index0];
+    const float by1 = batch0.y1[index0];
+    const float barea = batch0.area[index0];
+    int32_t i = begin;
+#if defined(BOX_BATCH_USE_AVX)
+    const __m256 vx0 = _mm256_set1_ps(bx0);
+    const __m256 vy0 = _mm256_set1_ps(by0);
+    const __m256 vx1 = _mm256_set1_ps(bx1);
+    const __m256 vy1 = _mm256_set1_ps(by1);
+    const __m256 varea = _mm256_set1_ps(barea);
+    const __m256 vzero = _mm256_setzero_ps();
+    for (; i + 8 <= end; i += 8) {
+        const __m256 inter_x0 = _mm256_max_ps(vx0, _mm256_loadu_ps(batch1.x0 + i));
+        const __m256 inter_y0 = _mm256_max_ps(vy0, _mm256_loadu_ps(batch1.y0 + i));
+        const __m256 inter_x1 = _mm256_min_ps(vx1, _mm256_loadu_ps(batch1.x1 + i));
+        const __m256 inter_y1 = _mm256_min_ps(vy1, _mm256_loadu_ps(batch1.y1 + i));
+        const __m256 inter_w = _mm256_max_ps(_mm256_sub_ps(inter_x1, inter_x0), vzero);
+        const __m256 inter_h = _mm256_max_ps(_mm256_sub_ps(inter_y1, inter_y0), vzero);
+        const __m256 area_inter = _mm256_mul_ps(inter_w, inter_h);
+        const __m256 area_sum = _mm256_sub_ps(_mm256_add_ps(varea, _mm256_loadu_ps(batch1.area + i)), area_inter);
+        const __m256 valid = _mm256_cmp_ps(area_sum, vzero, _CMP_GT_OQ);
+        const __m256 iou = _mm256_and_ps(_mm256_div_ps(area_inter, area_sum), valid);
+        _mm256_storeu_ps(iou_list + i - begin, iou);
+    }
+#elif defined(BOX_BATCH_USE_SSE4)
+    const __m128 vx0 = _mm_set1_ps(bx0);
+    const __m128 vy0 = _mm_set1_ps(by0);
+    const __m128 vx1 = _mm_set1_ps(bx1);
+    const __m128 vy1 = _mm_set1_ps(by1);
+    const __m128 varea = _mm_set1_ps(barea);
+    const __m128 vzero = _mm_setzero_ps();
+    for (; i + 4 <= end; i += 4) {
+        const __m128 inter_x0 = _mm_max_ps(vx0, _mm_loadu_ps(batch1.x0 + i));
+        const __m128 inter_y0 = _mm_max_ps(vy0, _mm_loadu_ps(batch1.y0 + i));
+        const __m128 inter_x1 = _mm_min_ps(vx1, _mm_loadu_ps(batch1.x1 + i));
+        const __m128 inter_y1 = _mm_min_ps(vy1, _mm_loadu_ps(batch1.y1 + i));
+        const __m128 inter_w = _mm_max_ps(_mm_sub_ps(inter_x1, inter_x0), vzero);
+        const __m128 inter_h = _mm_max_ps(_mm_sub_ps(inter_y1, inter_y0), vzero);
+        const __m128 area_inter = _mm_mul_ps(inter_w, inter_h);
+        const __m128 area_sum = _mm_sub_ps(_mm_add_ps(varea, _mm_loadu_ps(batch1.area + i)), area_inter);
+        const __m128 valid = _mm_cmpgt_ps(area_sum, vzero);
+        const __m128 iou = _mm_and_ps(_mm_div_ps(area_inter, area_sum), valid);
+        _mm_storeu_ps(iou_list + i - begin, iou);
+    }
+#elif defined(BOX_BATCH_USE_NEON)
+    const float32x4_t vx0 = vdupq_n_f32(bx0);
+    const float32x4_t vy0 = vdupq_n_f32(by0);
+    const float32x4_t vx1 = vdupq_n_f32(bx1);
+    const float32x4_t vy1 = vdupq_n_f32(by1);
+    const float32x4_t varea = vdupq_n_f32(barea);
+    const float32x4_t vzero = vdupq_n_f32(0);
+    for (; i + 4 <= end; i += 4) {
+        const float32x4_t inter_x0 = vmaxq_f32(vx0, vld1q_f32(batch1.x0 + i));
+        const float32x4_t inter_y0 = vmaxq_f32(vy0, vld1q_f32(batch1.y0 + i));
+        const float32x4_t inter_x1 = vminq_f32(vx1, vld1q_f32(batch1.x1 + i));
+        const float32x4_t inter_y1 = vminq_f32(vy1, vld1q_f32(batch1.y1 + i));
+        const float32x4_t inter_w = vmaxq_f32(vsubq_f32(inter_x1, inter_x0), vzero);
+        const float32x4_t inter_h = vmaxq_f32(vsubq_f32(inter_y1, inter_y0), vzero);
+        const float32x4_t area_inter = vmulq_f32(inter_w, inter_h);
+        const float32x4_t area_sum = vsubq_f32(vaddq_f32(varea, vld1q_f32(batch1.area + i)), area_inter);
+        const uint32x4_t valid = vcgtq_f32(area_sum, vzero);
+#if defined(__aarch64__)
+        const float32x4_t quotient = vdivq_f32(area_inter, area_sum);
+#else
+        float32x4_t reciprocal = vrecpeq_f32(area_sum);
+        reciprocal = vmulq_f32(vrecpsq_f32(area_sum, reciprocal), reciprocal);
+        reciprocal = vmulq_f32(vrecpsq_f32(area_sum, reciprocal), reciprocal);
+        const float32x4_t quotient = vmulq_f32(area_inter, reciprocal);
+#endif
+        const float32x4_t iou = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(quotient), valid));
+        vst1q_f32(iou_list + i - begin, iou);
+    }
+#endif
+    for (; i < end; i++) {
+        const float inter_w = (std::max)((std::min)(bx1, batch1.x1[i]) - (std::max)(bx0, batch1.x0[i]), 0.0f);
+        const float inter_h = (std::max)((std::min)(by1, batch1.y1[i]) - (std::max)(by0, batch1.y0[i]), 0.0f);
+        const float area_inter = inter_w * inter_h;
+        const float area_sum = barea + batch1.area[i] - area_inter;
+        iou_list[i - begin] = (area_sum > 0) ? area_inter / area_sum : 0.0f;
+    }
+}
+
+void BoundingBoxUtils::CalculateIoUMatrix(const BoxBatch& batch0, const BoxBatch& batch1, float* iou_matrix)
+{
+    const int32_t rows = batch0.Size();
+    const int32_t cols = batch1.Size();
+#pragma omp parallel for if (rows * cols > 64 * 64)
+    for (int32_t i0 = 0; i0 < rows; i0++) {
+        CalculateIoU(batch0, i0, batch1, 0, cols, iou_matrix + i0 * cols);
+    }
+}
@@ -0,0 +1,72 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef BOX_BATCH_
+#define BOX_BATCH_
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+
+#include "bounding_box.h"
+
+/* Structure of arrays of bounding boxes to calculate IoU of many boxes at once using SIMD */
+/* Each array is aligned to kAlignment bytes */
+class BoxBatch {
+public:
+    static constexpr int32_t kAlignment = 32;
+
+public:
+    BoxBatch();
+    ~BoxBatch();
+
+    void Reserve(int32_t capacity);
+    void Clear();
+    void Push(const BoundingBox& bbox);
+    void Push(float _x0, float _y0, float _x1, float _y1, float _score, int32_t _class_id);
+    void Set(const std::vector<BoundingBox>& bbox_list);
+    int32_t Size() const { return size_; }
+    int32_t Capacity() const { return capacity_; }
+
+public:
+    /* valid range is [0, Size()) */
+    float*   x0;
+    float*   y0;
+    float*   x1;
+    float*   y1;
+    float*   area;
+    float*   score;
+    int32_t* class_id;
+
+private:
+    struct AlignedDeleter {
+        void operator()(void* p) const;
+    };
+
+private:
+    std::unique_ptr<void, AlignedDeleter> buffer_;
+    int32_t size_;
+    int32_t capacity_;
+};
+
+
+namespace BoundingBoxUtils
+{
+    /* iou_list[i] = IoU(batch0[index0], batch1[begin + i]) for i in [0, end - begin) */
+    void CalculateIoU(const BoxBatch& batch0, int32_t index0, const BoxBatch& batch1, int32_t begin, int32_t end, float* iou_list);
+    /* iou_matrix[i0 * batch1.Size() + i1] = IoU(batch0[i0], batch1[i1]) */
+    void CalculateIoUMatrix(const BoxBatch& batch0, const BoxBatch& batch1, float* iou_matrix);
+}
+
+#endif
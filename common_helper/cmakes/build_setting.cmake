@@ -35,6 +35,20 @@ else()
     endif()
 endif()
 
+# SIMD for x64 (NEON is always available on aarch64). none: baseline x64 (SSE2) only, so the binary runs on any x64 CPU
+set(X64_SIMD none CACHE STRING "SIMD instruction set for x64? [none, sse4, avx2]")
+if(${BUILD_SYSTEM} STREQUAL "x64_linux")
+    if(${X64_SIMD} STREQUAL "avx2")
+        add_compile_options(-mavx2 -mfma -mf16c)
+    elseif(${X64_SIMD} STREQUAL "sse4")
+        add_compile_options(-msse4.1)
+    endif()
+elseif(${BUILD_SYSTEM} STREQUAL "x64_windows")
+    if(${X64_SIMD} STREQUAL "avx2")
+        add_compile_options(/arch:AVX2)
+    endif()
+endif()
+
 # For OpenMP
 find_package(OpenMP)
 if(OPENMP_FOUND)
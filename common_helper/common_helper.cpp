@@ -21,6 +21,9 @@ limitations under the License.
 #include <array>
 #include <algorithm>
 #include <chrono>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "common_helper.h"
 
@@ -33,6 +36,15 @@ float CommonHelper::Sigmoid(float x)
     }
 }
 
+int32_t CommonHelper::GetParallelThreadNum()
+{
+#ifdef _OPENMP
+    return omp_in_parallel() ? 1 : omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
 float CommonHelper::Logit(float x)
 {
     if (x == 0) {
@@ -49,6 +49,10 @@ float Sigmoid(float x);
 float Logit(float x);
 float SoftMaxFast(const float* src, float* dst, int32_t length);
 
+/* Number of threads which a new OpenMP parallel region would use (1 in a parallel region or without OpenMP) */
+/* Call a loop without a parallel region when this is 1. (OpenMP runtime allocates memory even for a serialized region) */
+int32_t GetParallelThreadNum();
+
 }
 
 #endif
@@ -30,6 +30,8 @@ limitations under the License.
 
 #include "common_helper.h"
 #include "common_helper_cv.h"
+#include "image_preprocess.h"
+#include "host_tensor.h"
 
 
 cv::Scalar CommonHelper::CreateCvColor(int32_t b, int32_t g, int32_t r)
@@ -60,56 +62,121 @@ void CommonHelper::CropResizeCvt(const cv::Mat& org, cv::Mat& dst, int32_t& crop
 {
     const int32_t interpolation_flag = resize_by_linear ? cv::INTER_LINEAR : cv::INTER_NEAREST;
 
-    cv::Mat src = org(cv::Rect(crop_x, crop_y, crop_w, crop_h));
-
-    if (crop_type == kCropTypeStretch) {
-        cv::resize(src, dst, dst.size(), 0, 0, interpolation_flag);
-    } else if (crop_type == kCropTypeCut) {
-        float aspect_ratio_src = static_cast<float>(src.cols) / src.rows;
-        float aspect_ratio_dst = static_cast<float>(dst.cols) / dst.rows;
-        cv::Rect target_rect(0, 0, src.cols, src.rows);
-        if (aspect_ratio_src > aspect_ratio_dst) {
-            target_rect.width = static_cast<int32_t>(src.rows * aspect_ratio_dst);
-            target_rect.x = (src.cols - target_rect.width) / 2;
-        } else {
-            target_rect.height = static_cast<int32_t>(src.cols / aspect_ratio_dst);
-            target_rect.y = (src.rows - target_rect.height) / 2;
-        }
-        cv::Mat target = src(target_rect);
-        cv::resize(target, dst, dst.size(), 0, 0, interpolation_flag);
-        crop_x += target_rect.x;
-        crop_y += target_rect.y;
-        crop_w = target_rect.width;
-        crop_h = target_rect.height;
+    ImageRect src_rect;
+    ImageRect target_rect;
+    CalculateCropResizeArea(dst.cols, dst.rows, crop_type, crop_x, crop_y, crop_w, crop_h, src_rect, target_rect);
+    cv::Mat src = org(cv::Rect(src_rect.x, src_rect.y, src_rect.width, src_rect.height));
+
+#ifdef CV_COLOR_IS_RGB
+    const bool swap_color = !is_rgb;
+#else
+    const bool swap_color = is_rgb;
+#endif
+
+    cv::Mat target = dst(cv::Rect(target_rect.x, target_rect.y, target_rect.width, target_rect.height));
+    if (swap_color) {
+        /* Don't call cvtColor in-place because it clones the image. The work buffer is re-allocated only when the size changes */
+        static thread_local cv::Mat s_mat_resized;
+        cv::resize(src, s_mat_resized, target.size(), 0, 0, interpolation_flag);
+        cv::cvtColor(s_mat_resized, target, cv::COLOR_BGR2RGB);
     } else {
-        float aspect_ratio_src = static_cast<float>(src.cols) / src.rows;
-        float aspect_ratio_dst = static_cast<float>(dst.cols) / dst.rows;
-        cv::Rect target_rect(0, 0, dst.cols, dst.rows);
-        if (aspect_ratio_src > aspect_ratio_dst) {
-            target_rect.height = static_cast<int32_t>(target_rect.width / aspect_ratio_src);
-            target_rect.y = (dst.rows - target_rect.height) / 2;
-        } else {
-            target_rect.width = static_cast<int32_t>(target_rect.height * aspect_ratio_src);
-            target_rect.x = (dst.cols - target_rect.width) / 2;
-        }
-        cv::Mat target = dst(target_rect);
         cv::resize(src, target, target.size(), 0, 0, interpolation_flag);
-        crop_x -= target_rect.x * crop_w / target_rect.width;
-        crop_y -= target_rect.y * crop_h / target_rect.height;
-        crop_w = dst.cols * crop_w / target_rect.width;
-        crop_h = dst.rows * crop_h / target_rect.height;
     }
+}
 
+static bool CropResizeNormalizeNchwCv(const cv::Mat& org, void* dst, int32_t host_tensor_type, CommonHelper::ResizePlan& plan, int32_t dst_w, int32_t dst_h, int32_t& crop_x, int32_t& crop_y, int32_t& crop_w, int32_t& crop_h, const float mean[3], const float norm[3], bool is_rgb, int32_t crop_type)
+{
 #ifdef CV_COLOR_IS_RGB
-    if (!is_rgb) {
-        cv::cvtColor(dst, dst, cv::COLOR_RGB2BGR);
-    }
+    const bool swap_color = !is_rgb;
 #else
-    if (is_rgb) {
-        cv::cvtColor(dst, dst, cv::COLOR_BGR2RGB);
-    }
+    const bool swap_color = is_rgb;
 #endif
+    if (org.type() != CV_8UC3) return false;   /* the plan reads 3-channel uint8 */
+    if (!plan.IsSame(dst_w, dst_h, crop_x, crop_y, crop_w, crop_h, crop_type, mean, norm, swap_color)) {
+        plan.Create(dst_w, dst_h, crop_x, crop_y, crop_w, crop_h, crop_type, mean, norm, swap_color);
+    }
+    plan.Apply(org.data, static_cast<int32_t>(org.step[0]), dst, host_tensor_type);
+    plan.GetCropArea(crop_x, crop_y, crop_w, crop_h);
+    return true;
+}
+
+bool CommonHelper::CropResizeNormalizeNchw(const cv::Mat& org, float* dst, int32_t dst_w, int32_t dst_h, int32_t& crop_x, int32_t& crop_y, int32_t& crop_w, int32_t& crop_h, const float mean[3], const float norm[3], bool is_rgb, int32_t crop_type)
+{
+    /* The plan is re-created only when the geometry changes. Padding is always written because dst may be used by others */
+    static thread_local ResizePlan s_plan;
+    s_plan.ResetPadding();
+    return CropResizeNormalizeNchwCv(org, dst, CommonHelper::kHostTensorTypeFp32, s_plan, dst_w, dst_h, crop_x, crop_y, crop_w, crop_h, mean, norm, is_rgb, crop_type);
+}
+
+bool CommonHelper::CropResizeNormalizeNchw(const cv::Mat& org, uint16_t* dst, int32_t dst_w, int32_t dst_h, int32_t& crop_x, int32_t& crop_y, int32_t& crop_w, int32_t& crop_h, const float mean[3], const float norm[3], bool is_rgb, int32_t crop_type)
+{
+    static thread_local ResizePlan s_plan;
+    s_plan.ResetPadding();
+    return CropResizeNormalizeNchwCv(org, dst, CommonHelper::kHostTensorTypeFp16, s_plan, dst_w, dst_h, crop_x, crop_y, crop_w, crop_h, mean, norm, is_rgb, crop_type);
+}
+
+bool CommonHelper::CropResizeNormalizeNchw(const cv::Mat& org, float* dst, ResizePlan& plan, int32_t dst_w, int32_t dst_h, int32_t& crop_x, int32_t& crop_y, int32_t& crop_w, int32_t& crop_h, const float mean[3], const float norm[3], bool is_rgb, int32_t crop_type)
+{
+    return CropResizeNormalizeNchwCv(org, dst, CommonHelper::kHostTensorTypeFp32, plan, dst_w, dst_h, crop_x, crop_y, crop_w, crop_h, mean, norm, is_rgb, crop_type);
+}
 
+bool CommonHelper::CropResizeNormalizeNchw(const cv::Mat& org, uint16_t* dst, ResizePlan& plan, int32_t dst_w, int32_t dst_h, int32_t& crop_x, int32_t& crop_y, int32_t& crop_w, int32_t& crop_h, const float mean[3], const float norm[3], bool is_rgb, int32_t crop_type)
+{
+    return CropResizeNormalizeNchwCv(org, dst, CommonHelper::kHostTensorTypeFp16, plan, dst_w, dst_h, crop_x, crop_y, crop_w, crop_h, mean, norm, is_rgb, crop_type);
+}
+
+bool CommonHelper::CropResizeNormalizeNchw(const cv::Mat& org, void* dst, int32_t host_tensor_type, ResizePlan& plan, int32_t dst_w, int32_t dst_h, int32_t& crop_x, int32_t& crop_y, int32_t& crop_w, int32_t& crop_h, const float mean[3], const float norm[3], bool is_rgb, int32_t crop_type)
+{
+    return CropResizeNormalizeNchwCv(org, dst, host_tensor_type, plan, dst_w, dst_h, crop_x, crop_y, crop_w, crop_h, mean, norm, is_rgb, crop_type);
+}
+
+void CommonHelper::CreateTileList(int32_t image_width, int32_t image_height, int32_t tile_num_x, int32_t tile_num_y, float overlap_ratio, std::vector<cv::Rect>& tile_list)
+{
+    tile_list.clear();
+    tile_num_x = (std::max)(1, tile_num_x);
+    tile_num_y = (std::max)(1, tile_num_y);
+    overlap_ratio = (std::min)((std::max)(0.0f, overlap_ratio), 0.9f);
+
+    /* image_size = tile_size * tile_num - tile_size * overlap_ratio * (tile_num - 1) */
+    const int32_t tile_w = (std::min)(image_width, static_cast<int32_t>(std::ceil(image_width / (tile_num_x - overlap_ratio * (tile_num_x - 1)))));
+    const int32_t tile_h = (std::min)(image_height, static_cast<int32_t>(std::ceil(image_height / (tile_num_y - overlap_ratio * (tile_num_y - 1)))));
+    for (int32_t y = 0; y < tile_num_y; y++) {
+        for (int32_t x = 0; x < tile_num_x; x++) {
+            /* place the last tile at the right/bottom edge to cover the whole image */
+            const int32_t tile_x = (tile_num_x > 1) ? (image_width - tile_w) * x / (tile_num_x - 1) : 0;
+            const int32_t tile_y = (tile_num_y > 1) ? (image_height - tile_h) * y / (tile_num_y - 1) : 0;
+            tile_list.push_back(cv::Rect(tile_x, tile_y, tile_w, tile_h));
+        }
+    }
+}
+
+void CommonHelper::ConvertToBlobNchw(const cv::Mat& src, float* dst, const float mean[3], const float norm[3])
+{
+    const int32_t image_size = src.cols * src.rows;
+    float scale[3];
+    float bias[3];
+    for (int32_t c = 0; c < 3; c++) {
+        scale[c] = 1.0f / (255.0f * norm[c]);
+        bias[c] = -mean[c] / norm[c];
+    }
+    /* Rows are split among threads (only 3 planes are not enough to use all cores) */
+    auto process_row = [&](int32_t y) {
+        const uint8_t* src_row = src.ptr<uint8_t>(y);
+        float* d0 = dst + y * src.cols;
+        float* d1 = d0 + image_size;
+        float* d2 = d1 + image_size;
+        for (int32_t x = 0; x < src.cols; x++) {
+            d0[x] = src_row[x * 3 + 0] * scale[0] + bias[0];
+            d1[x] = src_row[x * 3 + 1] * scale[1] + bias[1];
+            d2[x] = src_row[x * 3 + 2] * scale[2] + bias[2];
+        }
+    };
+    if (GetParallelThreadNum() > 1) {
+#pragma omp parallel for
+        for (int32_t y = 0; y < src.rows; y++) process_row(y);
+    } else {
+        for (int32_t y = 0; y < src.rows; y++) process_row(y);
+    }
 }
 
 /* https://github.com/JetsonHacksNano/CSI-Camera/blob/master/simple_camera.cpp */
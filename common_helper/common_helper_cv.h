@@ -24,16 +24,13 @@ limitations under the License.
 /* for OpenCV */
 #include <opencv2/opencv.hpp>
 
+/* for My modules */
+#include "image_preprocess.h"
+#include "host_tensor.h"
+
 
 namespace CommonHelper
 {
-enum {
-    kCropTypeStretch = 0,
-    kCropTypeCut,
-    kCropTypeExpand,
-};
-
-
 cv::Scalar CreateCvColor(int32_t b, int32_t g, int32_t r);
 void DrawText(cv::Mat& mat, const std::string& text, cv::Point pos, double font_scale, int32_t thickness, cv::Scalar color_front, cv::Scalar color_back, bool is_text_on_rect = true);
 void CropResizeCvt(const cv::Mat& org, cv::Mat& dst, int32_t& crop_x, int32_t& crop_y, int32_t& crop_w, int32_t& crop_h, bool is_rgb = true, int32_t crop_type = kCropTypeStretch, bool resize_by_linear = true);
@@ -43,6 +40,21 @@ bool InputKeyCommand(cv::VideoCapture& cap);
 cv::Mat CombineMat1to3(const cv::Mat& mat0, const cv::Mat& mat1, const cv::Mat& mat2);
 cv::Mat CombineMat1to3(int32_t rows, int32_t cols, float* data0, float* data1, float* data2);
 
+/* Split the image into tile_num_x * tile_num_y tiles overlapping each other by overlap_ratio (0.0 - 1.0) of the tile size */
+void CreateTileList(int32_t image_width, int32_t image_height, int32_t tile_num_x, int32_t tile_num_y, float overlap_ratio, std::vector<cv::Rect>& tile_list);
+/* Convert 3-channel uint8 image (HWC) to float blob (CHW): dst = (src / 255 - mean) / norm (the same as InferenceHelper) */
+void ConvertToBlobNchw(const cv::Mat& src, float* dst, const float mean[3], const float norm[3]);
+/* CropResizeCvt + ConvertToBlobNchw in one pass, without intermediate image. dst is a dst_w x dst_h x 3 blob (float or fp16) */
+/* Padding area for kCropTypeExpand is also written, so dst doesn't need to be cleared. Return false without writing dst if org is not 3-channel uint8 */
+bool CropResizeNormalizeNchw(const cv::Mat& org, float* dst, int32_t dst_w, int32_t dst_h, int32_t& crop_x, int32_t& crop_y, int32_t& crop_w, int32_t& crop_h, const float mean[3], const float norm[3], bool is_rgb = true, int32_t crop_type = kCropTypeStretch);
+bool CropResizeNormalizeNchw(const cv::Mat& org, uint16_t* dst, int32_t dst_w, int32_t dst_h, int32_t& crop_x, int32_t& crop_y, int32_t& crop_w, int32_t& crop_h, const float mean[3], const float norm[3], bool is_rgb = true, int32_t crop_type = kCropTypeStretch);
+/* The same as above, but the plan (tables for the geometry) is kept by the caller and re-created only when the parameters change */
+/* Padding is written only at the first call for each dst, so use one plan for each dst buffer. (e.g. for each batch) */
+bool CropResizeNormalizeNchw(const cv::Mat& org, float* dst, ResizePlan& plan, int32_t dst_w, int32_t dst_h, int32_t& crop_x, int32_t& crop_y, int32_t& crop_w, int32_t& crop_h, const float mean[3], const float norm[3], bool is_rgb = true, int32_t crop_type = kCropTypeStretch);
+bool CropResizeNormalizeNchw(const cv::Mat& org, uint16_t* dst, ResizePlan& plan, int32_t dst_w, int32_t dst_h, int32_t& crop_x, int32_t& crop_y, int32_t& crop_w, int32_t& crop_h, const float mean[3], const float norm[3], bool is_rgb = true, int32_t crop_type = kCropTypeStretch);
+/* dst is a blob of host_tensor_type (kHostTensorType*). Quantization of uint8 is set to the plan by ResizePlan::SetQuantization */
+bool CropResizeNormalizeNchw(const cv::Mat& org, void* dst, int32_t host_tensor_type, ResizePlan& plan, int32_t dst_w, int32_t dst_h, int32_t& crop_x, int32_t& crop_y, int32_t& crop_w, int32_t& crop_h, const float mean[3], const float norm[3], bool is_rgb = true, int32_t crop_type = kCropTypeStretch);
+
 
 class NiceColorGenerator
 {
@@ -0,0 +1,201 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/* for general */
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* for My modules */
+#include "common_helper.h"
+#include "bounding_box.h"
+#include "detection_trace.h"
+
+/*** Macro ***/
+#define TAG "DetectionTrace"
+#define PRINT(...)   COMMON_HELPER_PRINT(TAG, __VA_ARGS__)
+#define PRINT_E(...) COMMON_HELPER_PRINT_E(TAG, __VA_ARGS__)
+
+static_assert(sizeof(DetectionTrace::FileHeader) % 8 == 0, "Record size must be multiple of 8");
+static_assert(sizeof(DetectionTrace::FrameHeader) % 8 == 0, "Record size must be multiple of 8");
+static_assert(sizeof(BoundingBox) % 8 == 0, "Record size must be multiple of 8");
+
+
+DetectionTraceWriter::DetectionTraceWriter()
+    : fp_(nullptr)
+{
+}
+
+DetectionTraceWriter::~DetectionTraceWriter()
+{
+    Close();
+}
+
+int32_t DetectionTraceWriter::Open(const std::string& filename)
+{
+    Close();
+    fp_ = fopen(filename.c_str(), "wb");
+    if (!fp_) {
+        PRINT_E("Failed to open %s\n", filename.c_str());
+        return DetectionTrace::kRetErr;
+    }
+    DetectionTrace::FileHeader header;
+    header.magic = DetectionTrace::kMagic;
+    header.version = DetectionTrace::kVersion;
+    header.bbox_size = static_cast<uint32_t>(sizeof(BoundingBox));
+    header.reserved = 0;
+    if (fwrite(&header, sizeof(header), 1, fp_) != 1) {
+        Close();
+        return DetectionTrace::kRetErr;
+    }
+    return DetectionTrace::kRetOk;
+}
+
+void DetectionTraceWriter::Close()
+{
+    if (fp_) {
+        fclose(fp_);
+        fp_ = nullptr;
+    }
+}
+
+bool DetectionTraceWriter::IsOpened() const
+{
+    return fp_ != nullptr;
+}
+
+int32_t DetectionTraceWriter::Write(double timestamp, int32_t crop_x, int32_t crop_y, int32_t crop_w, int32_t crop_h, const std::vector<BoundingBox>& bbox_list)
+{
+    if (!fp_) return DetectionTrace::kRetErr;
+    DetectionTrace::FrameHeader header;
+    header.timestamp = timestamp;
+    header.crop_x = crop_x;
+    header.crop_y = crop_y;
+    header.crop_w = crop_w;
+    header.crop_h = crop_h;
+    header.bbox_num = static_cast<int32_t>(bbox_list.size());
+    header.reserved = 0;
+    if (fwrite(&header, sizeof(header), 1, fp_) != 1) return DetectionTrace::kRetErr;
+    if (!bbox_list.empty() && fwrite(bbox_list.data(), sizeof(BoundingBox), bbox_list.size(), fp_) != bbox_list.size()) return DetectionTrace::kRetErr;
+    return DetectionTrace::kRetOk;
+}
+
+
+DetectionTraceReader::DetectionTraceReader()
+    : data_(nullptr), size_(0)
+#ifdef _WIN32
+    , file_handle_(INVALID_HANDLE_VALUE), mapping_handle_(nullptr)
+#endif
+{
+}
+
+DetectionTraceReader::~DetectionTraceReader()
+{
+    Close();
+}
+
+int32_t DetectionTraceReader::Open(const std::string& filename)
+{
+    Close();
+#ifdef _WIN32
+    HANDLE file_handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        PRINT_E("Failed to open %s\n", filename.c_str());
+        return DetectionTrace::kRetErr;
+    }
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file_handle, &file_size);
+    file_handle_ = file_handle;
+    size_ = static_cast<size_t>(file_size.QuadPart);
+    if (size_ > 0) {
+        mapping_handle_ = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_handle_) data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+    }
+#else
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        PRINT_E("Failed to open %s\n", filename.c_str());
+        return DetectionTrace::kRetErr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        size_ = static_cast<size_t>(st.st_size);
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        data_ = (data == MAP_FAILED) ? nullptr : static_cast<const uint8_t*>(data);
+    }
+    close(fd);  /* the mapping is valid after close */
+#endif
+    if (!data_ || size_ < sizeof(DetectionTrace::FileHeader)) {
+        PRINT_E("Failed to map %s\n", filename.c_str());
+        Close();
+        return DetectionTrace::kRetErr;
+    }
+
+    const DetectionTrace::FileHeader* header = reinterpret_cast<const DetectionTrace::FileHeader*>(data_);
+    if (header->magic != DetectionTrace::kMagic || header->version != DetectionTrace::kVersion || header->bbox_size != sizeof(BoundingBox)) {
+        PRINT_E("Invalid trace file %s\n", filename.c_str());
+        Close();
+        return DetectionTrace::kRetErr;
+    }
+
+    /* Index of frames. A broken record at the end (e.g. recording was killed) is ignored */
+    size_t offset = sizeof(DetectionTrace::FileHeader);
+    while (offset + sizeof(DetectionTrace::FrameHeader) <= size_) {
+        const DetectionTrace::FrameHeader* frame_header = reinterpret_cast<const DetectionTrace::FrameHeader*>(data_ + offset);
+        const size_t record_size = sizeof(DetectionTrace::FrameHeader) + sizeof(BoundingBox) * frame_header->bbox_num;
+        if (frame_header->bbox_num < 0 || offset + record_size > size_) break;
+        frame_offset_list_.push_back(offset);
+        offset += record_size;
+    }
+    return DetectionTrace::kRetOk;
+}
+
+void DetectionTraceReader::Close()
+{
+#ifdef _WIN32
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_handle_) CloseHandle(mapping_handle_);
+    if (file_handle_ != INVALID_HANDLE_VALUE) CloseHandle(file_handle_);
+    mapping_handle_ = nullptr;
+    file_handle_ = INVALID_HANDLE_VALUE;
+#else
+    if (data_) munmap(const_cast<uint8_t*>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    frame_offset_list_.clear();
+}
+
+int32_t DetectionTraceReader::GetFrameNum() const
+{
+    return static_cast<int32_t>(frame_offset_list_.size());
+}
+
+DetectionTrace::Frame DetectionTraceReader::GetFrame(int32_t index) const
+{
+    const uint8_t* record = data_ + frame_offset_list_[index];
+    DetectionTrace::Frame frame;
+    frame.header = reinterpret_cast<const DetectionTrace::FrameHeader*>(record);
+    frame.bbox_list = reinterpret_cast<const BoundingBox*>(record + sizeof(DetectionTrace::FrameHeader));
+    return frame;
+}
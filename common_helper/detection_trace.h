@@ -0,0 +1,105 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef DETECTION_TRACE_
+#define DETECTION_TRACE_
+
+/* for general */
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/* for My modules */
+#include "bounding_box.h"
+
+/* Binary trace of detection results (post-NMS bbox list of each frame) to replay tracker offline */
+/* File layout (native byte order):                                                              */
+/*   FileHeader, then for each frame: FrameHeader, BoundingBox x bbox_num                        */
+/* All records are multiple of 8 bytes, so BoundingBox in a mapped file can be read in place      */
+namespace DetectionTrace
+{
+    enum {
+        kRetOk = 0,
+        kRetErr = -1,
+    };
+
+    static constexpr uint32_t kMagic = 0x43525444;  /* "DTRC" */
+    static constexpr uint32_t kVersion = 1;
+
+    typedef struct FileHeader_ {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t bbox_size;         /* sizeof(BoundingBox) when recorded */
+        uint32_t reserved;
+    } FileHeader;
+
+    typedef struct FrameHeader_ {
+        double  timestamp;          /* [sec]. negative value means no timestamp (one frame interval) */
+        int32_t crop_x;             /* area of the image used for detection */
+        int32_t crop_y;
+        int32_t crop_w;
+        int32_t crop_h;
+        int32_t bbox_num;
+        int32_t reserved;
+    } FrameHeader;
+
+    typedef struct Frame_ {
+        const FrameHeader* header;
+        const BoundingBox* bbox_list;   /* points into the mapped file */
+    } Frame;
+}
+
+
+class DetectionTraceWriter {
+public:
+    DetectionTraceWriter();
+    ~DetectionTraceWriter();
+    DetectionTraceWriter(const DetectionTraceWriter&) = delete;
+    DetectionTraceWriter& operator=(const DetectionTraceWriter&) = delete;
+
+    int32_t Open(const std::string& filename);
+    void Close();
+    bool IsOpened() const;
+    int32_t Write(double timestamp, int32_t crop_x, int32_t crop_y, int32_t crop_w, int32_t crop_h, const std::vector<BoundingBox>& bbox_list);
+
+private:
+    FILE* fp_;
+};
+
+
+/* The file is mapped to memory, and frames are read without copy */
+class DetectionTraceReader {
+public:
+    DetectionTraceReader();
+    ~DetectionTraceReader();
+    DetectionTraceReader(const DetectionTraceReader&) = delete;
+    DetectionTraceReader& operator=(const DetectionTraceReader&) = delete;
+
+    int32_t Open(const std::string& filename);
+    void Close();
+    int32_t GetFrameNum() const;
+    DetectionTrace::Frame GetFrame(int32_t index) const;
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    std::vector<size_t> frame_offset_list_;
+#ifdef _WIN32
+    void* file_handle_;
+    void* mapping_handle_;
+#endif
+};
+
+#endif
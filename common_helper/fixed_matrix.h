@@ -0,0 +1,172 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef FIXED_MATRIX_
+#define FIXED_MATRIX_
+
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <initializer_list>
+
+/* Matrix whose size is decided at compile time. Data is stored in the object itself (no heap allocation, trivially copyable) */
+/* Shape mismatch is a compile error, so there is no runtime check unlike SimpleMatrix */
+template <int32_t R, int32_t C, typename T = double>
+class FixedMatrix
+{
+public:
+    static constexpr int32_t rows = R;
+    static constexpr int32_t cols = C;
+
+public:
+    FixedMatrix() = default;
+
+    /* Row major. Missing elements are filled with 0 */
+    FixedMatrix(std::initializer_list<T> data_list)
+    {
+        int32_t i = 0;
+        for (const auto& value : data_list) {
+            if (i >= R * C) break;
+            data_array[i++] = value;
+        }
+        for (; i < R * C; i++) data_array[i] = 0;
+    }
+
+    T& operator() (int32_t y, int32_t x) { return data_array[y * C + x]; }
+    const T& operator() (int32_t y, int32_t x) const { return data_array[y * C + x]; }
+
+    FixedMatrix operator+ (const FixedMatrix& mat2) const
+    {
+        FixedMatrix ret;
+        for (int32_t i = 0; i < R * C; i++) ret.data_array[i] = data_array[i] + mat2.data_array[i];
+        return ret;
+    }
+
+    FixedMatrix operator- (const FixedMatrix& mat2) const
+    {
+        FixedMatrix ret;
+        for (int32_t i = 0; i < R * C; i++) ret.data_array[i] = data_array[i] - mat2.data_array[i];
+        return ret;
+    }
+
+    template <int32_t C2>
+    FixedMatrix<R, C2, T> operator* (const FixedMatrix<C, C2, T>& mat2) const
+    {
+        FixedMatrix<R, C2, T> ret;
+        for (int32_t y = 0; y < R; y++) {
+            for (int32_t x = 0; x < C2; x++) {
+                T sum = 0;
+                for (int32_t i = 0; i < C; i++) {
+                    sum += (*this)(y, i) * mat2(i, x);
+                }
+                ret(y, x) = sum;
+            }
+        }
+        return ret;
+    }
+
+    FixedMatrix operator* (const T& k) const
+    {
+        FixedMatrix ret;
+        for (int32_t i = 0; i < R * C; i++) ret.data_array[i] = data_array[i] * k;
+        return ret;
+    }
+
+    FixedMatrix<C, R, T> Transpose() const
+    {
+        FixedMatrix<C, R, T> ret;
+        for (int32_t y = 0; y < R; y++) {
+            for (int32_t x = 0; x < C; x++) {
+                ret(x, y) = (*this)(y, x);
+            }
+        }
+        return ret;
+    }
+
+    void Display() const
+    {
+        for (int32_t y = 0; y < R; y++) {
+            for (int32_t x = 0; x < C; x++) {
+                printf("%f ", static_cast<double>((*this)(y, x)));
+            }
+            printf("\n");
+        }
+    }
+
+    static FixedMatrix Zeros()
+    {
+        FixedMatrix ret;
+        for (int32_t i = 0; i < R * C; i++) ret.data_array[i] = 0;
+        return ret;
+    }
+
+    static FixedMatrix IdentityMatrix()
+    {
+        static_assert(R == C, "IdentityMatrix must be square");
+        FixedMatrix ret = Zeros();
+        for (int32_t i = 0; i < R; i++) ret(i, i) = 1;
+        return ret;
+    }
+
+public:
+    T data_array[R * C];
+};
+
+template <int32_t R, int32_t C, typename T>
+constexpr int32_t FixedMatrix<R, C, T>::rows;
+template <int32_t R, int32_t C, typename T>
+constexpr int32_t FixedMatrix<R, C, T>::cols;
+
+
+namespace FixedMatrixUtils
+{
+    /* Solve A * X = B for symmetric positive definite A using Cholesky decomposition (A = L * L^T) */
+    /* Return false if A is not positive definite. (X is not modified) */
+    template <int32_t N, int32_t M, typename T>
+    bool SolveCholesky(const FixedMatrix<N, N, T>& A, const FixedMatrix<N, M, T>& B, FixedMatrix<N, M, T>& X)
+    {
+        FixedMatrix<N, N, T> L = FixedMatrix<N, N, T>::Zeros();
+        for (int32_t y = 0; y < N; y++) {
+            for (int32_t x = 0; x <= y; x++) {
+                T sum = A(y, x);
+                for (int32_t k = 0; k < x; k++) sum -= L(y, k) * L(x, k);
+                if (y == x) {
+                    if (!(sum > 0)) return false;
+                    L(y, y) = std::sqrt(sum);
+                } else {
+                    L(y, x) = sum / L(x, x);
+                }
+            }
+        }
+
+        for (int32_t m = 0; m < M; m++) {
+            /* Forward substitution: L * Y = B */
+            T Y[N];
+            for (int32_t y = 0; y < N; y++) {
+                T sum = B(y, m);
+                for (int32_t k = 0; k < y; k++) sum -= L(y, k) * Y[k];
+                Y[y] = sum / L(y, y);
+            }
+            /* Backward substitution: L^T * X = Y */
+            for (int32_t y = N - 1; y >= 0; y--) {
+                T sum = Y[y];
+                for (int32_t k = y + 1; k < N; k++) sum -= L(k, y) * X(k, m);
+                X(y, m) = sum / L(y, y);
+            }
+        }
+        return true;
+    }
+}
+
+#endif
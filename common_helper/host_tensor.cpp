@@ -0,0 +1,257 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+/* for SIMD */
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#include <immintrin.h>
+#define HOST_TENSOR_USE_F16C
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HOST_TENSOR_USE_SSE2
+#elif defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define HOST_TENSOR_USE_NEON
+#endif
+
+/* for My modules */
+#include "image_preprocess.h"
+#include "host_tensor.h"
+
+/*** Function ***/
+int32_t CommonHelper::GetHostTensorElementSize(int32_t type)
+{
+    switch (type) {
+    case kHostTensorTypeFp16:
+        return 2;
+    case kHostTensorTypeUint8:
+        return 1;
+    case kHostTensorTypeFp32:
+    default:
+        return 4;
+    }
+}
+
+/* http://fgiesen.wordpress.com/2012/03/28/half-to-float-done-quic/ (half_to_float_fast4) */
+float CommonHelper::ConvertHalfToFloat(uint16_t value)
+{
+    static constexpr uint32_t kShiftedExp = 0x7C00 << 13;
+    static constexpr uint32_t kMagic = 113 << 23;
+    uint32_t f = (value & 0x7FFF) << 13;
+    const uint32_t exp = kShiftedExp & f;
+    f += static_cast<uint32_t>(127 - 15) << 23;
+    if (exp == kShiftedExp) {
+        /* inf or NaN. NaN to quiet NaN (the same as F16C and NEON) */
+        f += static_cast<uint32_t>(128 - 16) << 23;
+        if (value & 0x3FF) f |= 0x00400000;
+    } else if (exp == 0) {
+        /* zero or subnormal: renormalize by the FPU */
+        f += 1 << 23;
+        float tmp;
+        float magic;
+        std::memcpy(&tmp, &f, sizeof(tmp));
+        std::memcpy(&magic, &kMagic, sizeof(magic));
+        tmp -= magic;
+        std::memcpy(&f, &tmp, sizeof(f));
+    }
+    f |= static_cast<uint32_t>(value & 0x8000) << 16;
+    float ret;
+    std::memcpy(&ret, &f, sizeof(ret));
+    return ret;
+}
+
+#if defined(HOST_TENSOR_USE_SSE2)
+/* The same results as the scalar functions (http://fgiesen.wordpress.com/2012/03/28/half-to-float-done-quic/) */
+/* h: half in the lower 16 bits of each 32-bit lane */
+static inline __m128 ConvertHalfToFloatSse2(__m128i h)
+{
+    const __m128i expmant = _mm_and_si128(h, _mm_set1_epi32(0x7FFF));
+    const __m128i justsign = _mm_xor_si128(h, expmant);
+    /* subnormal is normalized by the multiplication. exponent of inf / NaN is set separately */
+    const __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expmant, 13)), _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23)));
+    const __m128i is_infnan = _mm_cmpgt_epi32(expmant, _mm_set1_epi32(0x7BFF));
+    const __m128i is_nan = _mm_cmpgt_epi32(expmant, _mm_set1_epi32(0x7C00));
+    const __m128 infnan_exp = _mm_or_ps(_mm_and_ps(_mm_castsi128_ps(is_infnan), _mm_castsi128_ps(_mm_set1_epi32(255 << 23))),
+        _mm_and_ps(_mm_castsi128_ps(is_nan), _mm_castsi128_ps(_mm_set1_epi32(0x00400000))));
+    const __m128 sign = _mm_castsi128_ps(_mm_slli_epi32(justsign, 16));
+    return _mm_or_ps(scaled, _mm_or_ps(sign, infnan_exp));
+}
+
+/* Round to nearest even. The result is sign extended to 32 bits so that it can be packed by _mm_packs_epi32 */
+static inline __m128i ConvertFloatToHalfSse2(__m128 f)
+{
+    const __m128 justsign = _mm_and_ps(f, _mm_castsi128_ps(_mm_set1_epi32(static_cast<int32_t>(0x80000000u))));
+    const __m128 absf = _mm_xor_ps(f, justsign);
+    const __m128i absf_int = _mm_castps_si128(absf);
+    const __m128i is_regular = _mm_cmpgt_epi32(_mm_set1_epi32((127 + 16) << 23), absf_int);
+    /* NaN keeps the upper bits of the payload */
+    const __m128i nan_mant = _mm_or_si128(_mm_set1_epi32(0x200), _mm_and_si128(_mm_srli_epi32(absf_int, 13), _mm_set1_epi32(0x3FF)));
+    const __m128i inf_or_nan = _mm_or_si128(_mm_and_si128(_mm_castps_si128(_mm_cmpunord_ps(absf, absf)), nan_mant), _mm_set1_epi32(0x7C00));
+    const __m128i is_subnormal = _mm_cmpgt_epi32(_mm_set1_epi32((127 - 14) << 23), absf_int);
+
+    /* subnormal: rounded by the float addition of the magic value */
+    const __m128i subnormal_magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+    const __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absf, _mm_castsi128_ps(subnormal_magic))), subnormal_magic);
+
+    /* normal: rebias exponent and round */
+    const __m128i mant_odd = _mm_srai_epi32(_mm_slli_epi32(absf_int, 31 - 13), 31);
+    const __m128i rounded = _mm_sub_epi32(_mm_add_epi32(absf_int, _mm_set1_epi32(0xFFF - ((127 - 15) << 23))), mant_odd);
+    const __m128i normal = _mm_srli_epi32(rounded, 13);
+
+    const __m128i nonspecial = _mm_or_si128(_mm_and_si128(subnormal, is_subnormal), _mm_andnot_si128(is_subnormal, normal));
+    const __m128i joined = _mm_or_si128(_mm_and_si128(nonspecial, is_regular), _mm_andnot_si128(is_regular, inf_or_nan));
+    return _mm_or_si128(joined, _mm_srai_epi32(_mm_castps_si128(justsign), 16));
+}
+#endif
+
+void CommonHelper::ConvertFloatToHalf(const float* src, uint16_t* dst, int32_t num)
+{
+    int32_t i = 0;
+#if defined(HOST_TENSOR_USE_F16C)
+    for (; i + 8 <= num; i += 8) {
+        const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+    }
+#elif defined(HOST_TENSOR_USE_SSE2)
+    for (; i + 8 <= num; i += 8) {
+        const __m128i h0 = ConvertFloatToHalfSse2(_mm_loadu_ps(src + i));
+        const __m128i h1 = ConvertFloatToHalfSse2(_mm_loadu_ps(src + i + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(h0, h1));
+    }
+#elif defined(HOST_TENSOR_USE_NEON)
+    for (; i + 4 <= num; i += 4) {
+        const float16x4_t h = vcvt_f16_f32(vld1q_f32(src + i));
+        vst1_u16(dst + i, vreinterpret_u16_f16(h));
+    }
+#endif
+    for (; i < num; i++) {
+        dst[i] = ConvertFloatToHalf(src[i]);
+    }
+}
+
+void CommonHelper::ConvertHalfToFloat(const uint16_t* src, float* dst, int32_t num)
+{
+    int32_t i = 0;
+#if defined(HOST_TENSOR_USE_F16C)
+    for (; i + 8 <= num; i += 8) {
+        const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+    }
+#elif defined(HOST_TENSOR_USE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= num; i += 8) {
+        const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_ps(dst + i, ConvertHalfToFloatSse2(_mm_unpacklo_epi16(h, zero)));
+        _mm_storeu_ps(dst + i + 4, ConvertHalfToFloatSse2(_mm_unpackhi_epi16(h, zero)));
+    }
+#elif defined(HOST_TENSOR_USE_NEON)
+    for (; i + 4 <= num; i += 4) {
+        const float16x4_t h = vreinterpret_f16_u16(vld1_u16(src + i));
+        vst1q_f32(dst + i, vcvt_f32_f16(h));
+    }
+#endif
+    for (; i < num; i++) {
+        dst[i] = ConvertHalfToFloat(src[i]);
+    }
+}
+
+void CommonHelper::QuantizeToUint8(const float* src, uint8_t* dst, int32_t num, float scale, int32_t zero_point)
+{
+    const float inv_scale = 1.0f / scale;
+    for (int32_t i = 0; i < num; i++) {
+        const int32_t q = static_cast<int32_t>(std::nearbyint(src[i] * inv_scale)) + zero_point;
+        dst[i] = static_cast<uint8_t>((std::min)((std::max)(q, 0), 255));
+    }
+}
+
+void CommonHelper::DequantizeUint8(const uint8_t* src, float* dst, int32_t num, float scale, int32_t zero_point)
+{
+    int32_t i = 0;
+#if defined(HOST_TENSOR_USE_F16C) || defined(HOST_TENSOR_USE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i zero_point_v = _mm_set1_epi16(static_cast<int16_t>(zero_point));
+    const __m128 scale_v = _mm_set1_ps(scale);
+    for (; i + 16 <= num; i += 16) {
+        const __m128i q = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(q, zero), zero_point_v);
+        const __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(q, zero), zero_point_v);
+        /* sign extension of int16 to int32 */
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16)), scale_v));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16)), scale_v));
+        _mm_storeu_ps(dst + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16)), scale_v));
+        _mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16)), scale_v));
+    }
+#endif
+    for (; i < num; i++) {
+        dst[i] = (src[i] - zero_point) * scale;
+    }
+}
+
+void CommonHelper::ConvertFloatToHostTensor(const float* src, void* dst, int32_t num, int32_t type, float scale, int32_t zero_point)
+{
+    switch (type) {
+    case kHostTensorTypeFp16:
+        ConvertFloatToHalf(src, static_cast<uint16_t*>(dst), num);
+        break;
+    case kHostTensorTypeUint8:
+        QuantizeToUint8(src, static_cast<uint8_t*>(dst), num, scale, zero_point);
+        break;
+    case kHostTensorTypeFp32:
+    default:
+        if (src != dst) std::memcpy(dst, src, sizeof(float) * num);
+        break;
+    }
+}
+
+const float* CommonHelper::HostTensorView::Read(int32_t offset, int32_t num, float* work) const
+{
+    switch (type_) {
+    case kHostTensorTypeFp16:
+        ConvertHalfToFloat(static_cast<const uint16_t*>(data_) + offset, work, num);
+        return work;
+    case kHostTensorTypeUint8:
+        DequantizeUint8(static_cast<const uint8_t*>(data_) + offset, work, num, scale_, zero_point_);
+        return work;
+    case kHostTensorTypeFp32:
+    default:
+        return static_cast<const float*>(data_) + offset;
+    }
+}
+
+int32_t CommonHelper::HostTensorView::ArgMax(int32_t offset, int32_t num, float& max_value) const
+{
+    /* Converted in small chunks, so the whole tensor is not widened */
+    static constexpr int32_t kChunkSize = 64;
+    float work[kChunkSize];
+    int32_t max_index = 0;
+    max_value = std::numeric_limits<float>::lowest();
+    for (int32_t i = 0; i < num; i += kChunkSize) {
+        const int32_t chunk_num = (std::min)(kChunkSize, num - i);
+        const float* value_list = Read(offset + i, chunk_num, work);
+        for (int32_t k = 0; k < chunk_num; k++) {
+            if (value_list[k] > max_value) {
+                max_value = value_list[k];
+                max_index = i + k;
+            }
+        }
+    }
+    return max_index;
+}
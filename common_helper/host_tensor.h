@@ -0,0 +1,86 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef HOST_TENSOR_
+#define HOST_TENSOR_
+
+/* for general */
+#include <cstdint>
+#include <cstddef>
+
+/* Element type of tensors on host memory and conversion between them */
+/*  fp16: IEEE 754 half precision stored in uint16_t                   */
+/*  uint8: value = (q - zero_point) * scale                            */
+namespace CommonHelper
+{
+enum {
+    kHostTensorTypeFp32 = 0,
+    kHostTensorTypeFp16,
+    kHostTensorTypeUint8,
+};
+
+int32_t GetHostTensorElementSize(int32_t type);
+
+/* Conversion of num elements. fp16 uses F16C (x64 with avx2), SSE2 (x64) or NEON (aarch64) */
+float ConvertHalfToFloat(uint16_t value);
+void ConvertFloatToHalf(const float* src, uint16_t* dst, int32_t num);
+void ConvertHalfToFloat(const uint16_t* src, float* dst, int32_t num);
+void QuantizeToUint8(const float* src, uint8_t* dst, int32_t num, float scale, int32_t zero_point);
+void DequantizeUint8(const uint8_t* src, float* dst, int32_t num, float scale, int32_t zero_point);
+/* src (fp32) to dst of type (e.g. write a float blob into the input tensor) */
+void ConvertFloatToHostTensor(const float* src, void* dst, int32_t num, int32_t type, float scale = 1.0f, int32_t zero_point = 0);
+
+/* Read-only access to a host tensor of any type as float, without converting the whole tensor */
+/* Decoders read only the elements they need (e.g. candidates over the threshold) */
+class HostTensorView {
+public:
+    HostTensorView() : data_(nullptr), type_(kHostTensorTypeFp32), scale_(1.0f), zero_point_(0) {}
+    HostTensorView(const void* data, int32_t type, float scale = 1.0f, int32_t zero_point = 0)
+        : data_(data), type_(type), scale_(scale), zero_point_(zero_point) {}
+
+    float Get(int32_t index) const {
+        switch (type_) {
+        case kHostTensorTypeFp16:
+            return ConvertHalfToFloat(static_cast<const uint16_t*>(data_)[index]);
+        case kHostTensorTypeUint8:
+            return (static_cast<const uint8_t*>(data_)[index] - zero_point_) * scale_;
+        case kHostTensorTypeFp32:
+        default:
+            return static_cast<const float*>(data_)[index];
+        }
+    }
+
+    /* num elements from offset as float. fp32 returns the pointer into the tensor (no copy), otherwise converted into work */
+    const float* Read(int32_t offset, int32_t num, float* work) const;
+    /* Index of the max value in num elements from offset (the first one if some elements have the same value) */
+    int32_t ArgMax(int32_t offset, int32_t num, float& max_value) const;
+    /* View from offset (e.g. each item of a batch) */
+    HostTensorView Offset(int32_t offset) const {
+        return HostTensorView(static_cast<const uint8_t*>(data_) + static_cast<size_t>(offset) * GetHostTensorElementSize(type_), type_, scale_, zero_point_);
+    }
+
+    const void* GetData() const { return data_; }
+    int32_t GetType() const { return type_; }
+    bool IsFloat() const { return type_ == kHostTensorTypeFp32; }
+
+private:
+    const void* data_;
+    int32_t type_;
+    float scale_;
+    int32_t zero_point_;
+};
+
+}
+
+#endif
@@ -12,11 +12,15 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
+#ifndef HUNGARIAN_ALGORITHM_H_
+#define HUNGARIAN_ALGORITHM_H_
+
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <vector>
 #include <limits>
+#include <algorithm>
 
 
 /* Reference: https://brc2.com/the-algorithm-workshop/ */
@@ -26,16 +30,36 @@ template<typename T>
 class HungarianAlgorithm
 {
 public:
+    HungarianAlgorithm()
+        : rows(0), cols(0), path_count(0), path_row_0(0), path_col_0(0)
+    {
+    }
+
     HungarianAlgorithm(const std::vector<std::vector<T>>& cost_matrix)
     {
-        rows = static_cast<int32_t>(cost_matrix.size());
-        cols = static_cast<int32_t>(cost_matrix[0].size());
-        C = cost_matrix;
-        M = std::vector<std::vector<int32_t>>(rows, std::vector<int32_t>(cols));
-        row_cover = std::vector<int32_t>(rows, 0);
-        col_cover = std::vector<int32_t>(cols, 0);
-
-        path = std::vector<std::vector<int32_t>>(rows * cols, std::vector<int32_t>(2));
+        SetCostMatrix(cost_matrix);
+    }
+
+    void SetCostMatrix(const std::vector<std::vector<T>>& cost_matrix)
+    {
+        SetCostMatrix(cost_matrix, static_cast<int32_t>(cost_matrix.size()), static_cast<int32_t>(cost_matrix[0].size()));
+    }
+
+    /* Use the top-left (rows x cols) of cost_matrix. Work buffers are reused and never shrunk, so no allocation happens once they become large enough */
+    void SetCostMatrix(const std::vector<std::vector<T>>& cost_matrix, int32_t _rows, int32_t _cols)
+    {
+        rows = _rows;
+        cols = _cols;
+        if (static_cast<int32_t>(C.size()) < rows) C.resize(rows);
+        if (static_cast<int32_t>(M.size()) < rows) M.resize(rows);
+        for (int32_t y = 0; y < rows; y++) {
+            C[y].assign(cost_matrix[y].begin(), cost_matrix[y].begin() + cols);
+            M[y].assign(cols, 0);
+        }
+        row_cover.assign(rows, 0);
+        col_cover.assign(cols, 0);
+
+        if (static_cast<int32_t>(path.size()) < rows * cols) path.resize(rows * cols, std::vector<int32_t>(2));
         path_count = 0;
         path_row_0 = 0;
         path_col_0 = 0;
@@ -104,8 +128,8 @@ private:
     void DisplayCostMatrix()
     {
         printf("\nCost matrix\n");
-        for (int32_t y = 0; y < C.size(); y++) {
-            for (int32_t x = 0; x < C[0].size(); x++) {
+        for (int32_t y = 0; y < rows; y++) {
+            for (int32_t x = 0; x < cols; x++) {
                 printf("%4.1f  ", C[y][x]);
             }
             printf("%\n");
@@ -115,8 +139,8 @@ private:
     void DisplayMaskMatrix()
     {
         printf("\nMask matrix\n");
-        for (int32_t y = 0; y < M.size(); y++) {
-            for (int32_t x = 0; x < M[0].size(); x++) {
+        for (int32_t y = 0; y < rows; y++) {
+            for (int32_t x = 0; x < cols; x++) {
                 printf("%d  ", M[y][x]);
             }
             printf("%\n");
@@ -364,3 +388,5 @@ private:
     int32_t path_row_0;
     int32_t path_col_0;
 };
+
+#endif
@@ -0,0 +1,335 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+/* for My modules */
+#include "common_helper.h"
+#include "host_tensor.h"
+#include "image_preprocess.h"
+
+/*** Function ***/
+void CommonHelper::CalculateCropResizeArea(int32_t dst_w, int32_t dst_h, int32_t crop_type, int32_t& crop_x, int32_t& crop_y, int32_t& crop_w, int32_t& crop_h, ImageRect& src_rect, ImageRect& target_rect)
+{
+    src_rect = { crop_x, crop_y, crop_w, crop_h };
+    target_rect = { 0, 0, dst_w, dst_h };
+    if (crop_type == kCropTypeStretch) {
+        /* do nothing */
+    } else if (crop_type == kCropTypeCut) {
+        float aspect_ratio_src = static_cast<float>(crop_w) / crop_h;
+        float aspect_ratio_dst = static_cast<float>(dst_w) / dst_h;
+        if (aspect_ratio_src > aspect_ratio_dst) {
+            src_rect.width = static_cast<int32_t>(crop_h * aspect_ratio_dst);
+            src_rect.x += (crop_w - src_rect.width) / 2;
+        } else {
+            src_rect.height = static_cast<int32_t>(crop_w / aspect_ratio_dst);
+            src_rect.y += (crop_h - src_rect.height) / 2;
+        }
+        crop_x = src_rect.x;
+        crop_y = src_rect.y;
+        crop_w = src_rect.width;
+        crop_h = src_rect.height;
+    } else {
+        float aspect_ratio_src = static_cast<float>(crop_w) / crop_h;
+        float aspect_ratio_dst = static_cast<float>(dst_w) / dst_h;
+        if (aspect_ratio_src > aspect_ratio_dst) {
+            target_rect.height = static_cast<int32_t>(target_rect.width / aspect_ratio_src);
+            target_rect.y = (dst_h - target_rect.height) / 2;
+        } else {
+            target_rect.width = static_cast<int32_t>(target_rect.height * aspect_ratio_src);
+            target_rect.x = (dst_w - target_rect.width) / 2;
+        }
+        crop_x -= target_rect.x * crop_w / target_rect.width;
+        crop_y -= target_rect.y * crop_h / target_rect.height;
+        crop_w = dst_w * crop_w / target_rect.width;
+        crop_h = dst_h * crop_h / target_rect.height;
+    }
+}
+
+/* http://fgiesen.wordpress.com/2012/03/28/half-to-float-done-quic/ (float_to_half_fast3_rtne) */
+uint16_t CommonHelper::ConvertFloatToHalf(float value)
+{
+    uint32_t f;
+    std::memcpy(&f, &value, sizeof(f));
+    const uint32_t sign = (f >> 16) & 0x8000;
+    f &= 0x7FFFFFFF;
+    uint32_t h;
+    if (f >= 0x47800000) {
+        /* overflow to inf. NaN to quiet NaN keeping the upper bits of the payload (the same as F16C and NEON) */
+        h = (f > 0x7F800000) ? (0x7E00 | ((f >> 13) & 0x3FF)) : 0x7C00;
+    } else if (f < 0x38800000) {
+        /* subnormal or zero: let the FPU round by adding 0.5 */
+        float tmp;
+        std::memcpy(&tmp, &f, sizeof(tmp));
+        tmp += 0.5f;
+        std::memcpy(&h, &tmp, sizeof(h));
+        h -= 0x3F000000;
+    } else {
+        const uint32_t mant_odd = (f >> 13) & 1;
+        f += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFF;
+        f += mant_odd;
+        h = f >> 13;
+    }
+    return static_cast<uint16_t>(h | sign);
+}
+
+/* Pixel center aligned and clamped at the edge */
+void CommonHelper::CreateInterpolationTable(int32_t src_size, int32_t dst_size, int32_t step, std::vector<int32_t>& offset0_list, std::vector<int32_t>& offset1_list, std::vector<int16_t>& weight_list)
+{
+    offset0_list.resize(dst_size);
+    offset1_list.resize(dst_size);
+    weight_list.resize(dst_size);
+    const double scale = static_cast<double>(src_size) / dst_size;
+    for (int32_t d = 0; d < dst_size; d++) {
+        double fs = (d + 0.5) * scale - 0.5;
+        int32_t s = static_cast<int32_t>(std::floor(fs));
+        fs -= s;
+        if (s < 0) {
+            s = 0;
+            fs = 0;
+        }
+        if (s >= src_size - 1) {
+            s = src_size - 1;
+            fs = 0;
+        }
+        offset0_list[d] = s * step;
+        offset1_list[d] = (std::min)(s + 1, src_size - 1) * step;
+        weight_list[d] = static_cast<int16_t>(std::lround(fs * kInterpolationWeightOne));  /* weight of offset1 */
+    }
+}
+
+
+CommonHelper::ResizePlan::ResizePlan()
+    : dst_w_(0), dst_h_(0), crop_({ 0, 0, 0, 0 }), crop_type_(kCropTypeStretch), mean_{ 0, 0, 0 }, norm_{ 1, 1, 1 }, swap_color_(false)
+    , crop_adjusted_({ 0, 0, 0, 0 }), src_rect_({ 0, 0, 0, 0 }), target_rect_({ 0, 0, 0, 0 }), quant_scale_(1.0f / 255.0f), quant_zero_point_(0), dst_row_stride_(0), dst_plane_size_(0), padded_dst_(nullptr)
+{
+}
+
+void CommonHelper::ResizePlan::Create(int32_t dst_w, int32_t dst_h, int32_t crop_x, int32_t crop_y, int32_t crop_w, int32_t crop_h, int32_t crop_type, const float mean[3], const float norm[3], bool swap_color)
+{
+    dst_w_ = dst_w;
+    dst_h_ = dst_h;
+    crop_ = { crop_x, crop_y, crop_w, crop_h };
+    crop_type_ = crop_type;
+    for (int32_t c = 0; c < 3; c++) {
+        mean_[c] = mean[c];
+        norm_[c] = norm[c];
+    }
+    swap_color_ = swap_color;
+    padded_dst_ = nullptr;
+
+    CalculateCropResizeArea(dst_w, dst_h, crop_type, crop_x, crop_y, crop_w, crop_h, src_rect_, target_rect_);
+    crop_adjusted_ = { crop_x, crop_y, crop_w, crop_h };
+
+    /* top, bottom, left, right (empty rect is not added) */
+    const int32_t target_x1 = target_rect_.x + target_rect_.width;
+    const int32_t target_y1 = target_rect_.y + target_rect_.height;
+    const ImageRect padding_candidate_list[4] = {
+        { 0, 0, dst_w, target_rect_.y },
+        { 0, target_y1, dst_w, dst_h - target_y1 },
+        { 0, target_rect_.y, target_rect_.x, target_rect_.height },
+        { target_x1, target_rect_.y, dst_w - target_x1, target_rect_.height },
+    };
+    padding_rect_list_.clear();
+    for (const auto& rect : padding_candidate_list) {
+        if (rect.width > 0 && rect.height > 0) padding_rect_list_.push_back(rect);
+    }
+
+    CreateInterpolationTable(src_rect_.width, target_rect_.width, 3, x_offset0_list_, x_offset1_list_, x_weight_list_);
+    CreateInterpolationTable(src_rect_.height, target_rect_.height, 1, y_row0_list_, y_row1_list_, y_weight_list_);
+
+    for (int32_t c = 0; c < 3; c++) {
+        const float scale = 1.0f / (255.0f * norm[c]);
+        const float bias = -mean[c] / norm[c];
+        for (int32_t i = 0; i < 256; i++) {
+            lut_float_[c][i] = i * scale + bias;
+            lut_half_[c][i] = ConvertFloatToHalf(lut_float_[c][i]);
+        }
+    }
+    SetQuantization(quant_scale_, quant_zero_point_);
+}
+
+void CommonHelper::ResizePlan::SetQuantization(float scale, int32_t zero_point)
+{
+    quant_scale_ = scale;
+    quant_zero_point_ = zero_point;
+    if (!IsCreated()) return;   /* the table is created in Create */
+    for (int32_t c = 0; c < 3; c++) {
+        for (int32_t i = 0; i < 256; i++) {
+            const int32_t q = static_cast<int32_t>(std::nearbyint(lut_float_[c][i] / scale)) + zero_point;
+            lut_uint8_[c][i] = static_cast<uint8_t>((std::min)((std::max)(q, 0), 255));
+        }
+    }
+    padded_dst_ = nullptr;  /* padding value may be changed */
+}
+
+void CommonHelper::ResizePlan::SetDstLayout(int32_t row_stride, int32_t plane_size)
+{
+    if (row_stride == dst_row_stride_ && plane_size == dst_plane_size_) return;
+    dst_row_stride_ = row_stride;
+    dst_plane_size_ = plane_size;
+    padded_dst_ = nullptr;
+}
+
+bool CommonHelper::ResizePlan::IsSame(int32_t dst_w, int32_t dst_h, int32_t crop_x, int32_t crop_y, int32_t crop_w, int32_t crop_h, int32_t crop_type, const float mean[3], const float norm[3], bool swap_color) const
+{
+    if (!IsCreated()) return false;
+    if (dst_w != dst_w_ || dst_h != dst_h_ || crop_type != crop_type_ || swap_color != swap_color_) return false;
+    if (crop_x != crop_.x || crop_y != crop_.y || crop_w != crop_.width || crop_h != crop_.height) return false;
+    for (int32_t c = 0; c < 3; c++) {
+        if (mean[c] != mean_[c] || norm[c] != norm_[c]) return false;
+    }
+    return true;
+}
+
+void CommonHelper::ResizePlan::GetCropArea(int32_t& crop_x, int32_t& crop_y, int32_t& crop_w, int32_t& crop_h) const
+{
+    crop_x = crop_adjusted_.x;
+    crop_y = crop_adjusted_.y;
+    crop_w = crop_adjusted_.width;
+    crop_h = crop_adjusted_.height;
+}
+
+void CommonHelper::ResizePlan::Apply(const uint8_t* src, int32_t src_stride, float* dst)
+{
+    ApplyImpl<float>(src, src_stride, dst, lut_float_);
+}
+
+void CommonHelper::ResizePlan::Apply(const uint8_t* src, int32_t src_stride, uint16_t* dst)
+{
+    ApplyImpl<uint16_t>(src, src_stride, dst, lut_half_);
+}
+
+void CommonHelper::ResizePlan::Apply(const uint8_t* src, int32_t src_stride, uint8_t* dst)
+{
+    ApplyImpl<uint8_t>(src, src_stride, dst, lut_uint8_);
+}
+
+void CommonHelper::ResizePlan::Apply(const uint8_t* src, int32_t src_stride, void* dst, int32_t host_tensor_type)
+{
+    switch (host_tensor_type) {
+    case kHostTensorTypeFp16:
+        Apply(src, src_stride, static_cast<uint16_t*>(dst));
+        break;
+    case kHostTensorTypeUint8:
+        Apply(src, src_stride, static_cast<uint8_t*>(dst));
+        break;
+    case kHostTensorTypeFp32:
+    default:
+        Apply(src, src_stride, static_cast<float*>(dst));
+        break;
+    }
+}
+
+void CommonHelper::ResizePlan::Fill(void* dst, int32_t host_tensor_type)
+{
+    if (!IsCreated()) return;
+    const ImageRect rect = { 0, 0, dst_w_, dst_h_ };
+    switch (host_tensor_type) {
+    case kHostTensorTypeFp16:
+        FillRect(static_cast<uint16_t*>(dst), rect, lut_half_);
+        break;
+    case kHostTensorTypeUint8:
+        FillRect(static_cast<uint8_t*>(dst), rect, lut_uint8_);
+        break;
+    case kHostTensorTypeFp32:
+    default:
+        FillRect(static_cast<float*>(dst), rect, lut_float_);
+        break;
+    }
+    padded_dst_ = dst;  /* padding area is filled too */
+}
+
+template <typename T>
+void CommonHelper::ResizePlan::FillRect(T* dst, const ImageRect& rect, const T lut[3][256]) const
+{
+    const int32_t row_stride = GetDstRowStride();
+    const int32_t plane_size = GetDstPlaneSize();
+    for (int32_t c = 0; c < 3; c++) {
+        for (int32_t y = rect.y; y < rect.y + rect.height; y++) {
+            T* dst_row = dst + c * plane_size + y * row_stride + rect.x;
+            std::fill(dst_row, dst_row + rect.width, lut[c][0]);
+        }
+    }
+}
+
+/* Bilinear interpolation is done in fixed point on uint8 values, then each value is converted by the table of each channel */
+/* So, the result is the same as resize to uint8 image followed by normalization, but the source area is read only once */
+template <typename T>
+void CommonHelper::ResizePlan::ApplyImpl(const uint8_t* src, int32_t src_stride, T* dst, const T lut[3][256])
+{
+    if (!IsCreated()) return;
+    if (padded_dst_ != dst) {
+        for (const auto& rect : padding_rect_list_) FillRect(dst, rect, lut);
+        padded_dst_ = dst;
+    }
+
+    const int32_t* x_offset0_list = x_offset0_list_.data();
+    const int32_t* x_offset1_list = x_offset1_list_.data();
+    const int16_t* x_weight_list = x_weight_list_.data();
+    const int32_t* y_row0_list = y_row0_list_.data();
+    const int32_t* y_row1_list = y_row1_list_.data();
+    const int16_t* y_weight_list = y_weight_list_.data();
+    const T* lut0 = lut[0];
+    const T* lut1 = lut[1];
+    const T* lut2 = lut[2];
+
+    /* src channel for each dst plane */
+    const int32_t c0 = swap_color_ ? 2 : 0;
+    const int32_t c2 = swap_color_ ? 0 : 2;
+    const uint8_t* src_org = src + src_rect_.y * src_stride + src_rect_.x * 3;
+    const int32_t row_stride = GetDstRowStride();
+    const int32_t plane_size = GetDstPlaneSize();
+    const int32_t target_w = target_rect_.width;
+    T* dst_org = dst + target_rect_.y * row_stride + target_rect_.x;
+
+    auto process_row = [&](int32_t y) {
+        const uint8_t* src_row0 = src_org + y_row0_list[y] * src_stride;
+        const uint8_t* src_row1 = src_org + y_row1_list[y] * src_stride;
+        const int32_t wy1 = y_weight_list[y];
+        const int32_t wy0 = kInterpolationWeightOne - wy1;
+        T* d0 = dst_org + y * row_stride;
+        T* d1 = d0 + plane_size;
+        T* d2 = d1 + plane_size;
+        for (int32_t x = 0; x < target_w; x++) {
+            const uint8_t* p00 = src_row0 + x_offset0_list[x];
+            const uint8_t* p01 = src_row0 + x_offset1_list[x];
+            const uint8_t* p10 = src_row1 + x_offset0_list[x];
+            const uint8_t* p11 = src_row1 + x_offset1_list[x];
+            const int32_t wx1 = x_weight_list[x];
+            const int32_t wx0 = kInterpolationWeightOne - wx1;
+            int32_t value[3];
+            for (int32_t c = 0; c < 3; c++) {
+                const int32_t h0 = p00[c] * wx0 + p01[c] * wx1;
+                const int32_t h1 = p10[c] * wx0 + p11[c] * wx1;
+                value[c] = (h0 * wy0 + h1 * wy1 + (1 << (2 * kInterpolationWeightBits - 1))) >> (2 * kInterpolationWeightBits);
+            }
+            d0[x] = lut0[value[c0]];
+            d1[x] = lut1[value[1]];
+            d2[x] = lut2[value[c2]];
+        }
+    };
+    if (CommonHelper::GetParallelThreadNum() > 1) {
+#pragma omp parallel for
+        for (int32_t y = 0; y < target_rect_.height; y++) process_row(y);
+    } else {
+        for (int32_t y = 0; y < target_rect_.height; y++) process_row(y);
+    }
+}
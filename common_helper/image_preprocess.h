@@ -0,0 +1,129 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef IMAGE_PREPROCESS_
+#define IMAGE_PREPROCESS_
+
+/* for general */
+#include <cstdint>
+#include <vector>
+
+/* Pre-process for model input without OpenCV (raw pointer of 3-channel uint8 interleaved image) */
+namespace CommonHelper
+{
+enum {
+    kCropTypeStretch = 0,
+    kCropTypeCut,
+    kCropTypeExpand,
+};
+
+typedef struct ImageRect_ {
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+} ImageRect;
+
+/* Calculate the area to be resized (the same rule as CropResizeCvt) */
+/*  src_rect: area to be read from the original image. target_rect: area to be written in the dst image (the rest is padding) */
+/*  crop_x/y/w/h are updated to the area of the original image which corresponds to the whole dst image */
+void CalculateCropResizeArea(int32_t dst_w, int32_t dst_h, int32_t crop_type, int32_t& crop_x, int32_t& crop_y, int32_t& crop_w, int32_t& crop_h, ImageRect& src_rect, ImageRect& target_rect);
+
+/* Convert to IEEE 754 half precision (round to nearest even) */
+uint16_t ConvertFloatToHalf(float value);
+
+/* Table of bilinear interpolation for one axis (the same coordinate mapping as cv::resize(INTER_LINEAR)) */
+/*  dst[d] = src[offset0 / step] * (kInterpolationWeightOne - weight) + src[offset1 / step] * weight */
+static constexpr int32_t kInterpolationWeightBits = 11;
+static constexpr int32_t kInterpolationWeightOne = 1 << kInterpolationWeightBits;
+void CreateInterpolationTable(int32_t src_size, int32_t dst_size, int32_t step, std::vector<int32_t>& offset0_list, std::vector<int32_t>& offset1_list, std::vector<int16_t>& weight_list);
+
+/* Crop, resize (bilinear), color swap, normalize and HWC to CHW in one pass: dst = (src / 255 - mean) / norm */
+/*  src: 3-channel uint8 image. dst: dst_w x dst_h x 3 planes (float, fp16 or quantized uint8). padding is filled with the value of src = 0 */
+/*  swap_color: dst plane 0 is read from src channel 2. mean and norm are in the order of dst */
+/* Crop area, interpolation table and normalization table are calculated once in Create for fixed geometry (e.g. camera stream) */
+/* Padding area is written only at the first Apply to each dst, so the padding of dst must not be overwritten by others */
+class ResizePlan {
+public:
+    ResizePlan();
+    ~ResizePlan() {}
+
+    /* crop_x/y/w/h: area of the original image before adjustment by crop_type */
+    void Create(int32_t dst_w, int32_t dst_h, int32_t crop_x, int32_t crop_y, int32_t crop_w, int32_t crop_h, int32_t crop_type, const float mean[3], const float norm[3], bool swap_color);
+    /* true if the plan has been created with the same parameters (then Create is not needed) */
+    bool IsSame(int32_t dst_w, int32_t dst_h, int32_t crop_x, int32_t crop_y, int32_t crop_w, int32_t crop_h, int32_t crop_type, const float mean[3], const float norm[3], bool swap_color) const;
+    bool IsCreated() const { return dst_w_ > 0; }
+
+    /* src must contain the crop area. Different stride is allowed */
+    void Apply(const uint8_t* src, int32_t src_stride, float* dst);
+    void Apply(const uint8_t* src, int32_t src_stride, uint16_t* dst);
+    void Apply(const uint8_t* src, int32_t src_stride, uint8_t* dst);
+    /* dst of kHostTensorType* (host_tensor.h) */
+    void Apply(const uint8_t* src, int32_t src_stride, void* dst, int32_t host_tensor_type);
+    /* Quantization of uint8 dst: dst = round(value / scale) + zero_point. Default (1/255, 0) is the same as src when mean = 0 and norm = 1 */
+    void SetQuantization(float scale, int32_t zero_point);
+    /* Write padding area at the next Apply even if the dst is the same */
+    void ResetPadding() { padded_dst_ = nullptr; }
+    /* Layout of dst in elements, for dst in a part of a larger blob (e.g. a cell of a mosaic). 0 = dst_w and dst_w * dst_h */
+    void SetDstLayout(int32_t row_stride, int32_t plane_size);
+    /* Fill the whole dst with the value of src = 0 (e.g. an unused cell) */
+    void Fill(void* dst, int32_t host_tensor_type);
+
+    /* Area of the original image which corresponds to the whole dst image (the same as crop_x/y/w/h updated by CropResizeCvt) */
+    void GetCropArea(int32_t& crop_x, int32_t& crop_y, int32_t& crop_w, int32_t& crop_h) const;
+    const ImageRect& GetSrcRect() const { return src_rect_; }
+    const ImageRect& GetTargetRect() const { return target_rect_; }
+
+private:
+    template <typename T>
+    void ApplyImpl(const uint8_t* src, int32_t src_stride, T* dst, const T lut[3][256]);
+    template <typename T>
+    void FillRect(T* dst, const ImageRect& rect, const T lut[3][256]) const;
+    int32_t GetDstRowStride() const { return dst_row_stride_ > 0 ? dst_row_stride_ : dst_w_; }
+    int32_t GetDstPlaneSize() const { return dst_plane_size_ > 0 ? dst_plane_size_ : dst_w_ * dst_h_; }
+
+private:
+    /* Parameters (key of the plan) */
+    int32_t dst_w_;
+    int32_t dst_h_;
+    ImageRect crop_;
+    int32_t crop_type_;
+    float mean_[3];
+    float norm_[3];
+    bool swap_color_;
+
+    /* Calculated */
+    ImageRect crop_adjusted_;
+    ImageRect src_rect_;
+    ImageRect target_rect_;
+    std::vector<ImageRect> padding_rect_list_;
+    std::vector<int32_t> x_offset0_list_;   /* offset in bytes from the left of src_rect */
+    std::vector<int32_t> x_offset1_list_;
+    std::vector<int16_t> x_weight_list_;    /* weight of x_offset1 (fixed point) */
+    std::vector<int32_t> y_row0_list_;      /* row from the top of src_rect */
+    std::vector<int32_t> y_row1_list_;
+    std::vector<int16_t> y_weight_list_;
+    float lut_float_[3][256];
+    uint16_t lut_half_[3][256];
+    uint8_t lut_uint8_[3][256];
+    float quant_scale_;
+    int32_t quant_zero_point_;
+    int32_t dst_row_stride_;
+    int32_t dst_plane_size_;
+    const void* padded_dst_;
+};
+
+}
+
+#endif
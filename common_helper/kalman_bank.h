@@ -0,0 +1,381 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef KALMAN_BANK_H_
+#define KALMAN_BANK_H_
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "fixed_matrix.h"
+
+/* Kalman filters of many objects which share the same model (F, Q, H, R) */
+/* Status (X, P) of all objects is stored in SoA layout: element[i] of all slots is contiguous, */
+/* so Predict / Update of all objects run as loops over slots which are vectorized (omp simd) */
+/* A slot is allocated by Add and released by Remove. Released slots are reused by the next Add */
+template <int32_t NX, int32_t NZ, typename T = double>
+class KalmanBank {
+public:
+    typedef FixedMatrix<NX, 1, T> Status;
+    typedef FixedMatrix<NZ, 1, T> Observed;
+    typedef FixedMatrix<NX, NX, T> Covariance;
+
+private:
+    static constexpr int32_t kBlockSize = 32;   /* number of slots processed at once. (temporary values of a block are kept on stack) */
+
+public:
+    KalmanBank() : capacity_(0), slot_end_(0) {}
+    ~KalmanBank() {}
+
+    void Initialize(
+        const FixedMatrix<NX, NX, T>& _F,
+        const FixedMatrix<NX, NX, T>& _Q,
+        const FixedMatrix<NZ, NX, T>& _H,
+        const FixedMatrix<NZ, NZ, T>& _R
+    )
+    {
+        F = _F;
+        Q = _Q;
+        H = _H;
+        R = _R;
+    }
+
+    /* Allocate buffers for capacity slots in advance (no allocation in Add until the number of slots exceeds it) */
+    void Reserve(int32_t capacity)
+    {
+        capacity = ((capacity + kBlockSize - 1) / kBlockSize) * kBlockSize;
+        if (capacity <= capacity_) return;
+        std::vector<T> x_list(NX * capacity);
+        std::vector<T> p_list(NX * NX * capacity);
+        std::vector<T> z_list(NZ * capacity, 0);
+        std::vector<T> mask_list(capacity, 0);
+        for (int32_t slot = 0; slot < capacity; slot++) {
+            SetEmpty(x_list.data(), p_list.data(), capacity, slot);
+        }
+        for (int32_t i = 0; i < NX; i++) {
+            std::copy(x_.begin() + i * capacity_, x_.begin() + (i + 1) * capacity_, x_list.begin() + i * capacity);
+        }
+        for (int32_t i = 0; i < NX * NX; i++) {
+            std::copy(p_.begin() + i * capacity_, p_.begin() + (i + 1) * capacity_, p_list.begin() + i * capacity);
+        }
+        x_.swap(x_list);
+        p_.swap(p_list);
+        z_.swap(z_list);
+        mask_.swap(mask_list);
+        is_used_.resize(capacity, false);
+        free_slot_list_.reserve(capacity);
+        capacity_ = capacity;
+    }
+
+    void Clear()
+    {
+        for (int32_t slot = 0; slot < slot_end_; slot++) {
+            SetEmpty(x_.data(), p_.data(), capacity_, slot);
+            mask_[slot] = 0;
+            is_used_[slot] = false;
+        }
+        free_slot_list_.clear();
+        slot_end_ = 0;
+    }
+
+    /* Return the slot index */
+    int32_t Add(const Status& X0, const Covariance& P0)
+    {
+        int32_t slot;
+        if (!free_slot_list_.empty()) {
+            slot = free_slot_list_.back();
+            free_slot_list_.pop_back();
+        } else {
+            if (slot_end_ >= capacity_) Reserve((std::max)(kBlockSize, capacity_ * 2));
+            slot = slot_end_++;
+        }
+        for (int32_t i = 0; i < NX; i++) x_[i * capacity_ + slot] = X0(i, 0);
+        for (int32_t i = 0; i < NX * NX; i++) p_[i * capacity_ + slot] = P0.data_array[i];
+        mask_[slot] = 0;
+        is_used_[slot] = true;
+        return slot;
+    }
+
+    void Remove(int32_t slot)
+    {
+        if (slot < 0 || slot >= slot_end_ || !is_used_[slot]) return;
+        /* Keep values of unused slots valid (P = I) because they are also calculated in Predict / Update */
+        SetEmpty(x_.data(), p_.data(), capacity_, slot);
+        mask_[slot] = 0;
+        is_used_[slot] = false;
+        free_slot_list_.push_back(slot);
+    }
+
+    /* X = F * X, P = F * P * F^T + Q for all slots */
+    void PredictAll()
+    {
+        for (int32_t block = 0; block < slot_end_; block += kBlockSize) {
+            T* x = x_.data() + block;
+            T* p = p_.data() + block;
+            T x_new[NX][kBlockSize];
+            T fp[NX][NX][kBlockSize];   /* F * P */
+
+            for (int32_t i = 0; i < NX; i++) {
+                T* dst = x_new[i];
+#pragma omp simd
+                for (int32_t s = 0; s < kBlockSize; s++) dst[s] = 0;
+                for (int32_t k = 0; k < NX; k++) {
+                    const T f = F(i, k);
+                    if (f == 0) continue;   /* F is common to all slots, so this branch is cheap and skips most of the terms */
+                    const T* src = x + k * capacity_;
+#pragma omp simd
+                    for (int32_t s = 0; s < kBlockSize; s++) dst[s] += f * src[s];
+                }
+            }
+            for (int32_t i = 0; i < NX; i++) {
+                for (int32_t j = 0; j < NX; j++) {
+                    T* dst = fp[i][j];
+#pragma omp simd
+                    for (int32_t s = 0; s < kBlockSize; s++) dst[s] = 0;
+                    for (int32_t k = 0; k < NX; k++) {
+                        const T f = F(i, k);
+                        if (f == 0) continue;
+                        const T* src = p + (k * NX + j) * capacity_;
+#pragma omp simd
+                        for (int32_t s = 0; s < kBlockSize; s++) dst[s] += f * src[s];
+                    }
+                }
+            }
+            for (int32_t i = 0; i < NX; i++) {
+                for (int32_t j = 0; j < NX; j++) {
+                    T* dst = p + (i * NX + j) * capacity_;
+                    const T q = Q(i, j);
+#pragma omp simd
+                    for (int32_t s = 0; s < kBlockSize; s++) dst[s] = q;
+                    for (int32_t k = 0; k < NX; k++) {
+                        const T f = F(j, k);
+                        if (f == 0) continue;
+                        const T* src = fp[i][k];
+#pragma omp simd
+                        for (int32_t s = 0; s < kBlockSize; s++) dst[s] += src[s] * f;
+                    }
+                }
+            }
+            for (int32_t i = 0; i < NX; i++) {
+                std::copy(x_new[i], x_new[i] + kBlockSize, x + i * capacity_);
+            }
+        }
+    }
+
+    /* Register the observed value of the slot. It's applied in UpdateAll */
+    void SetObservation(int32_t slot, const Observed& Z)
+    {
+        for (int32_t i = 0; i < NZ; i++) z_[i * capacity_ + slot] = Z(i, 0);
+        mask_[slot] = 1;
+    }
+
+    /* Update status of the slots which have observed value, then clear the observed values */
+    /* K is solved by Cholesky decomposition of S (S is symmetric, so no pivoting is needed). Slots whose S is not positive definite are not updated */
+    void UpdateAll()
+    {
+        for (int32_t block = 0; block < slot_end_; block += kBlockSize) {
+            T* mask = mask_.data() + block;
+            bool has_observation = false;
+            for (int32_t s = 0; s < kBlockSize; s++) has_observation |= (mask[s] != 0);
+            if (!has_observation) continue;
+
+            T* x = x_.data() + block;
+            T* p = p_.data() + block;
+            const T* z = z_.data() + block;
+            T e[NZ][kBlockSize];            /* Z - H * X */
+            T hp[NZ][NX][kBlockSize];       /* H * P */
+            T l[NZ][NZ][kBlockSize];        /* S = L * L^T */
+            T l_inv_diag[NZ][kBlockSize];
+            T kt[NZ][NX][kBlockSize];       /* K^T */
+
+            for (int32_t a = 0; a < NZ; a++) {
+                T* dst = e[a];
+                const T* src_z = z + a * capacity_;
+#pragma omp simd
+                for (int32_t s = 0; s < kBlockSize; s++) dst[s] = src_z[s];
+                for (int32_t k = 0; k < NX; k++) {
+                    const T h = H(a, k);
+                    if (h == 0) continue;
+                    const T* src = x + k * capacity_;
+#pragma omp simd
+                    for (int32_t s = 0; s < kBlockSize; s++) dst[s] -= h * src[s];
+                }
+                for (int32_t j = 0; j < NX; j++) {
+                    T* dst_hp = hp[a][j];
+#pragma omp simd
+                    for (int32_t s = 0; s < kBlockSize; s++) dst_hp[s] = 0;
+                    for (int32_t k = 0; k < NX; k++) {
+                        const T h = H(a, k);
+                        if (h == 0) continue;
+                        const T* src = p + (k * NX + j) * capacity_;
+#pragma omp simd
+                        for (int32_t s = 0; s < kBlockSize; s++) dst_hp[s] += h * src[s];
+                    }
+                }
+            }
+
+            /* S = H * P * H^T + R, and decompose it in place (only the lower triangle is used) */
+            for (int32_t a = 0; a < NZ; a++) {
+                for (int32_t b = 0; b <= a; b++) {
+                    T* dst = l[a][b];
+                    const T r = R(a, b);
+#pragma omp simd
+                    for (int32_t s = 0; s < kBlockSize; s++) dst[s] = r;
+                    for (int32_t k = 0; k < NX; k++) {
+                        const T h = H(b, k);
+                        if (h == 0) continue;
+                        const T* src = hp[a][k];
+#pragma omp simd
+                        for (int32_t s = 0; s < kBlockSize; s++) dst[s] += src[s] * h;
+                    }
+                }
+            }
+            for (int32_t a = 0; a < NZ; a++) {
+                for (int32_t b = 0; b <= a; b++) {
+                    T* dst = l[a][b];
+                    for (int32_t k = 0; k < b; k++) {
+                        const T* src0 = l[a][k];
+                        const T* src1 = l[b][k];
+#pragma omp simd
+                        for (int32_t s = 0; s < kBlockSize; s++) dst[s] -= src0[s] * src1[s];
+                    }
+                    if (a == b) {
+                        T* inv = l_inv_diag[a];
+#pragma omp simd
+                        for (int32_t s = 0; s < kBlockSize; s++) {
+                            mask[s] = (dst[s] > 0) ? mask[s] : 0;
+                            dst[s] = std::sqrt((dst[s] > 0) ? dst[s] : 1);
+                            inv[s] = 1 / dst[s];
+                        }
+                    } else {
+                        const T* inv = l_inv_diag[b];
+#pragma omp simd
+                        for (int32_t s = 0; s < kBlockSize; s++) dst[s] *= inv[s];
+                    }
+                }
+            }
+
+            /* S * K^T = H * P */
+            for (int32_t j = 0; j < NX; j++) {
+                for (int32_t a = 0; a < NZ; a++) {
+                    T* dst = kt[a][j];
+                    const T* src = hp[a][j];
+#pragma omp simd
+                    for (int32_t s = 0; s < kBlockSize; s++) dst[s] = src[s];
+                    for (int32_t k = 0; k < a; k++) {
+                        const T* src_l = l[a][k];
+                        const T* src_y = kt[k][j];
+#pragma omp simd
+                        for (int32_t s = 0; s < kBlockSize; s++) dst[s] -= src_l[s] * src_y[s];
+                    }
+                    const T* inv = l_inv_diag[a];
+#pragma omp simd
+                    for (int32_t s = 0; s < kBlockSize; s++) dst[s] *= inv[s];
+                }
+                for (int32_t a = NZ - 1; a >= 0; a--) {
+                    T* dst = kt[a][j];
+                    for (int32_t k = a + 1; k < NZ; k++) {
+                        const T* src_l = l[k][a];
+                        const T* src_x = kt[k][j];
+#pragma omp simd
+                        for (int32_t s = 0; s < kBlockSize; s++) dst[s] -= src_l[s] * src_x[s];
+                    }
+                    const T* inv = l_inv_diag[a];
+#pragma omp simd
+                    for (int32_t s = 0; s < kBlockSize; s++) dst[s] *= inv[s];
+                }
+            }
+
+            /* X = X + K * e, P = P - K * H * P (only for slots with observed value) */
+            for (int32_t i = 0; i < NX; i++) {
+                T* dst = x + i * capacity_;
+                for (int32_t a = 0; a < NZ; a++) {
+                    const T* src_k = kt[a][i];
+                    const T* src_e = e[a];
+#pragma omp simd
+                    for (int32_t s = 0; s < kBlockSize; s++) dst[s] += (mask[s] != 0) ? src_k[s] * src_e[s] : 0;
+                }
+                for (int32_t j = 0; j < NX; j++) {
+                    T* dst_p = p + (i * NX + j) * capacity_;
+                    for (int32_t a = 0; a < NZ; a++) {
+                        const T* src_k = kt[a][i];
+                        const T* src_hp = hp[a][j];
+#pragma omp simd
+                        for (int32_t s = 0; s < kBlockSize; s++) dst_p[s] -= (mask[s] != 0) ? src_k[s] * src_hp[s] : 0;
+                    }
+                }
+            }
+
+#pragma omp simd
+            for (int32_t s = 0; s < kBlockSize; s++) mask[s] = 0;
+        }
+    }
+
+    Status GetStatus(int32_t slot) const
+    {
+        Status X;
+        for (int32_t i = 0; i < NX; i++) X(i, 0) = x_[i * capacity_ + slot];
+        return X;
+    }
+
+    /* F * X. (the status is not updated) */
+    Status GetPredictedStatus(int32_t slot) const
+    {
+        return F * GetStatus(slot);
+    }
+
+    Covariance GetCovariance(int32_t slot) const
+    {
+        Covariance P;
+        for (int32_t i = 0; i < NX * NX; i++) P.data_array[i] = p_[i * capacity_ + slot];
+        return P;
+    }
+
+    int32_t GetCapacity() const { return capacity_; }
+
+private:
+    static void SetEmpty(T* x_list, T* p_list, int32_t capacity, int32_t slot)
+    {
+        for (int32_t i = 0; i < NX; i++) x_list[i * capacity + slot] = 0;
+        for (int32_t i = 0; i < NX; i++) {
+            for (int32_t j = 0; j < NX; j++) {
+                p_list[(i * NX + j) * capacity + slot] = (i == j) ? 1 : 0;
+            }
+        }
+    }
+
+public:
+    /*** Model (common to all slots) ***/
+    FixedMatrix<NX, NX, T> F;
+    FixedMatrix<NX, NX, T> Q;
+    FixedMatrix<NZ, NX, T> H;
+    FixedMatrix<NZ, NZ, T> R;
+
+private:
+    int32_t capacity_;                  /* multiple of kBlockSize */
+    int32_t slot_end_;                  /* slots after this have never been used */
+    std::vector<T> x_;                  /* X(i) of slot s: x_[i * capacity_ + s] */
+    std::vector<T> p_;                  /* P(i, j) of slot s: p_[(i * NX + j) * capacity_ + s] */
+    std::vector<T> z_;                  /* observed value */
+    std::vector<T> mask_;               /* 1: has observed value */
+    std::vector<bool> is_used_;
+    std::vector<int32_t> free_slot_list_;
+};
+
+template <int32_t NX, int32_t NZ, typename T>
+constexpr int32_t KalmanBank<NX, NZ, T>::kBlockSize;
+
+#endif
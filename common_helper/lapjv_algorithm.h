@@ -0,0 +1,217 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef LAPJV_ALGORITHM_H_
+#define LAPJV_ALGORITHM_H_
+
+#include <cstdint>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+
+/* Calculate assignment to minimize cost (linear assignment problem) */
+/* Shortest augmenting path method of Jonker-Volgenant: each item of the smaller side is assigned one by one */
+/* by Dijkstra on reduced costs (cost - u - v). Reference: D. F. Crouse, "On implementing 2D rectangular assignment algorithms", 2016 */
+/*  - Rectangular matrix is supported without padding. All items of the smaller side are assigned */
+/*  - Cost matrix is a flat row-major array */
+/*  - Dual variables (u for rows, v for cols) of the previous result can be used as initial values (warm start) */
+/*    Any initial v gives the optimal result only for square matrix, because an unassigned item keeps its initial v. */
+/*    So, in case of warm start with rectangular matrix, virtual dummy items whose costs are 0 are added to the smaller side */
+template<typename T>
+class LapjvAlgorithm
+{
+public:
+    LapjvAlgorithm()
+        : rows_(0), cols_(0), is_transposed_(false)
+    {
+    }
+
+    ~LapjvAlgorithm() {}
+
+    /* cost_matrix[y * cols + x]. Work buffers are reused and never shrunk, so no allocation happens once they become large enough */
+    void SetCostMatrix(const T* cost_matrix, int32_t rows, int32_t cols)
+    {
+        rows_ = rows;
+        cols_ = cols;
+        /* Items of the smaller side (n) are assigned to the larger side (m) */
+        is_transposed_ = rows > cols;
+        const int32_t n = (std::min)(rows, cols);
+        const int32_t m = (std::max)(rows, cols);
+        cost_.resize(n * m);
+        if (is_transposed_) {
+            for (int32_t y = 0; y < rows; y++) {
+                for (int32_t x = 0; x < cols; x++) {
+                    cost_[x * rows + y] = cost_matrix[y * cols + x];
+                }
+            }
+        } else {
+            std::copy(cost_matrix, cost_matrix + n * m, cost_.begin());
+        }
+        u_.assign(n, 0);
+        v_.assign(m, 0);
+    }
+
+    /* Set initial dual variables (call after SetCostMatrix). Empty means 0 */
+    /* Only the duals of the larger side are used. (the ones of the smaller side are calculated in Solve) */
+    /* The duals may be of a problem of different size (e.g. the previous frame). Missing items are 0, and extra items are ignored */
+    void SetInitialDual(const std::vector<T>& row_dual, const std::vector<T>& col_dual)
+    {
+        const std::vector<T>& dual = is_transposed_ ? row_dual : col_dual;
+        if (!dual.empty()) {
+            const size_t num = (std::min)(dual.size(), v_.size());
+            std::copy(dual.begin(), dual.begin() + num, v_.begin());
+            std::fill(v_.begin() + num, v_.end(), 0);
+            u_.assign(v_.size(), 0);    /* add dummy rows if n < m */
+        }
+    }
+
+    /* assign_for_row[y] = x, assign_for_col[x] = y. (-1 if not assigned) */
+    void Solve(std::vector<int32_t>& assign_for_row, std::vector<int32_t>& assign_for_col)
+    {
+        const int32_t n = (std::min)(rows_, cols_);         /* the number of real items of the smaller side */
+        const int32_t n_all = static_cast<int32_t>(u_.size());   /* including dummy items */
+        const int32_t m = static_cast<int32_t>(v_.size());
+        col4row_.assign(n_all, -1);
+        row4col_.assign(m, -1);
+        shortest_path_cost_.resize(m);
+        path_.resize(m);
+        remaining_.resize(m);
+        is_row_scanned_.resize(n_all);
+        is_col_scanned_.resize(m);
+
+        for (int32_t cur_row = 0; cur_row < n_all; cur_row++) {
+            T min_value;
+            const int32_t sink = FindAugmentingPath(cur_row, min_value);
+            if (sink < 0) break;    /* infeasible (never happens with finite costs) */
+
+            /* Update dual variables */
+            u_[cur_row] += min_value;
+            for (int32_t i = 0; i < n_all; i++) {
+                if (is_row_scanned_[i] && i != cur_row) {
+                    u_[i] += min_value - shortest_path_cost_[col4row_[i]];
+                }
+            }
+            for (int32_t j = 0; j < m; j++) {
+                if (is_col_scanned_[j]) {
+                    v_[j] -= min_value - shortest_path_cost_[j];
+                }
+            }
+
+            /* Augment the assignment along the path */
+            for (int32_t j = sink;;) {
+                const int32_t i = path_[j];
+                row4col_[j] = i;
+                std::swap(col4row_[i], j);
+                if (i == cur_row) break;
+            }
+        }
+
+        assign_for_row.assign(rows_, -1);
+        assign_for_col.assign(cols_, -1);
+        for (int32_t i = 0; i < n; i++) {
+            if (col4row_[i] < 0) continue;
+            if (is_transposed_) {
+                assign_for_col[i] = col4row_[i];
+                assign_for_row[col4row_[i]] = i;
+            } else {
+                assign_for_row[i] = col4row_[i];
+                assign_for_col[col4row_[i]] = i;
+            }
+        }
+        if (is_transposed_) {
+            row_dual_.assign(v_.begin(), v_.end());
+            col_dual_.assign(u_.begin(), u_.begin() + n);
+        } else {
+            row_dual_.assign(u_.begin(), u_.begin() + n);
+            col_dual_.assign(v_.begin(), v_.end());
+        }
+    }
+
+    /* Dual variables of the last result (cost(y, x) - row_dual[y] - col_dual[x] >= 0, and = 0 for assigned pairs) */
+    const std::vector<T>& GetRowDual() const { return row_dual_; }
+    const std::vector<T>& GetColDual() const { return col_dual_; }
+
+private:
+    /* Dijkstra from cur_row until an unassigned column is reached. Return the column (sink) */
+    int32_t FindAugmentingPath(int32_t cur_row, T& min_value)
+    {
+        const int32_t n_real = (std::min)(rows_, cols_);
+        const int32_t n_all = static_cast<int32_t>(u_.size());
+        const int32_t m = static_cast<int32_t>(v_.size());
+        const T kInf = std::numeric_limits<T>::max();
+        int32_t num_remaining = m;
+        for (int32_t it = 0; it < m; it++) {
+            remaining_[it] = m - it - 1;    /* reversed order to find unassigned columns first in case of tie */
+            shortest_path_cost_[it] = kInf;
+        }
+        std::fill(is_row_scanned_.begin(), is_row_scanned_.begin() + n_all, false);
+        std::fill(is_col_scanned_.begin(), is_col_scanned_.begin() + m, false);
+
+        min_value = 0;
+        int32_t i = cur_row;
+        int32_t sink = -1;
+        while (sink == -1) {
+            is_row_scanned_[i] = true;
+            const T* cost_row = (i < n_real) ? cost_.data() + i * m : nullptr;   /* nullptr for dummy row */
+            const T base = min_value - u_[i];
+            int32_t index = -1;
+            T lowest = kInf;
+            for (int32_t it = 0; it < num_remaining; it++) {
+                const int32_t j = remaining_[it];
+                const T r = base + (cost_row ? cost_row[j] : 0) - v_[j];
+                if (r < shortest_path_cost_[j]) {
+                    path_[j] = i;
+                    shortest_path_cost_[j] = r;
+                }
+                if (shortest_path_cost_[j] < lowest || (shortest_path_cost_[j] == lowest && row4col_[j] == -1)) {
+                    lowest = shortest_path_cost_[j];
+                    index = it;
+                }
+            }
+
+            min_value = lowest;
+            if (index < 0 || min_value == kInf) return -1;
+
+            const int32_t j = remaining_[index];
+            if (row4col_[j] == -1) {
+                sink = j;
+            } else {
+                i = row4col_[j];
+            }
+            is_col_scanned_[j] = true;
+            remaining_[index] = remaining_[--num_remaining];
+        }
+        return sink;
+    }
+
+private:
+    int32_t rows_;
+    int32_t cols_;
+    bool is_transposed_;            /* true: rows > cols, so cost_ is transposed */
+    std::vector<T> cost_;           /* n x m (n <= m) */
+    std::vector<T> u_;              /* dual variables of the smaller side (n, or m with dummy rows) */
+    std::vector<T> v_;              /* dual variables of the larger side (m) */
+    std::vector<int32_t> col4row_;
+    std::vector<int32_t> row4col_;
+    std::vector<T> shortest_path_cost_;
+    std::vector<int32_t> path_;
+    std::vector<int32_t> remaining_;
+    std::vector<bool> is_row_scanned_;
+    std::vector<bool> is_col_scanned_;
+    std::vector<T> row_dual_;
+    std::vector<T> col_dual_;
+};
+
+#endif
@@ -0,0 +1,198 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/* for general */
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* for My modules */
+#include "common_helper.h"
+#include "bounding_box.h"
+#include "box_batch.h"
+#include "matrix_nms.h"
+
+/*** Macro ***/
+/* Rows are processed in blocks. IoU with higher score boxes in the same block is kept until compensate of the block is calculated */
+#define BLOCK_ROWS 256
+
+
+MatrixNms::MatrixNms()
+    : threshold_score_(0.5f), kernel_(kKernelGaussian), sigma_(2.0f), check_class_id_(false), num_max_pre_nms_(0), num_max_detection_(0)
+{
+}
+
+MatrixNms::~MatrixNms()
+{
+}
+
+void MatrixNms::SetParam(float threshold_score, int32_t kernel, float sigma, bool check_class_id, int32_t num_max_pre_nms, int32_t num_max_detection)
+{
+    threshold_score_ = threshold_score;
+    kernel_ = kernel;
+    sigma_ = sigma;
+    check_class_id_ = check_class_id;
+    num_max_pre_nms_ = num_max_pre_nms;
+    num_max_detection_ = num_max_detection;
+}
+
+void MatrixNms::Reserve(int32_t num_max_input)
+{
+    order_.reserve(num_max_input);
+    box_batch_sorted_.Reserve(num_max_input);
+    compensate_iou_.reserve(num_max_input);
+    compensate_.reserve(num_max_input);
+    decay_.reserve(num_max_input);
+    score_decayed_.reserve(num_max_input);
+    iou_work_.reserve(static_cast<size_t>(num_max_input) * CommonHelper::GetParallelThreadNum());
+    iou_block_.reserve(BLOCK_ROWS * BLOCK_ROWS);
+    index_keep_.reserve(num_max_input);
+}
+
+/* linear: decay = min_j (1 - iou_ij) / (1 - compensate_iou_j) */
+/* gaussian: decay = min_j exp(-sigma * (iou_ij^2 - compensate_iou_j^2)) = exp(-sigma * max_j (iou_ij^2 - compensate_iou_j^2)) */
+/* The IoU row is calculated only once: its max is compensate_iou_i, and the decay by higher score boxes in the previous blocks is calculated here */
+void MatrixNms::ProcessRow(int32_t i, int32_t block_start, float* iou_list)
+{
+    BoxBatch& batch = box_batch_sorted_;
+    BoundingBoxUtils::CalculateIoU(batch, i, batch, 0, i, iou_list);
+    if (check_class_id_) {
+        for (int32_t j = 0; j < i; j++) {
+            if (batch.class_id[i] != batch.class_id[j]) iou_list[j] = 0;
+        }
+    }
+
+    float iou_max = 0;
+    for (int32_t j = 0; j < i; j++) iou_max = (std::max)(iou_max, iou_list[j]);
+    compensate_iou_[i] = iou_max;
+
+    const float* compensate = compensate_.data();
+    if (kernel_ == kKernelLinear) {
+        float decay = 1.0f;
+        for (int32_t j = 0; j < block_start; j++) {
+            decay = (std::min)(decay, (1.0f - iou_list[j]) * compensate[j]);
+        }
+        decay_[i] = decay;
+    } else {
+        float exponent = 0;
+        for (int32_t j = 0; j < block_start; j++) {
+            exponent = (std::max)(exponent, iou_list[j] * iou_list[j] - compensate[j]);
+        }
+        decay_[i] = exponent;
+    }
+    std::copy(iou_list + block_start, iou_list + i, iou_block_.data() + (i - block_start) * BLOCK_ROWS);
+}
+
+void MatrixNms::Run(const std::vector<BoundingBox>& bbox_list, std::vector<BoundingBox>& bbox_nms_list)
+{
+    bbox_nms_list.clear();
+    const int32_t num_input = static_cast<int32_t>(bbox_list.size());
+
+    /*** Sort indices by score (ties are broken by index to make the result stable) ***/
+    order_.resize(num_input);
+    for (int32_t i = 0; i < num_input; i++) order_[i] = i;
+    auto compare = [&bbox_list](int32_t lhs, int32_t rhs) {
+        if (bbox_list[lhs].score != bbox_list[rhs].score) return bbox_list[lhs].score > bbox_list[rhs].score;
+        return lhs < rhs;
+    };
+    int32_t num = (num_max_pre_nms_ > 0) ? (std::min)(num_max_pre_nms_, num_input) : num_input;
+    if (num < num_input) {
+        std::partial_sort(order_.begin(), order_.begin() + num, order_.end(), compare);
+    } else {
+        std::sort(order_.begin(), order_.end(), compare);
+    }
+    /* Boxes whose score is already lower than the threshold never survive, and they affect only lower score boxes */
+    while (num > 0 && bbox_list[order_[num - 1]].score < threshold_score_) num--;
+
+    BoxBatch& batch = box_batch_sorted_;
+    batch.Clear();
+    batch.Reserve(num);
+    for (int32_t i = 0; i < num; i++) batch.Push(bbox_list[order_[i]]);
+
+    /*** Decay of each box. Row i of the IoU matrix has IoU b/w box i and higher score boxes [0, i) ***/
+    /* Rows of a block are processed in parallel after compensate of all the previous blocks is calculated */
+    /* One thread when called in a parallel region. Not to nest parallel regions */
+    const int32_t thread_num = CommonHelper::GetParallelThreadNum();
+    compensate_iou_.resize(num);
+    compensate_.resize(num);
+    decay_.resize(num);
+    score_decayed_.resize(num);
+    iou_work_.resize(static_cast<size_t>(num) * thread_num);
+    iou_block_.resize(BLOCK_ROWS * BLOCK_ROWS);
+    for (int32_t block_start = 0; block_start < num; block_start += BLOCK_ROWS) {
+        const int32_t block_end = (std::min)(block_start + BLOCK_ROWS, num);
+        if (thread_num > 1 && block_end - block_start > 1) {
+#pragma omp parallel for schedule(dynamic, 8)
+            for (int32_t i = block_start; i < block_end; i++) {
+#ifdef _OPENMP
+                float* iou_list = iou_work_.data() + static_cast<size_t>(num) * omp_get_thread_num();
+#else
+                float* iou_list = iou_work_.data();
+#endif
+                ProcessRow(i, block_start, iou_list);
+            }
+        } else {
+            for (int32_t i = block_start; i < block_end; i++) {
+                ProcessRow(i, block_start, iou_work_.data());
+            }
+        }
+
+        /* Compensate of the block, then the decay by higher score boxes in the same block */
+        for (int32_t i = block_start; i < block_end; i++) {
+            if (kernel_ == kKernelLinear) {
+                compensate_[i] = 1.0f / (std::max)(1.0f - compensate_iou_[i], 1e-6f);
+            } else {
+                compensate_[i] = compensate_iou_[i] * compensate_iou_[i];
+            }
+        }
+        for (int32_t i = block_start; i < block_end; i++) {
+            const float* iou_list = iou_block_.data() + (i - block_start) * BLOCK_ROWS - block_start;   /* iou_list[j] for j in [block_start, i) */
+            if (kernel_ == kKernelLinear) {
+                float decay = decay_[i];
+                for (int32_t j = block_start; j < i; j++) {
+                    decay = (std::min)(decay, (1.0f - iou_list[j]) * compensate_[j]);
+                }
+                score_decayed_[i] = batch.score[i] * decay;
+            } else {
+                float exponent = decay_[i];
+                for (int32_t j = block_start; j < i; j++) {
+                    exponent = (std::max)(exponent, iou_list[j] * iou_list[j] - compensate_[j]);
+                }
+                score_decayed_[i] = batch.score[i] * std::exp(-sigma_ * exponent);
+            }
+        }
+    }
+
+    /*** Keep boxes whose decayed score is still high enough ***/
+    index_keep_.clear();
+    for (int32_t i = 0; i < num; i++) {
+        if (score_decayed_[i] >= threshold_score_) index_keep_.push_back(i);
+    }
+    const float* score_decayed = score_decayed_.data();
+    std::sort(index_keep_.begin(), index_keep_.end(), [score_decayed](int32_t lhs, int32_t rhs) {
+        if (score_decayed[lhs] != score_decayed[rhs]) return score_decayed[lhs] > score_decayed[rhs];
+        return lhs < rhs;
+    });
+    if (num_max_detection_ > 0 && static_cast<int32_t>(index_keep_.size()) > num_max_detection_) {
+        index_keep_.resize(num_max_detection_);
+    }
+    for (const auto& i : index_keep_) {
+        bbox_nms_list.push_back(bbox_list[order_[i]]);
+        bbox_nms_list.back().score = score_decayed_[i];
+    }
+}
@@ -0,0 +1,68 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef MATRIX_NMS_
+#define MATRIX_NMS_
+
+#include <cstdint>
+#include <vector>
+
+#include "bounding_box.h"
+#include "box_batch.h"
+
+/* Matrix NMS (SOLOv2, https://arxiv.org/abs/2003.10152). Decay scores instead of removing boxes, then keep boxes whose decayed score >= threshold_score */
+/* Unlike greedy NMS, the decay of each box depends only on IoU with higher score boxes, so rows of the IoU matrix are processed in parallel */
+/* Work buffers are reused (no allocation once buffers are large enough) */
+class MatrixNms {
+public:
+    enum {
+        kKernelLinear = 0,
+        kKernelGaussian,
+    };
+
+public:
+    MatrixNms();
+    ~MatrixNms();
+
+    /* num_max_pre_nms: use only the top N boxes as input. num_max_detection: keep up to N boxes. (<= 0: no limit) */
+    void SetParam(float threshold_score, int32_t kernel = kKernelGaussian, float sigma = 2.0f, bool check_class_id = false, int32_t num_max_pre_nms = 0, int32_t num_max_detection = 0);
+    void Reserve(int32_t num_max_input);
+
+    /* Kept boxes in descending order of the decayed score (score of the output is the decayed one) */
+    void Run(const std::vector<BoundingBox>& bbox_list, std::vector<BoundingBox>& bbox_nms_list);
+
+private:
+    void ProcessRow(int32_t i, int32_t block_start, float* iou_list);
+
+private:
+    float   threshold_score_;
+    int32_t kernel_;
+    float   sigma_;
+    bool    check_class_id_;
+    int32_t num_max_pre_nms_;
+    int32_t num_max_detection_;
+
+    /* work buffer */
+    std::vector<int32_t> order_;
+    BoxBatch box_batch_sorted_;
+    std::vector<float>   compensate_iou_;   /* max IoU with higher score boxes */
+    std::vector<float>   compensate_;       /* compensate_iou converted for the kernel */
+    std::vector<float>   decay_;            /* decay (linear) or exponent (gaussian) of each box */
+    std::vector<float>   score_decayed_;
+    std::vector<float>   iou_work_;         /* IoU row for each thread */
+    std::vector<float>   iou_block_;        /* IoU with higher score boxes in the same block */
+    std::vector<int32_t> index_keep_;
+};
+
+#endif
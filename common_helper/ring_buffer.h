@@ -0,0 +1,69 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef RING_BUFFER_
+#define RING_BUFFER_
+
+#include <cstdint>
+#include <array>
+
+/* Fixed capacity FIFO without heap allocation. The oldest element is dropped when a new element is pushed to a full buffer */
+/* Interface is the same as a part of std::deque. Index 0 is the oldest */
+template <typename T, int32_t N>
+class RingBuffer {
+public:
+    RingBuffer() : head_(0), size_(0) {}
+
+    void push_back(const T& value)
+    {
+        if (size_ < N) {
+            data_[(head_ + size_) % N] = value;
+            size_++;
+        } else {
+            data_[head_] = value;
+            head_ = (head_ + 1) % N;
+        }
+    }
+
+    void pop_front()
+    {
+        if (size_ == 0) return;
+        head_ = (head_ + 1) % N;
+        size_--;
+    }
+
+    void clear()
+    {
+        head_ = 0;
+        size_ = 0;
+    }
+
+    size_t size() const { return static_cast<size_t>(size_); }
+    bool empty() const { return size_ == 0; }
+    static constexpr size_t capacity() { return static_cast<size_t>(N); }
+
+    T& operator[](size_t i) { return data_[(head_ + i) % N]; }
+    const T& operator[](size_t i) const { return data_[(head_ + i) % N]; }
+    T& front() { return data_[head_]; }
+    const T& front() const { return data_[head_]; }
+    T& back() { return data_[(head_ + size_ - 1) % N]; }
+    const T& back() const { return data_[(head_ + size_ - 1) % N]; }
+
+private:
+    std::array<T, N> data_;
+    int32_t head_;
+    int32_t size_;
+};
+
+#endif
@@ -0,0 +1,179 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef SLOT_MAP_
+#define SLOT_MAP_
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+/* Pool of objects with stable handles. Insert / Remove are O(1) and an object never moves once inserted */
+/* Objects are kept in fixed-size chunks which are never reallocated, so a pointer (reference) to an object is valid until it is removed */
+/* A removed slot is reused by the next Insert, and its generation is incremented so that old handles become invalid */
+/* Iteration visits live slots in order of slot index. Removing the current object while iterating is allowed */
+template <typename T>
+class SlotMap {
+private:
+    static constexpr int32_t kChunkSize = 64;
+    typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+
+public:
+    typedef struct Handle_ {
+        int32_t index;
+        uint32_t generation;
+    } Handle;
+
+    template <typename MAP, typename ITEM>
+    class IteratorBase {
+    public:
+        IteratorBase(MAP* map, int32_t index) : map_(map), index_(index) { SkipFree(); }
+        ITEM& operator*() const { return (*map_)[index_]; }
+        ITEM* operator->() const { return &(*map_)[index_]; }
+        IteratorBase& operator++() { index_++; SkipFree(); return *this; }
+        bool operator==(const IteratorBase& it) const { return index_ == it.index_; }
+        bool operator!=(const IteratorBase& it) const { return index_ != it.index_; }
+        Handle GetHandle() const { return map_->GetHandle(index_); }
+        int32_t GetIndex() const { return index_; }
+    private:
+        void SkipFree()
+        {
+            const int32_t capacity = map_->slot_num_;
+            while (index_ < capacity && !map_->is_used_list_[index_]) index_++;
+        }
+    private:
+        MAP* map_;
+        int32_t index_;
+    };
+    typedef IteratorBase<SlotMap, T> Iterator;
+    typedef IteratorBase<const SlotMap, const T> ConstIterator;
+
+public:
+    SlotMap() : slot_num_(0), size_(0) {}
+    ~SlotMap() { DestructAll(); }
+    SlotMap(const SlotMap&) = delete;
+    SlotMap& operator=(const SlotMap&) = delete;
+
+    /* Allocate chunks for capacity objects in advance */
+    void Reserve(int32_t capacity)
+    {
+        while (static_cast<int32_t>(chunk_list_.size()) * kChunkSize < capacity) {
+            chunk_list_.push_back(std::unique_ptr<Storage[]>(new Storage[kChunkSize]));
+        }
+        generation_list_.reserve(capacity);
+        is_used_list_.reserve(capacity);
+        free_slot_list_.reserve(capacity);
+    }
+
+    /* The object is copied into a free slot. (a new slot is added only when there is no free slot) */
+    Handle Insert(const T& item)
+    {
+        int32_t index;
+        if (free_slot_list_.empty()) {
+            index = slot_num_;
+            if (index >= static_cast<int32_t>(chunk_list_.size()) * kChunkSize) {
+                chunk_list_.push_back(std::unique_ptr<Storage[]>(new Storage[kChunkSize]));
+            }
+            generation_list_.push_back(0);
+            is_used_list_.push_back(0);
+            slot_num_++;
+        } else {
+            index = free_slot_list_.back();
+            free_slot_list_.pop_back();
+        }
+        new (GetStorage(index)) T(item);
+        is_used_list_[index] = 1;
+        size_++;
+        return GetHandle(index);
+    }
+
+    /* The object is destructed. The slot keeps its memory and is reused by Insert */
+    void Remove(const Handle& handle)
+    {
+        if (!IsValid(handle)) return;
+        GetItem(handle.index).~T();
+        is_used_list_[handle.index] = 0;
+        generation_list_[handle.index]++;
+        free_slot_list_.push_back(handle.index);
+        size_--;
+    }
+
+    /* Remove all objects. Generations are kept (incremented), so handles taken before Clear never match new objects */
+    void Clear()
+    {
+        free_slot_list_.clear();
+        for (int32_t index = slot_num_ - 1; index >= 0; index--) {
+            if (is_used_list_[index]) {
+                GetItem(index).~T();
+                is_used_list_[index] = 0;
+                generation_list_[index]++;
+            }
+            free_slot_list_.push_back(index);   /* the smallest index is reused first */
+        }
+        size_ = 0;
+    }
+
+    bool IsValid(const Handle& handle) const
+    {
+        return handle.index >= 0 && handle.index < slot_num_
+            && is_used_list_[handle.index] && generation_list_[handle.index] == handle.generation;
+    }
+
+    /* Return nullptr if the object has been removed */
+    T* Get(const Handle& handle) { return IsValid(handle) ? &GetItem(handle.index) : nullptr; }
+    const T* Get(const Handle& handle) const { return IsValid(handle) ? &GetItem(handle.index) : nullptr; }
+
+    /* Access by slot index without check (for an index got from the iterator) */
+    T& operator[](int32_t index) { return GetItem(index); }
+    const T& operator[](int32_t index) const { return GetItem(index); }
+    Handle GetHandle(int32_t index) const
+    {
+        Handle handle;
+        handle.index = index;
+        handle.generation = generation_list_[index];
+        return handle;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return static_cast<size_t>(slot_num_); }
+
+    Iterator begin() { return Iterator(this, 0); }
+    Iterator end() { return Iterator(this, slot_num_); }
+    ConstIterator begin() const { return ConstIterator(this, 0); }
+    ConstIterator end() const { return ConstIterator(this, slot_num_); }
+
+private:
+    Storage* GetStorage(int32_t index) const { return &chunk_list_[index / kChunkSize][index % kChunkSize]; }
+    T& GetItem(int32_t index) { return *reinterpret_cast<T*>(GetStorage(index)); }
+    const T& GetItem(int32_t index) const { return *reinterpret_cast<const T*>(GetStorage(index)); }
+    void DestructAll()
+    {
+        for (int32_t index = 0; index < slot_num_; index++) {
+            if (is_used_list_[index]) GetItem(index).~T();
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<Storage[]>> chunk_list_;    /* kChunkSize objects each. never reallocated */
+    std::vector<uint32_t> generation_list_;
+    std::vector<uint8_t> is_used_list_;
+    std::vector<int32_t> free_slot_list_;
+    int32_t slot_num_;      /* number of slots which have been used (live or free) */
+    size_t size_;
+};
+
+#endif
@@ -0,0 +1,334 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* for SIMD */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define STEREO_PACKER_USE_AVX2
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#define STEREO_PACKER_USE_SSE4
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define STEREO_PACKER_USE_NEON
+#endif
+
+/* for My modules */
+#include "common_helper.h"
+#include "image_preprocess.h"
+#include "stereo_packer.h"
+
+/*** Macro ***/
+#define TAG "StereoPacker"
+#define PRINT(...)   COMMON_HELPER_PRINT(TAG, __VA_ARGS__)
+#define PRINT_E(...) COMMON_HELPER_PRINT_E(TAG, __VA_ARGS__)
+
+/* Rows processed by one thread at a time */
+#define BLOCK_ROWS 8
+
+/* cv::COLOR_BGR2GRAY in fixed point (14 bits) */
+static constexpr int32_t kGrayShift = 14;
+static constexpr int32_t kGrayB = 1868;
+static constexpr int32_t kGrayG = 9617;
+static constexpr int32_t kGrayR = 4899;
+
+static constexpr int32_t kBlendShift = 2 * CommonHelper::kInterpolationWeightBits;
+static constexpr float kScale = 1.0f / 255.0f;
+
+static void* AlignedMalloc(size_t size, size_t alignment)
+{
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    void* p = nullptr;
+    if (posix_memalign(&p, alignment, size) != 0) return nullptr;
+    return p;
+#endif
+}
+
+static void AlignedFree(void* p)
+{
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void StereoPacker::AlignedDeleter::operator()(void* p) const
+{
+    AlignedFree(p);
+}
+
+static int32_t GetThreadNumMax()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+static int32_t GetThreadIndex()
+{
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+/* dst[x] = round(h0[x] * wy0 + h1[x] * wy1) / 255 */
+static void BlendRow(const int32_t* h0, const int32_t* h1, int32_t wy0, int32_t wy1, float* dst, int32_t width)
+{
+    int32_t x = 0;
+#if defined(STEREO_PACKER_USE_AVX2)
+    const __m256i vwy0 = _mm256_set1_epi32(wy0);
+    const __m256i vwy1 = _mm256_set1_epi32(wy1);
+    const __m256i vround = _mm256_set1_epi32(1 << (kBlendShift - 1));
+    const __m256 vscale = _mm256_set1_ps(kScale);
+    for (; x + 8 <= width; x += 8) {
+        const __m256i a = _mm256_mullo_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(h0 + x)), vwy0);
+        const __m256i b = _mm256_mullo_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(h1 + x)), vwy1);
+        const __m256i v = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(a, b), vround), kBlendShift);
+        _mm256_storeu_ps(dst + x, _mm256_mul_ps(_mm256_cvtepi32_ps(v), vscale));
+    }
+#elif defined(STEREO_PACKER_USE_SSE4)
+    const __m128i vwy0 = _mm_set1_epi32(wy0);
+    const __m128i vwy1 = _mm_set1_epi32(wy1);
+    const __m128i vround = _mm_set1_epi32(1 << (kBlendShift - 1));
+    const __m128 vscale = _mm_set1_ps(kScale);
+    for (; x + 4 <= width; x += 4) {
+        const __m128i a = _mm_mullo_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h0 + x)), vwy0);
+        const __m128i b = _mm_mullo_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h1 + x)), vwy1);
+        const __m128i v = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(a, b), vround), kBlendShift);
+        _mm_storeu_ps(dst + x, _mm_mul_ps(_mm_cvtepi32_ps(v), vscale));
+    }
+#elif defined(STEREO_PACKER_USE_NEON)
+    const int32x4_t vwy0 = vdupq_n_s32(wy0);
+    const int32x4_t vwy1 = vdupq_n_s32(wy1);
+    const float32x4_t vscale = vdupq_n_f32(kScale);
+    for (; x + 4 <= width; x += 4) {
+        const int32x4_t sum = vmlaq_s32(vmulq_s32(vld1q_s32(h0 + x), vwy0), vld1q_s32(h1 + x), vwy1);
+        const int32x4_t v = vrshrq_n_s32(sum, kBlendShift);
+        vst1q_f32(dst + x, vmulq_f32(vcvtq_f32_s32(v), vscale));
+    }
+#endif
+    for (; x < width; x++) {
+        const int32_t v = (h0[x] * wy0 + h1[x] * wy1 + (1 << (kBlendShift - 1))) >> kBlendShift;
+        dst[x] = v * kScale;
+    }
+}
+
+/* The same as BlendRow for each of B, G, R (plane_size apart), then converted to gray */
+static void BlendRowGray(const int32_t* h0, const int32_t* h1, int32_t plane_size, int32_t wy0, int32_t wy1, float* dst, int32_t width)
+{
+    const int32_t coef[3] = { kGrayB, kGrayG, kGrayR };
+    int32_t x = 0;
+#if defined(STEREO_PACKER_USE_AVX2)
+    const __m256i vwy0 = _mm256_set1_epi32(wy0);
+    const __m256i vwy1 = _mm256_set1_epi32(wy1);
+    const __m256i vround = _mm256_set1_epi32(1 << (kBlendShift - 1));
+    const __m256i vgray_round = _mm256_set1_epi32(1 << (kGrayShift - 1));
+    const __m256i vcoef[3] = { _mm256_set1_epi32(kGrayB), _mm256_set1_epi32(kGrayG), _mm256_set1_epi32(kGrayR) };
+    const __m256 vscale = _mm256_set1_ps(kScale);
+    for (; x + 8 <= width; x += 8) {
+        __m256i gray = vgray_round;
+        for (int32_t c = 0; c < 3; c++) {
+            const __m256i a = _mm256_mullo_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(h0 + c * plane_size + x)), vwy0);
+            const __m256i b = _mm256_mullo_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(h1 + c * plane_size + x)), vwy1);
+            const __m256i v = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(a, b), vround), kBlendShift);
+            gray = _mm256_add_epi32(gray, _mm256_mullo_epi32(v, vcoef[c]));
+        }
+        gray = _mm256_srai_epi32(gray, kGrayShift);
+        _mm256_storeu_ps(dst + x, _mm256_mul_ps(_mm256_cvtepi32_ps(gray), vscale));
+    }
+#elif defined(STEREO_PACKER_USE_SSE4)
+    const __m128i vwy0 = _mm_set1_epi32(wy0);
+    const __m128i vwy1 = _mm_set1_epi32(wy1);
+    const __m128i vround = _mm_set1_epi32(1 << (kBlendShift - 1));
+    const __m128i vgray_round = _mm_set1_epi32(1 << (kGrayShift - 1));
+    const __m128i vcoef[3] = { _mm_set1_epi32(kGrayB), _mm_set1_epi32(kGrayG), _mm_set1_epi32(kGrayR) };
+    const __m128 vscale = _mm_set1_ps(kScale);
+    for (; x + 4 <= width; x += 4) {
+        __m128i gray = vgray_round;
+        for (int32_t c = 0; c < 3; c++) {
+            const __m128i a = _mm_mullo_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h0 + c * plane_size + x)), vwy0);
+            const __m128i b = _mm_mullo_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h1 + c * plane_size + x)), vwy1);
+            const __m128i v = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(a, b), vround), kBlendShift);
+            gray = _mm_add_epi32(gray, _mm_mullo_epi32(v, vcoef[c]));
+        }
+        gray = _mm_srai_epi32(gray, kGrayShift);
+        _mm_storeu_ps(dst + x, _mm_mul_ps(_mm_cvtepi32_ps(gray), vscale));
+    }
+#elif defined(STEREO_PACKER_USE_NEON)
+    const int32x4_t vwy0 = vdupq_n_s32(wy0);
+    const int32x4_t vwy1 = vdupq_n_s32(wy1);
+    const float32x4_t vscale = vdupq_n_f32(kScale);
+    for (; x + 4 <= width; x += 4) {
+        int32x4_t gray = vdupq_n_s32(0);
+        for (int32_t c = 0; c < 3; c++) {
+            const int32x4_t sum = vmlaq_s32(vmulq_s32(vld1q_s32(h0 + c * plane_size + x), vwy0), vld1q_s32(h1 + c * plane_size + x), vwy1);
+            const int32x4_t v = vrshrq_n_s32(sum, kBlendShift);
+            gray = vmlaq_n_s32(gray, v, coef[c]);
+        }
+        gray = vrshrq_n_s32(gray, kGrayShift);
+        vst1q_f32(dst + x, vmulq_f32(vcvtq_f32_s32(gray), vscale));
+    }
+#endif
+    for (; x < width; x++) {
+        int32_t gray = 1 << (kGrayShift - 1);
+        for (int32_t c = 0; c < 3; c++) {
+            const int32_t v = (h0[c * plane_size + x] * wy0 + h1[c * plane_size + x] * wy1 + (1 << (kBlendShift - 1))) >> kBlendShift;
+            gray += v * coef[c];
+        }
+        dst[x] = (gray >> kGrayShift) * kScale;
+    }
+}
+
+
+constexpr int32_t StereoPacker::kAlignment;  // for link error in Android Studio (clang)
+StereoPacker::StereoPacker()
+    : src_w_(0), src_h_(0), dst_w_(0), dst_h_(0), is_gray_(false), swap_color_(true), work_size_(0)
+{
+}
+
+StereoPacker::~StereoPacker()
+{
+}
+
+int32_t StereoPacker::Create(int32_t src_w, int32_t src_h, int32_t dst_w, int32_t dst_h, bool is_gray, bool swap_color)
+{
+    const size_t blob_size = sizeof(float) * dst_w * dst_h * (is_gray ? 2 : 6);
+    if (!blob_ || dst_w * dst_h * (is_gray ? 2 : 6) > dst_w_ * dst_h_ * GetPlaneNum()) {
+        blob_.reset(AlignedMalloc((blob_size + kAlignment - 1) / kAlignment * kAlignment, kAlignment));
+        if (!blob_) {
+            PRINT_E("Failed to allocate blob (%d x %d x %d)\n", dst_w, dst_h, is_gray ? 2 : 6);
+            dst_w_ = 0;     /* not created */
+            dst_h_ = 0;
+            return kRetErr;
+        }
+    }
+    src_w_ = src_w;
+    src_h_ = src_h;
+    dst_w_ = dst_w;
+    dst_h_ = dst_h;
+    is_gray_ = is_gray;
+    swap_color_ = swap_color;
+
+    CommonHelper::CreateInterpolationTable(src_w, dst_w, 3, x_offset0_list_, x_offset1_list_, x_weight_list_);
+    CommonHelper::CreateInterpolationTable(src_h, dst_h, 1, y_row0_list_, y_row1_list_, y_weight_list_);
+
+    work_size_ = 2 * 3 * dst_w;
+    work_list_.resize(static_cast<size_t>(work_size_) * GetThreadNumMax());
+    return kRetOk;
+}
+
+bool StereoPacker::IsSame(int32_t src_w, int32_t src_h, int32_t dst_w, int32_t dst_h, bool is_gray, bool swap_color) const
+{
+    return IsCreated() && src_w == src_w_ && src_h == src_h_ && dst_w == dst_w_ && dst_h == dst_h_ && is_gray == is_gray_ && swap_color == swap_color_;
+}
+
+void StereoPacker::Pack(const uint8_t* src_l, int32_t stride_l, const uint8_t* src_r, int32_t stride_r)
+{
+    if (!IsCreated()) return;
+    if (work_list_.size() < static_cast<size_t>(work_size_) * GetThreadNumMax()) {
+        work_list_.resize(static_cast<size_t>(work_size_) * GetThreadNumMax());
+    }
+
+    const int32_t plane_num_per_view = GetPlaneNum() / 2;
+    const int32_t plane_size = dst_w_ * dst_h_;
+    const int32_t block_num_per_view = (dst_h_ + BLOCK_ROWS - 1) / BLOCK_ROWS;
+    float* blob = GetBlob();
+
+    /* Blocks of the left view then the right view, so that both views are processed in the same parallel loop */
+#pragma omp parallel for
+    for (int32_t block = 0; block < 2 * block_num_per_view; block++) {
+        const int32_t view = block / block_num_per_view;
+        const uint8_t* src = (view == 0) ? src_l : src_r;
+        const int32_t stride = (view == 0) ? stride_l : stride_r;
+        float* dst_plane_top = blob + view * plane_num_per_view * plane_size;
+        int32_t* work = work_list_.data() + static_cast<size_t>(work_size_) * GetThreadIndex();
+        const int32_t y_start = (block % block_num_per_view) * BLOCK_ROWS;
+        const int32_t y_end = (std::min)(y_start + BLOCK_ROWS, dst_h_);
+        int32_t cached_row[2] = { -1, -1 };
+        for (int32_t y = y_start; y < y_end; y++) {
+            PackRow(src, stride, y, dst_plane_top, work, cached_row);
+        }
+    }
+}
+
+void StereoPacker::PackRow(const uint8_t* src, int32_t stride, int32_t y, float* dst_plane_top, int32_t* work, int32_t cached_row[2])
+{
+    /* Horizontal interpolation of the two source rows into planar buffer (scalar because of the table lookup) */
+    /* A source row already interpolated for the previous dst row is reused (cached_row[slot] = source row in the slot) */
+    const int32_t row[2] = { y_row0_list_[y], y_row1_list_[y] };
+    int32_t slot[2] = { -1, -1 };
+    for (int32_t i = 0; i < 2; i++) {
+        if (cached_row[0] == row[i]) slot[i] = 0;
+        if (cached_row[1] == row[i]) slot[i] = 1;
+    }
+    for (int32_t i = 0; i < 2; i++) {
+        if (slot[i] < 0) slot[i] = (slot[1 - i] == 0) ? 1 : 0;
+    }
+    int32_t* h[2] = { work + slot[0] * 3 * dst_w_, work + slot[1] * 3 * dst_w_ };
+
+    const int32_t* x_offset0_list = x_offset0_list_.data();
+    const int32_t* x_offset1_list = x_offset1_list_.data();
+    const int16_t* x_weight_list = x_weight_list_.data();
+    for (int32_t i = 0; i < 2; i++) {
+        if (cached_row[slot[i]] == row[i]) continue;
+        cached_row[slot[i]] = row[i];
+        const uint8_t* src_row = src + row[i] * stride;
+        int32_t* h_b = h[i];
+        int32_t* h_g = h_b + dst_w_;
+        int32_t* h_r = h_g + dst_w_;
+        for (int32_t x = 0; x < dst_w_; x++) {
+            const uint8_t* p0 = src_row + x_offset0_list[x];
+            const uint8_t* p1 = src_row + x_offset1_list[x];
+            const int32_t wx1 = x_weight_list[x];
+            const int32_t wx0 = CommonHelper::kInterpolationWeightOne - wx1;
+            h_b[x] = p0[0] * wx0 + p1[0] * wx1;
+            h_g[x] = p0[1] * wx0 + p1[1] * wx1;
+            h_r[x] = p0[2] * wx0 + p1[2] * wx1;
+        }
+    }
+
+    /* Vertical interpolation, color conversion and scale (SIMD) */
+    const int32_t wy1 = y_weight_list_[y];
+    const int32_t wy0 = CommonHelper::kInterpolationWeightOne - wy1;
+    const int32_t plane_size = dst_w_ * dst_h_;
+    if (is_gray_) {
+        BlendRowGray(h[0], h[1], dst_w_, wy0, wy1, dst_plane_top + y * dst_w_, dst_w_);
+    } else {
+        for (int32_t c = 0; c < 3; c++) {
+            const int32_t src_c = swap_color_ ? 2 - c : c;
+            BlendRow(h[0] + src_c * dst_w_, h[1] + src_c * dst_w_, wy0, wy1, dst_plane_top + c * plane_size + y * dst_w_, dst_w_);
+        }
+    }
+}
@@ -0,0 +1,81 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef STEREO_PACKER_
+#define STEREO_PACKER_
+
+/* for general */
+#include <cstdint>
+#include <vector>
+#include <memory>
+
+/* Pack a stereo pair into one planar float blob for stereo depth models (e.g. HITNet) */
+/* Resize (bilinear), color conversion (RGB or gray), deinterleave and scale (1/255) of both views are done in one pass */
+/*  color: [L_R, L_G, L_B, R_R, R_G, R_B] (6 planes) from BGR image. swap_color = false keeps the order of src */
+/*  gray:  [L_Y, R_Y] (2 planes). Y = 0.299 R + 0.587 G + 0.114 B (the same as cv::COLOR_BGR2GRAY) */
+/* Rows of both views are split into blocks and processed in parallel. The blob is kept until the geometry changes */
+class StereoPacker {
+public:
+    enum {
+        kRetOk = 0,
+        kRetErr = -1,
+    };
+    static constexpr int32_t kAlignment = 32;
+
+public:
+    StereoPacker();
+    ~StereoPacker();
+    StereoPacker(const StereoPacker&) = delete;
+    StereoPacker& operator=(const StereoPacker&) = delete;
+
+    /* src: 3-channel uint8 (BGR) image of src_w x src_h. Both views must be the same size */
+    /* Return kRetErr if the blob can't be allocated (the packer is left not created) */
+    int32_t Create(int32_t src_w, int32_t src_h, int32_t dst_w, int32_t dst_h, bool is_gray, bool swap_color = true);
+    bool IsSame(int32_t src_w, int32_t src_h, int32_t dst_w, int32_t dst_h, bool is_gray, bool swap_color = true) const;
+    bool IsCreated() const { return dst_w_ > 0; }
+
+    void Pack(const uint8_t* src_l, int32_t stride_l, const uint8_t* src_r, int32_t stride_r);
+
+    /* dst_w x dst_h x (2 or 6). Aligned to kAlignment */
+    float* GetBlob() { return static_cast<float*>(blob_.get()); }
+    const float* GetBlob() const { return static_cast<const float*>(blob_.get()); }
+    int32_t GetPlaneNum() const { return is_gray_ ? 2 : 6; }
+
+private:
+    struct AlignedDeleter {
+        void operator()(void* p) const;
+    };
+
+private:
+    void PackRow(const uint8_t* src, int32_t stride, int32_t y, float* dst_plane_top, int32_t* work, int32_t cached_row[2]);
+
+private:
+    int32_t src_w_;
+    int32_t src_h_;
+    int32_t dst_w_;
+    int32_t dst_h_;
+    bool is_gray_;
+    bool swap_color_;
+    std::unique_ptr<void, AlignedDeleter> blob_;
+    std::vector<int32_t> x_offset0_list_;   /* offset in bytes */
+    std::vector<int32_t> x_offset1_list_;
+    std::vector<int16_t> x_weight_list_;
+    std::vector<int32_t> y_row0_list_;
+    std::vector<int32_t> y_row1_list_;
+    std::vector<int16_t> y_weight_list_;
+    std::vector<int32_t> work_list_;        /* horizontally interpolated rows for each thread (2 rows x 3 channels x dst_w) */
+    int32_t work_size_;                     /* size of the work for each thread */
+};
+
+#endif
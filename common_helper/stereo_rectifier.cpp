@@ -0,0 +1,173 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <algorithm>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+/* for My modules */
+#include "common_helper.h"
+#include "image_preprocess.h"
+#include "stereo_rectifier.h"
+
+/*** Macro ***/
+#define TAG "StereoRectifier"
+#define PRINT(...)   COMMON_HELPER_PRINT(TAG, __VA_ARGS__)
+#define PRINT_E(...) COMMON_HELPER_PRINT_E(TAG, __VA_ARGS__)
+
+/* Number of rows remapped by one task. Small enough to balance threads, large enough to amortize the call of cv::remap */
+#define STRIPE_ROWS 16
+
+/* Position in the map for padding. Both pixels used for interpolation are out of the raw image, so it gets the border value (0) */
+#define PADDING_POSITION (-2)
+
+/*** Function ***/
+int32_t StereoRectifier::LoadCalibration(const std::string& filename)
+{
+    cv::FileStorage fs;
+    try {
+        fs.open(filename, cv::FileStorage::READ);
+    } catch (const cv::Exception& e) {
+        PRINT_E("Failed to read %s (%s)\n", filename.c_str(), e.what());
+        return kRetErr;
+    }
+    if (!fs.isOpened()) {
+        PRINT_E("Failed to open %s\n", filename.c_str());
+        return kRetErr;
+    }
+
+    int32_t image_width = 0;
+    int32_t image_height = 0;
+    fs["image_width"] >> image_width;
+    fs["image_height"] >> image_height;
+    fs["K1"] >> camera_matrix_[0];
+    fs["D1"] >> dist_coeffs_[0];
+    fs["K2"] >> camera_matrix_[1];
+    fs["D2"] >> dist_coeffs_[1];
+    fs["R"] >> rotation_;
+    fs["T"] >> translation_;
+    if (image_width <= 0 || image_height <= 0
+        || camera_matrix_[0].total() != 9 || camera_matrix_[1].total() != 9 || rotation_.total() != 9 || translation_.total() != 3) {
+        PRINT_E("Invalid calibration in %s\n", filename.c_str());
+        image_size_ = cv::Size();
+        return kRetErr;
+    }
+    image_size_ = cv::Size(image_width, image_height);
+
+    /* Calibration is changed, so the remap table must be created again */
+    dst_w_ = 0;
+    dst_h_ = 0;
+    return kRetOk;
+}
+
+void StereoRectifier::Create(int32_t dst_w, int32_t dst_h, int32_t crop_type)
+{
+    if (!IsCalibrationLoaded()) return;
+
+    /* Rectification at the calibration size. alpha = 0: only valid pixels are in the rectified image */
+    cv::Mat rect_rotation[2];
+    cv::Mat rect_projection[2];
+    cv::Mat q;
+    cv::stereoRectify(camera_matrix_[0], dist_coeffs_[0], camera_matrix_[1], dist_coeffs_[1], image_size_, rotation_, translation_,
+        rect_rotation[0], rect_rotation[1], rect_projection[0], rect_projection[1], q, cv::CALIB_ZERO_DISPARITY, 0);
+
+    /* Crop area in the rectified image which corresponds to the whole dst image */
+    int32_t crop_x = 0;
+    int32_t crop_y = 0;
+    int32_t crop_w = image_size_.width;
+    int32_t crop_h = image_size_.height;
+    CommonHelper::ImageRect src_rect;
+    CommonHelper::ImageRect target_rect;
+    CommonHelper::CalculateCropResizeArea(dst_w, dst_h, crop_type, crop_x, crop_y, crop_w, crop_h, src_rect, target_rect);
+
+    /* Fold crop and resize into the new projection: u_dst = (u_rect - crop_x + 0.5) * scale - 0.5 (the same mapping as cv::resize) */
+    const double scale_x = static_cast<double>(dst_w) / crop_w;
+    const double scale_y = static_cast<double>(dst_h) / crop_h;
+    cv::Mat to_dst = (cv::Mat_<double>(3, 3) <<
+        scale_x, 0, (0.5 - crop_x) * scale_x - 0.5,
+        0, scale_y, (0.5 - crop_y) * scale_y - 0.5,
+        0, 0, 1);
+    /* The projection maps padding of kCropTypeExpand to the raw image too (it's outside of the crop area, not of the raw image) */
+    /* So, padding (outside of target_rect) is mapped out of the raw image explicitly */
+    const cv::Rect padding_list[4] = {
+        cv::Rect(0, 0, dst_w, target_rect.y),                                                                   /* top */
+        cv::Rect(0, target_rect.y + target_rect.height, dst_w, dst_h - target_rect.y - target_rect.height),    /* bottom */
+        cv::Rect(0, target_rect.y, target_rect.x, target_rect.height),                                          /* left */
+        cv::Rect(target_rect.x + target_rect.width, target_rect.y, dst_w - target_rect.x - target_rect.width, target_rect.height),  /* right */
+    };
+    for (int32_t i = 0; i < 2; i++) {
+        cv::Mat projection = to_dst * rect_projection[i];
+        cv::initUndistortRectifyMap(camera_matrix_[i], dist_coeffs_[i], rect_rotation[i], projection, cv::Size(dst_w, dst_h), CV_16SC2, map_xy_[i], map_frac_[i]);
+        for (const auto& padding : padding_list) {
+            if (padding.width > 0 && padding.height > 0) map_xy_[i](padding).setTo(cv::Scalar(PADDING_POSITION, PADDING_POSITION));
+        }
+    }
+
+    dst_w_ = dst_w;
+    dst_h_ = dst_h;
+    crop_type_ = crop_type;
+    crop_x_ = crop_x;
+    crop_y_ = crop_y;
+    crop_w_ = crop_w;
+    crop_h_ = crop_h;
+}
+
+bool StereoRectifier::IsSame(int32_t dst_w, int32_t dst_h, int32_t crop_type) const
+{
+    return IsCreated() && dst_w == dst_w_ && dst_h == dst_h_ && crop_type == crop_type_;
+}
+
+int32_t StereoRectifier::Rectify(const cv::Mat& raw_l, const cv::Mat& raw_r, cv::Mat& dst_l, cv::Mat& dst_r)
+{
+    if (!IsCreated()) {
+        PRINT_E("Remap table is not created\n");
+        return kRetErr;
+    }
+    if (raw_l.size() != image_size_ || raw_r.size() != image_size_ || raw_l.type() != raw_r.type()) {
+        PRINT_E("Input size (%d x %d, %d x %d) is different from calibration (%d x %d)\n", raw_l.cols, raw_l.rows, raw_r.cols, raw_r.rows, image_size_.width, image_size_.height);
+        return kRetErr;
+    }
+    dst_l.create(dst_h_, dst_w_, raw_l.type());
+    dst_r.create(dst_h_, dst_w_, raw_r.type());
+
+    /* Stripes of the left view then the right view are processed in one parallel loop */
+    /* cv::parallel_for_ is used (not OpenMP) so that cv::remap called inside runs on the calling thread (nested parallel_for_ is serialized) */
+    const int32_t stripe_num_per_view = (dst_h_ + STRIPE_ROWS - 1) / STRIPE_ROWS;
+    cv::parallel_for_(cv::Range(0, 2 * stripe_num_per_view), [&](const cv::Range& range) {
+        for (int32_t stripe = range.start; stripe < range.end; stripe++) {
+            const int32_t view = stripe / stripe_num_per_view;
+            const int32_t y_start = (stripe % stripe_num_per_view) * STRIPE_ROWS;
+            const int32_t rows = (std::min)(STRIPE_ROWS, dst_h_ - y_start);
+            const cv::Rect area(0, y_start, dst_w_, rows);
+            cv::Mat dst_stripe = ((view == 0) ? dst_l : dst_r)(area);
+            cv::remap((view == 0) ? raw_l : raw_r, dst_stripe, map_xy_[view](area), map_frac_[view](area), cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar::all(0));
+        }
+    });
+
+    return kRetOk;
+}
+
+void StereoRectifier::GetCropArea(int32_t& crop_x, int32_t& crop_y, int32_t& crop_w, int32_t& crop_h) const
+{
+    crop_x = crop_x_;
+    crop_y = crop_y_;
+    crop_w = crop_w_;
+    crop_h = crop_h_;
+}
@@ -0,0 +1,82 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef STEREO_RECTIFIER_
+#define STEREO_RECTIFIER_
+
+/* for general */
+#include <cstdint>
+#include <string>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+/* for My modules */
+#include "image_preprocess.h"
+
+/* Rectify a stereo pair from raw cameras and resize it to the model input in one remap pass */
+/* Undistortion, rectification, crop and resize of each view are combined into one remap table calculated in Create */
+/* Calibration file (cv::FileStorage: yaml / xml / json):                                       */
+/*   image_width, image_height: size of the raw camera image                                     */
+/*   K1, D1, K2, D2: camera matrix (3x3) and distortion coefficients of the left / right camera   */
+/*   R, T: rotation (3x3) and translation (3x1) from the left camera to the right camera          */
+class StereoRectifier {
+public:
+    enum {
+        kRetOk = 0,
+        kRetErr = -1,
+    };
+
+public:
+    StereoRectifier() : dst_w_(0), dst_h_(0), crop_type_(CommonHelper::kCropTypeStretch), crop_x_(0), crop_y_(0), crop_w_(0), crop_h_(0) {}
+    ~StereoRectifier() {}
+
+    int32_t LoadCalibration(const std::string& filename);
+    bool IsCalibrationLoaded() const { return image_size_.area() > 0; }
+
+    /* Calculate the remap table from the raw image to dst_w x dst_h */
+    /* crop_type is applied to the rectified image (same rule as CropResizeCvt). Padding (kCropTypeExpand) is mapped out of the raw image, so it's filled with 0 */
+    void Create(int32_t dst_w, int32_t dst_h, int32_t crop_type);
+    bool IsSame(int32_t dst_w, int32_t dst_h, int32_t crop_type) const;
+    bool IsCreated() const { return dst_w_ > 0; }
+
+    /* raw_l, raw_r: image of the calibration size. dst_l, dst_r: allocated as dst_w x dst_h with the same type as raw */
+    /* Row stripes of both views are processed in the same parallel loop */
+    int32_t Rectify(const cv::Mat& raw_l, const cv::Mat& raw_r, cv::Mat& dst_l, cv::Mat& dst_r);
+
+    /* Area of the rectified image (calibration size) which corresponds to the whole dst image */
+    void GetCropArea(int32_t& crop_x, int32_t& crop_y, int32_t& crop_w, int32_t& crop_h) const;
+    const cv::Size& GetImageSize() const { return image_size_; }
+
+private:
+    /* Calibration */
+    cv::Size image_size_;
+    cv::Mat camera_matrix_[2];
+    cv::Mat dist_coeffs_[2];
+    cv::Mat rotation_;
+    cv::Mat translation_;
+
+    /* Calculated */
+    int32_t dst_w_;
+    int32_t dst_h_;
+    int32_t crop_type_;
+    int32_t crop_x_;
+    int32_t crop_y_;
+    int32_t crop_w_;
+    int32_t crop_h_;
+    cv::Mat map_xy_[2];         /* CV_16SC2: integer position */
+    cv::Mat map_frac_[2];       /* CV_16UC1: index of interpolation weight */
+};
+
+#endif
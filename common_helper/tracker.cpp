@@ -21,25 +21,34 @@ limitations under the License.
 #include <list>
 #include <array>
 #include <memory>
+#include <utility>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 /* for My modules */
 #include "common_helper.h"
 #include "bounding_box.h"
 #include "tracker.h"
-#include "hungarian_algorithm.h"
 
 
-Track::Track(const int32_t id, const BoundingBox& bbox_det)
+Track::Track(const int32_t id, const BoundingBox& bbox_det, KalmanBankTrack& kalman_bank, double timestamp)
 {
     Data data;
     data.bbox = bbox_det;
     data.bbox_raw = bbox_det;
     data_history_.push_back(data);
 
-    kf_ = CreateKalmanFilter_UniformLinearMotion(bbox_det);
+    /* First internal status */
+    FixedMatrix<kNumStatus, kNumStatus> P0 = FixedMatrix<kNumStatus, kNumStatus>::IdentityMatrix();
+    P0 = P0 * 10;   /* Set big noise at first to make K=1 and trust observed value rather than estimated value */
+    kalman_bank_ = &kalman_bank;
+    kalman_slot_ = kalman_bank.Add(Bbox2KalmanStatus(bbox_det), P0);
 
     cnt_detected_ = 1;
     cnt_undetected_ = 0;
+    last_detected_time_ = timestamp;
     id_ = id;
 }
 
@@ -47,12 +56,16 @@ Track::~Track()
 {
 }
 
-BoundingBox Track::Predict()
+void Track::Release()
 {
-    kf_.Predict();
+    kalman_bank_->Remove(kalman_slot_);
+    kalman_slot_ = -1;
+}
 
+BoundingBox Track::Predict()
+{
     BoundingBox bbox = GetLatestBoundingBox();
-    BoundingBox bbox_pred = KalmanStatus2Bbox(kf_.X);   // w, y, w, h only
+    BoundingBox bbox_pred = KalmanStatus2Bbox(kalman_bank_->GetStatus(kalman_slot_));   // w, y, w, h only
     bbox.w = bbox_pred.w;
     bbox.h = bbox_pred.h;
     bbox.x = bbox_pred.x;
@@ -62,25 +75,51 @@ BoundingBox Track::Predict()
     Data data;
     data.bbox = bbox;
     data.bbox_raw = bbox;
-    data_history_.push_back(data);
-    if (data_history_.size() > kMaxHistoryNum) {
-        data_history_.pop_front();
-    }
+    data_history_.push_back(data);     /* the oldest one is dropped when the history is full */
+
+    return bbox;
+}
+
+BoundingBox Track::GetPredictedBoundingBox() const
+{
+    BoundingBox bbox = GetLatestBoundingBox();
+    BoundingBox bbox_pred = KalmanStatus2Bbox(kalman_bank_->GetPredictedStatus(kalman_slot_));   // w, y, w, h only
+    bbox.w = bbox_pred.w;
+    bbox.h = bbox_pred.h;
+    bbox.x = bbox_pred.x;
+    bbox.y = bbox_pred.y;
+    return bbox;
+}
 
+BoundingBox Track::GetExtrapolatedBoundingBox(double dt) const
+{
+    KalmanBankTrack::Status X = kalman_bank_->GetStatus(kalman_slot_);
+    X(0, 0) += X(4, 0) * dt;
+    X(1, 0) += X(5, 0) * dt;
+    X(2, 0) = (std::max)(X(2, 0) + X(6, 0) * dt, 1.0);    /* area must be positive even for a long extrapolation */
+    BoundingBox bbox = GetLatestBoundingBox();
+    BoundingBox bbox_pred = KalmanStatus2Bbox(X);   // w, y, w, h only
+    bbox.w = bbox_pred.w;
+    bbox.h = bbox_pred.h;
+    bbox.x = bbox_pred.x;
+    bbox.y = bbox_pred.y;
     return bbox;
 }
 
-void Track::Update(const BoundingBox& bbox_det)
+void Track::SetObservation(const BoundingBox& bbox_det)
 {
-    kf_.Update(Bbox2KalmanObserved(bbox_det));
+    kalman_bank_->SetObservation(kalman_slot_, Bbox2KalmanObserved(bbox_det));
+}
 
+void Track::Update(const BoundingBox& bbox_det, double timestamp)
+{
     Data data;
     data.bbox = bbox_det;
     data.bbox_raw = bbox_det;
 
     BoundingBox& bbox = data_history_.back().bbox;
     BoundingBox& bbox_raw = data_history_.back().bbox_raw;
-    BoundingBox bbox_est = KalmanStatus2Bbox(kf_.X);   // w, y, w, h only
+    BoundingBox bbox_est = KalmanStatus2Bbox(kalman_bank_->GetStatus(kalman_slot_));   // w, y, w, h only
     bbox_raw = bbox_det;
     bbox = bbox_det;
     bbox.w = bbox_est.w;
@@ -90,6 +129,7 @@ void Track::Update(const BoundingBox& bbox_det)
     
     cnt_detected_++;
     cnt_undetected_ = 0;
+    last_detected_time_ = timestamp;
 }
 
 void Track::UpdateNoDetect()
@@ -97,7 +137,7 @@ void Track::UpdateNoDetect()
     cnt_undetected_++;
 }
 
-std::deque<Track::Data>& Track::GetDataHistory()
+const Track::DataHistory& Track::GetDataHistory() const
 {
     return data_history_;
 }
@@ -127,38 +167,19 @@ const int32_t Track::GetDetectedCount() const
     return cnt_detected_;
 }
 
-
-static constexpr int32_t kNumObserve = 4;   /* (cx, cy, area, aspect) */
-static constexpr int32_t kNumStatus = 7;    /* (cx, cy, area, aspect, vx, vy, vz)   (v = speed)*/
-KalmanFilter Track::CreateKalmanFilter_UniformLinearMotion(const BoundingBox& bbox_start)
+double Track::GetLastDetectedTime() const
 {
-    /*** X(t) = F * X(t-1) + w(t) ***/
-    /* Matrix to calculate X(t) from X(t-1). assume uniform motion: x(t) = x(t-1) + vt, v(t) = v(t-1) */
-    const SimpleMatrix F(kNumStatus, kNumStatus, {
-        1, 0, 0, 0, 1, 0, 0,
-        0, 1, 0, 0, 0, 1, 0,
-        0, 0, 1, 0, 0, 0, 1,
-        0, 0, 0, 1, 0, 0, 0,
-        0, 0, 0, 0, 1, 0, 0,
-        0, 0, 0, 0, 0, 1, 0,
-        0, 0, 0, 0, 0, 0, 1,
-        });
-
+    return last_detected_time_;
+}
 
-    /* w(t), = noise, follows Q */
-    const SimpleMatrix Q(kNumStatus, kNumStatus, {
-        1, 0, 0, 0,    0,    0,     0,
-        0, 1, 0, 0,    0,    0,     0,
-        0, 0, 1, 0,    0,    0,     0,
-        0, 0, 0, 1,    0,    0,     0,
-        0, 0, 0, 0, 0.01,    0,     0,
-        0, 0, 0, 0,    0, 0.01,     0,
-        0, 0, 0, 0,    0,    0, 0.001,
-        });
 
+constexpr int32_t Track::kNumObserve;  // for link error in Android Studio (clang)
+constexpr int32_t Track::kNumStatus;
+void Track::InitializeKalmanBank(KalmanBankTrack& kalman_bank)
+{
     /*** Z(t) = H * X(t) + v(t) ***/
     /* Matrix to calculate Z(observed value) from X(internal status) */
-    const SimpleMatrix H(kNumObserve, kNumStatus, {
+    const FixedMatrix<kNumObserve, kNumStatus> H({
         1, 0, 0, 0, 0, 0, 0,
         0, 1, 0, 0, 0, 0, 0,
         0, 0, 1, 0, 0, 0, 0,
@@ -166,35 +187,52 @@ KalmanFilter Track::CreateKalmanFilter_UniformLinearMotion(const BoundingBox& bb
         });
 
     /* v(t), = noise, follows R */
-    const SimpleMatrix R(kNumObserve, kNumObserve, {
+    const FixedMatrix<kNumObserve, kNumObserve> R({
         1, 0,  0,  0,
         0, 1,  0,  0,
         0, 0, 10,  0,
         0, 0,  0, 10,
         });
 
-    /* First internal status */
-    SimpleMatrix P0 = SimpleMatrix::IdentityMatrix(kNumStatus);
-    P0 = P0 * 10;   /* Set big noise at first to make K=1 and trust observed value rather than estimated value */
-
-    const SimpleMatrix X0 = Bbox2KalmanStatus(bbox_start);
-
-    KalmanFilter kf;
-    kf.Initialize(
-        F,
-        Q,
+    kalman_bank.Initialize(
+        FixedMatrix<kNumStatus, kNumStatus>::IdentityMatrix(),
+        FixedMatrix<kNumStatus, kNumStatus>::Zeros(),
         H,
-        R,
-        X0,
-        P0
+        R
     );
+    SetKalmanBankInterval(kalman_bank, 1.0);
+}
 
-    return kf;
+void Track::SetKalmanBankInterval(KalmanBankTrack& kalman_bank, double dt)
+{
+    /*** X(t) = F * X(t-dt) + w(t) ***/
+    /* Matrix to calculate X(t) from X(t-dt). assume uniform motion: x(t) = x(t-dt) + v * dt, v(t) = v(t-dt) */
+    kalman_bank.F = FixedMatrix<kNumStatus, kNumStatus>({
+        1, 0, 0, 0, dt,  0,  0,
+        0, 1, 0, 0,  0, dt,  0,
+        0, 0, 1, 0,  0,  0, dt,
+        0, 0, 0, 1,  0,  0,  0,
+        0, 0, 0, 0,  1,  0,  0,
+        0, 0, 0, 0,  0,  1,  0,
+        0, 0, 0, 0,  0,  0,  1,
+        });
+
+    /* w(t), = noise, follows Q. noise is accumulated in proportion to the elapsed time (random walk) */
+    const FixedMatrix<kNumStatus, kNumStatus> Q({
+        1, 0, 0, 0,    0,    0,     0,
+        0, 1, 0, 0,    0,    0,     0,
+        0, 0, 1, 0,    0,    0,     0,
+        0, 0, 0, 1,    0,    0,     0,
+        0, 0, 0, 0, 0.01,    0,     0,
+        0, 0, 0, 0,    0, 0.01,     0,
+        0, 0, 0, 0,    0,    0, 0.001,
+        });
+    kalman_bank.Q = Q * dt;
 }
 
-SimpleMatrix Track::Bbox2KalmanStatus(const BoundingBox& bbox)
+Track::KalmanBankTrack::Status Track::Bbox2KalmanStatus(const BoundingBox& bbox)
 {
-    SimpleMatrix X(kNumStatus, 1, {
+    KalmanBankTrack::Status X({
         static_cast<double>(bbox.x + bbox.w / 2),
         static_cast<double>(bbox.y + bbox.h / 2),
         static_cast<double>(bbox.w * bbox.h),
@@ -206,9 +244,9 @@ SimpleMatrix Track::Bbox2KalmanStatus(const BoundingBox& bbox)
     return X;
 }
 
-SimpleMatrix Track::Bbox2KalmanObserved(const BoundingBox& bbox)
+Track::KalmanBankTrack::Observed Track::Bbox2KalmanObserved(const BoundingBox& bbox)
 {
-    SimpleMatrix Z(kNumObserve, 1, {
+    KalmanBankTrack::Observed Z({
         static_cast<double>(bbox.x + bbox.w / 2),
         static_cast<double>(bbox.y + bbox.h / 2),
         static_cast<double>(bbox.w * bbox.h),
@@ -217,7 +255,7 @@ SimpleMatrix Track::Bbox2KalmanObserved(const BoundingBox& bbox)
     return Z;
 }
 
-BoundingBox Track::KalmanStatus2Bbox(const SimpleMatrix& X)
+BoundingBox Track::KalmanStatus2Bbox(const KalmanBankTrack::Status& X) const
 {
     BoundingBox bbox;
     bbox.w = static_cast<int32_t>(std::sqrt(X(2, 0) * X(3, 0)));
@@ -232,7 +270,12 @@ BoundingBox Track::KalmanStatus2Bbox(const SimpleMatrix& X)
 constexpr float Tracker::kCostMax;  // for link error in Android Studio (clang)
 Tracker::Tracker()
 {
+    Track::InitializeKalmanBank(kalman_bank_);
     track_sequence_num_ = 0;
+    last_timestamp_ = -1;
+    dt_ = 1.0;
+    frame_interval_ = 1.0 / 30;
+    threshold_time_to_delete_ = 0;
     threshold_frame_to_delete_ = 2;
     threshold_iou_to_track_ = 0.3F;
 }
@@ -243,26 +286,53 @@ Tracker::~Tracker()
 
 void Tracker::Reset()
 {
-    track_list_.clear();
+    track_pool_.Clear();
+    kalman_bank_.Clear();
     track_sequence_num_ = 0;
+    last_timestamp_ = -1;
 }
 
+void Tracker::SetFrameInterval(double frame_interval)
+{
+    frame_interval_ = frame_interval;
+}
 
-std::vector<Track>& Tracker::GetTrackList()
+void Tracker::SetThresholdTimeToDelete(double threshold_time)
 {
-    return track_list_;
+    threshold_time_to_delete_ = threshold_time;
 }
 
-float Tracker::CalculateSimilarity(const BoundingBox& bbox0, const BoundingBox& bbox1)
+
+const Tracker::TrackPool& Tracker::GetTrackPool() const
+{
+    return track_pool_;
+}
+
+const Track* Tracker::GetTrack(const TrackPool::Handle& handle) const
+{
+    return track_pool_.Get(handle);
+}
+
+void Tracker::GetExtrapolatedBoundingBoxList(double timestamp, std::vector<BoundingBox>& bbox_list, std::vector<const Track*>& track_list) const
+{
+    const double dt = (last_timestamp_ < 0) ? 0 : (timestamp - last_timestamp_) / frame_interval_;
+    bbox_list.clear();
+    track_list.clear();
+    for (const auto& track : track_pool_) {
+        bbox_list.push_back(track.GetExtrapolatedBoundingBox(dt));
+        track_list.push_back(&track);
+    }
+}
+
+float Tracker::CalculateSimilarity(float iou, int32_t class_id0, int32_t class_id1)
 {
-    float iou = BoundingBoxUtils::CalculateIoU(bbox0, bbox1);
     if (iou > 0.9) {
         /* must be the same object (do not check class id because class id may be mistaken) */
     } else if (iou < threshold_iou_to_track_) {
         /* cannot be the same object */
         iou = 0;
     } else {
-        if (bbox0.class_id == bbox1.class_id) {
+        if (class_id0 == class_id1) {
             /* can be the same object */
         } else {
             /* cannot be the same object */
@@ -275,37 +345,89 @@ float Tracker::CalculateSimilarity(const BoundingBox& bbox0, const BoundingBox&
 
 void Tracker::Update(const std::vector<BoundingBox>& det_list)
 {
+    const double timestamp = (last_timestamp_ < 0) ? 0 : last_timestamp_ + frame_interval_;
+    UpdateImpl(det_list, 1.0, timestamp);
+}
+
+void Tracker::Update(const std::vector<BoundingBox>& det_list, double timestamp)
+{
+    /* The first update and a timestamp going backward are treated as one frame interval */
+    const double dt = (last_timestamp_ < 0 || timestamp <= last_timestamp_) ? 1.0 : (timestamp - last_timestamp_) / frame_interval_;
+    UpdateImpl(det_list, dt, timestamp);
+}
+
+void Tracker::UpdateImpl(const std::vector<BoundingBox>& det_list, double dt, double timestamp)
+{
+    last_timestamp_ = timestamp;
+    if (dt != dt_) {
+        /* Motion model for the elapsed time. (rebuilt only when the interval changes) */
+        Track::SetKalmanBankInterval(kalman_bank_, dt);
+        dt_ = dt;
+    }
+
     /*** Predict the position at the current frame using the previous status for all tracked bbox ***/
-    std::vector<BoundingBox> bbox_pred_list;
-    for (auto& track : track_list_) {
-        BoundingBox bbox_prd = track.Predict();
-        bbox_pred_list.push_back(bbox_prd);
+    /* Work buffers are class members to avoid allocation every frame */
+    bbox_pred_list_.clear();
+    track_slot_list_.clear();
+    kalman_bank_.PredictAll();
+    for (auto it = track_pool_.begin(); it != track_pool_.end(); ++it) {
+        BoundingBox bbox_prd = it->Predict();
+        bbox_pred_list_.push_back(bbox_prd);
+        track_slot_list_.push_back(it.GetIndex());
     }
 
     /*** Association ***/
-    /* Calculate IoU b/w predicted position and detected position */
-    size_t size_cost_matrix = (std::max)(track_list_.size(), det_list.size());  /* workaround: my hungarian algorithm sometimes outputs wrong result when the input matrix is not squared */
-    std::vector<std::vector<float>> cost_matrix(size_cost_matrix, std::vector<float>(size_cost_matrix, kCostMax));
-    for (size_t i_track = 0; i_track < track_list_.size(); i_track++) {
-        for (size_t i_det = 0; i_det < det_list.size(); i_det++) {
-            cost_matrix[i_track][i_det] = CalculateSimilarity(bbox_pred_list[i_track], det_list[i_det]);
-        }
-    }
+    /* Only pairs which overlap can be associated (cost < kCostMax), so the cost is calculated only for them (gating) */
+    /* and the assignment is solved for each connected component of the bipartite graph. The result is the same as solving the whole matrix */
+    const size_t track_num = track_slot_list_.size();
+    const size_t det_num = det_list.size();
+    box_batch_pred_.Set(bbox_pred_list_);
+    box_batch_det_.Set(det_list);
+    GatherAssociationEdge();
+    DecomposeAssociationGraph();
 
     /* Assign track and det */
-    std::vector<int32_t> det_index_for_track(size_cost_matrix, -1);
-    std::vector<int32_t> track_index_for_det(size_cost_matrix, -1);
-    if (track_list_.size() > 0 && det_list.size() > 0) {
-        HungarianAlgorithm<float> solver(cost_matrix);
-        solver.Solve(det_index_for_track, track_index_for_det);
+    std::vector<int32_t>& det_index_for_track = det_index_for_track_;
+    std::vector<int32_t>& track_index_for_det = track_index_for_det_;
+    det_index_for_track.assign(track_num, -1);
+    track_index_for_det.assign(det_num, -1);
+    const int32_t component_num = static_cast<int32_t>(component_node_offset_list_.size()) - 1;
+    large_component_list_.clear();
+    for (int32_t component = 0; component < component_num; component++) {
+        const int32_t node_num = component_node_offset_list_[component + 1] - component_node_offset_list_[component];
+        if (node_num == 2) {
+            /* 1x1: the only edge is the answer */
+            const AssociationEdge& edge = component_edge_list_[component_edge_offset_list_[component]];
+            det_index_for_track[edge.track] = edge.det;
+            track_index_for_det[edge.det] = edge.track;
+        } else {
+            large_component_list_.push_back(component);
+        }
+    }
+    /* One thread when called in a parallel region (e.g. one tracker per stream in TrackerManager). Not to nest parallel regions */
+    const size_t thread_num = static_cast<size_t>(CommonHelper::GetParallelThreadNum());
+    if (association_work_list_.size() < thread_num) association_work_list_.resize(thread_num);
+    const int32_t large_component_num = static_cast<int32_t>(large_component_list_.size());
+    if (large_component_num > 1 && thread_num > 1) {
+#pragma omp parallel for schedule(dynamic)
+        for (int32_t i = 0; i < large_component_num; i++) {
+#ifdef _OPENMP
+            AssociationWork& work = association_work_list_[omp_get_thread_num()];
+#else
+            AssociationWork& work = association_work_list_[0];
+#endif
+            SolveComponent(large_component_list_[i], work);
+        }
+    } else {
+        /* Not to enter a parallel region for one thread. (OpenMP runtime may allocate memory for it every time) */
+        for (int32_t i = 0; i < large_component_num; i++) {
+            SolveComponent(large_component_list_[i], association_work_list_[0]);
+        }
     }
 
 #if 0
-    for (size_t i_track = 0; i_track < track_list_.size(); i_track++) {
-        for (size_t i_det = 0; i_det < det_list.size(); i_det++) {
-            printf("%.3f  ", cost_matrix[i_track][i_det]);
-        }
-        printf("\n");
+    for (const auto& edge : edge_list_) {
+        printf("%3d - %3d: %.3f\n", edge.track, edge.det, edge.cost);
     }
 
     printf("track:  det\n");
@@ -319,32 +441,200 @@ void Tracker::Update(const std::vector<BoundingBox>& det_list)
 #endif
 
     /*** Update track ***/
-    std::vector<bool> is_det_assigned_list(size_cost_matrix, false);
-    for (size_t i_track = 0; i_track < track_list_.size(); i_track++) {
+    std::vector<bool>& is_det_assigned_list = is_det_assigned_list_;
+    is_det_assigned_list.assign(det_num, false);
+    for (size_t i_track = 0; i_track < track_num; i_track++) {
         int32_t assigned_det_index = det_index_for_track[i_track];
-        if (assigned_det_index >= 0 && assigned_det_index < static_cast<int32_t>(det_list.size()) && cost_matrix[i_track][assigned_det_index] < kCostMax) {
-            track_list_[i_track].Update(det_list[assigned_det_index]);
+        if (assigned_det_index >= 0) {
+            track_pool_[track_slot_list_[i_track]].SetObservation(det_list[assigned_det_index]);
             is_det_assigned_list[assigned_det_index] = true;
+        }
+    }
+    kalman_bank_.UpdateAll();   /* update Kalman filter of all assigned tracks at once */
+    for (size_t i_track = 0; i_track < track_num; i_track++) {
+        int32_t assigned_det_index = det_index_for_track[i_track];
+        if (assigned_det_index >= 0) {
+            track_pool_[track_slot_list_[i_track]].Update(det_list[assigned_det_index], timestamp);
         } else{
-            track_list_[i_track].UpdateNoDetect();
+            track_pool_[track_slot_list_[i_track]].UpdateNoDetect();
         }
     }
 
     /*** Delete tracks ***/
-    for (auto it = track_list_.begin(); it != track_list_.end();) {
-        if (it->GetUndetectedCount() >= threshold_frame_to_delete_) {
-            it = track_list_.erase(it);
-        } else {
-            it++;
+    /* Tracks coast (keep predicting) for threshold_time_to_delete_ [sec], or threshold_frame_to_delete_ updates */
+    for (auto it = track_pool_.begin(); it != track_pool_.end(); ++it) {
+        const bool is_expired = (threshold_time_to_delete_ > 0)
+            ? (it->GetUndetectedCount() > 0 && timestamp - it->GetLastDetectedTime() >= threshold_time_to_delete_)
+            : (it->GetUndetectedCount() >= threshold_frame_to_delete_);
+        if (is_expired) {
+            it->Release();
+            track_pool_.Remove(it.GetHandle());     /* O(1). the other tracks don't move */
         }
     }
 
     /*** Add new tracks ***/
-    for (size_t i = 0; i < det_list.size(); i++) {
+    for (size_t i = 0; i < det_num; i++) {
         if (is_det_assigned_list[i] == false) {
-            track_list_.push_back(Track(track_sequence_num_, det_list[i]));
+            track_pool_.Insert(Track(track_sequence_num_, det_list[i], kalman_bank_, timestamp));
             track_sequence_num_++;
         }
     }
 }
 
+
+/* Sweep and prune along x axis: items are visited in order of x0, and items whose x1 is left of the current x0 are dropped from the active lists */
+/* So only pairs overlapping in x are checked, then IoU is calculated for pairs overlapping also in y */
+void Tracker::GatherAssociationEdge()
+{
+    const int32_t track_num = box_batch_pred_.Size();
+    const int32_t det_num = box_batch_det_.Size();
+    sweep_list_.clear();
+    for (int32_t i = 0; i < track_num; i++) sweep_list_.push_back(std::make_pair(box_batch_pred_.x0[i], i));
+    for (int32_t i = 0; i < det_num; i++) sweep_list_.push_back(std::make_pair(box_batch_det_.x0[i], track_num + i));
+    std::sort(sweep_list_.begin(), sweep_list_.end());
+
+    edge_list_.clear();
+    active_track_list_.clear();
+    active_det_list_.clear();
+    for (const auto& item : sweep_list_) {
+        const float x0 = item.first;
+        const bool is_track = item.second < track_num;
+        const int32_t index = is_track ? item.second : item.second - track_num;
+        const BoxBatch& batch_cur = is_track ? box_batch_pred_ : box_batch_det_;
+        const BoxBatch& batch_other = is_track ? box_batch_det_ : box_batch_pred_;
+        std::vector<int32_t>& active_other = is_track ? active_det_list_ : active_track_list_;
+        const float y0 = batch_cur.y0[index];
+        const float y1 = batch_cur.y1[index];
+        for (size_t i = 0; i < active_other.size();) {
+            const int32_t index_other = active_other[i];
+            if (batch_other.x1[index_other] <= x0) {
+                active_other[i] = active_other.back();
+                active_other.pop_back();
+                continue;
+            }
+            i++;
+            if ((std::min)(y1, batch_other.y1[index_other]) <= (std::max)(y0, batch_other.y0[index_other])) continue;
+            const int32_t i_track = is_track ? index : index_other;
+            const int32_t i_det = is_track ? index_other : index;
+            float iou;
+            BoundingBoxUtils::CalculateIoU(box_batch_pred_, i_track, box_batch_det_, i_det, i_det + 1, &iou);
+            const float cost = CalculateSimilarity(iou, box_batch_pred_.class_id[i_track], box_batch_det_.class_id[i_det]);
+            if (cost < kCostMax) {
+                AssociationEdge edge;
+                edge.track = i_track;
+                edge.det = i_det;
+                edge.cost = cost;
+                edge_list_.push_back(edge);
+            }
+        }
+        (is_track ? active_track_list_ : active_det_list_).push_back(index);
+    }
+}
+
+int32_t Tracker::FindRoot(int32_t node)
+{
+    while (parent_list_[node] != node) {
+        parent_list_[node] = parent_list_[parent_list_[node]];  /* path halving */
+        node = parent_list_[node];
+    }
+    return node;
+}
+
+/* Split the bipartite graph (edge_list_) into connected components using union-find */
+/* Nodes without edges are not included in any component (they are never assigned) */
+void Tracker::DecomposeAssociationGraph()
+{
+    const int32_t track_num = box_batch_pred_.Size();
+    const int32_t node_num = track_num + box_batch_det_.Size();
+    parent_list_.resize(node_num);
+    for (int32_t i = 0; i < node_num; i++) parent_list_[i] = i;
+    for (const auto& edge : edge_list_) {
+        const int32_t root0 = FindRoot(edge.track);
+        const int32_t root1 = FindRoot(track_num + edge.det);
+        if (root0 != root1) parent_list_[root1] = root0;
+    }
+
+    /* Number components by their roots, then copy the id to the other nodes. (isolated nodes keep -1) */
+    component_id_list_.assign(node_num, -1);
+    int32_t component_num = 0;
+    for (const auto& edge : edge_list_) {
+        const int32_t root = FindRoot(edge.track);
+        if (component_id_list_[root] < 0) component_id_list_[root] = component_num++;
+    }
+    for (int32_t i = 0; i < node_num; i++) {
+        if (parent_list_[i] != i) component_id_list_[i] = component_id_list_[FindRoot(i)];
+    }
+
+    /* Nodes sorted by component (counting sort). tracks come first in each component because track nodes have smaller index */
+    component_node_offset_list_.assign(component_num + 1, 0);
+    component_track_num_list_.assign(component_num, 0);
+    for (int32_t i = 0; i < node_num; i++) {
+        const int32_t component = component_id_list_[i];
+        if (component < 0) continue;
+        component_node_offset_list_[component + 1]++;
+        if (i < track_num) component_track_num_list_[component]++;
+    }
+    for (int32_t component = 0; component < component_num; component++) {
+        component_node_offset_list_[component + 1] += component_node_offset_list_[component];
+    }
+    component_node_list_.resize(component_node_offset_list_[component_num]);
+    local_index_list_.resize(node_num);
+    for (int32_t i = 0; i < node_num; i++) {
+        const int32_t component = component_id_list_[i];
+        if (component < 0) continue;
+        const int32_t pos = component_node_offset_list_[component]++;
+        component_node_list_[pos] = i;
+    }
+    for (int32_t component = component_num; component > 0; component--) {
+        component_node_offset_list_[component] = component_node_offset_list_[component - 1];
+    }
+    component_node_offset_list_[0] = 0;
+    for (int32_t component = 0; component < component_num; component++) {
+        const int32_t offset = component_node_offset_list_[component];
+        const int32_t offset_det = offset + component_track_num_list_[component];
+        for (int32_t pos = offset; pos < component_node_offset_list_[component + 1]; pos++) {
+            local_index_list_[component_node_list_[pos]] = pos - (pos < offset_det ? offset : offset_det);
+        }
+    }
+
+    /* Edges sorted by component (counting sort) */
+    component_edge_offset_list_.assign(component_num + 1, 0);
+    for (const auto& edge : edge_list_) {
+        component_edge_offset_list_[component_id_list_[edge.track] + 1]++;
+    }
+    for (int32_t component = 0; component < component_num; component++) {
+        component_edge_offset_list_[component + 1] += component_edge_offset_list_[component];
+    }
+    component_edge_list_.resize(edge_list_.size());
+    for (const auto& edge : edge_list_) {
+        component_edge_list_[component_edge_offset_list_[component_id_list_[edge.track]]++] = edge;
+    }
+    for (int32_t component = component_num; component > 0; component--) {
+        component_edge_offset_list_[component] = component_edge_offset_list_[component - 1];
+    }
+    component_edge_offset_list_[0] = 0;
+}
+
+/* Solve the assignment of one component with a small dense cost matrix. Pairs without edge have kCostMax and are never assigned */
+void Tracker::SolveComponent(int32_t component, AssociationWork& work)
+{
+    const int32_t offset = component_node_offset_list_[component];
+    const int32_t local_track_num = component_track_num_list_[component];
+    const int32_t local_det_num = component_node_offset_list_[component + 1] - offset - local_track_num;
+    const int32_t track_num = box_batch_pred_.Size();
+    work.cost_matrix.assign(local_track_num * local_det_num, kCostMax);
+    for (int32_t i = component_edge_offset_list_[component]; i < component_edge_offset_list_[component + 1]; i++) {
+        const AssociationEdge& edge = component_edge_list_[i];
+        work.cost_matrix[local_index_list_[edge.track] * local_det_num + local_index_list_[track_num + edge.det]] = edge.cost;
+    }
+    work.solver.SetCostMatrix(work.cost_matrix.data(), local_track_num, local_det_num);
+    work.solver.Solve(work.det_for_track, work.track_for_det);
+    for (int32_t i = 0; i < local_track_num; i++) {
+        const int32_t i_local_det = work.det_for_track[i];
+        if (i_local_det < 0 || work.cost_matrix[i * local_det_num + i_local_det] >= kCostMax) continue;
+        const int32_t i_track = component_node_list_[offset + i];
+        const int32_t i_det = component_node_list_[offset + local_track_num + i_local_det] - track_num;
+        det_index_for_track_[i_track] = i_det;
+        track_index_for_det_[i_det] = i_track;
+    }
+}
@@ -24,50 +24,68 @@ limitations under the License.
 #include <list>
 #include <array>
 #include <memory>
+#include <utility>
 
 /* for My modules */
 #include "bounding_box.h"
-#include "kalman_filter.h"
+#include "box_batch.h"
+#include "kalman_bank.h"
+#include "ring_buffer.h"
+#include "slot_map.h"
+#include "lapjv_algorithm.h"
 
 
 class Track {
 private:
     static constexpr int32_t kMaxHistoryNum = 30;
+    static constexpr int32_t kNumObserve = 4;   /* (cx, cy, area, aspect) */
+    static constexpr int32_t kNumStatus = 7;    /* (cx, cy, area, aspect, vx, vy, vz)   (v = speed)*/
 
 public:
     typedef struct Data_ {
         BoundingBox bbox;
         BoundingBox bbox_raw;
     } Data;
+    typedef RingBuffer<Data, kMaxHistoryNum> DataHistory;
+    typedef KalmanBank<kNumStatus, kNumObserve> KalmanBankTrack;
 
 public:
-    Track(const int32_t id, const BoundingBox& bbox_det);
+    /* Kalman filter status of the track is kept in a slot of kalman_bank (shared by all tracks of a Tracker) */
+    Track(const int32_t id, const BoundingBox& bbox_det, KalmanBankTrack& kalman_bank, double timestamp = 0);
     ~Track();
-
-    BoundingBox Predict();
-    void Update(const BoundingBox& bbox_det);
+    static void InitializeKalmanBank(KalmanBankTrack& kalman_bank);
+    static void SetKalmanBankInterval(KalmanBankTrack& kalman_bank, double dt);   /* dt: elapsed time in frames (F and Q are made for dt = 1) */
+    void Release();                                 /* release the slot of kalman_bank. call before deleting the track */
+
+    BoundingBox Predict();                          /* call after KalmanBankTrack::PredictAll */
+    BoundingBox GetPredictedBoundingBox() const;    /* position at the next frame, assuming the same interval as the last update. (the status is not updated) */
+    BoundingBox GetExtrapolatedBoundingBox(double dt) const;    /* position after dt [frame] from the last update, assuming uniform motion. (the status is not updated) */
+    void SetObservation(const BoundingBox& bbox_det);
+    void Update(const BoundingBox& bbox_det, double timestamp = 0);     /* call after SetObservation and KalmanBankTrack::UpdateAll */
     void UpdateNoDetect();
 
-    std::deque<Data>& GetDataHistory();
+    const DataHistory& GetDataHistory() const;
     const Data& GetLatestData() const ;
     const BoundingBox& GetLatestBoundingBox() const;
 
     const int32_t GetId() const;
     const int32_t GetUndetectedCount() const;
     const int32_t GetDetectedCount() const;
+    double GetLastDetectedTime() const;
 
 private:
-    KalmanFilter CreateKalmanFilter_UniformLinearMotion(const BoundingBox& bbox_start);
-    SimpleMatrix Bbox2KalmanObserved(const BoundingBox& bbox);
-    SimpleMatrix Bbox2KalmanStatus(const BoundingBox& bbox);
-    BoundingBox KalmanStatus2Bbox(const SimpleMatrix& X);
+    KalmanBankTrack::Observed Bbox2KalmanObserved(const BoundingBox& bbox);
+    KalmanBankTrack::Status Bbox2KalmanStatus(const BoundingBox& bbox);
+    BoundingBox KalmanStatus2Bbox(const KalmanBankTrack::Status& X) const;
 
 private:
-    std::deque<Data> data_history_;
-    KalmanFilter kf_;
+    DataHistory data_history_;
+    KalmanBankTrack* kalman_bank_;
+    int32_t kalman_slot_;
     int32_t id_;
     int32_t cnt_detected_;
     int32_t cnt_undetected_;
+    double last_detected_time_;
 };
 
 
@@ -75,21 +93,84 @@ class Tracker {
 private:
     static constexpr float kCostMax = 1.0F;
 
+public:
+    /* Tracks are kept in slots and never move, so a handle (or a reference) of a track is valid until the track is deleted */
+    /* Tracks are read only from outside. (they are deleted only by Tracker, which releases their slots of the Kalman bank) */
+    typedef SlotMap<Track> TrackPool;
+
 public:
     Tracker();
     ~Tracker();
+    Tracker(const Tracker&) = delete;
+    Tracker& operator=(const Tracker&) = delete;
     void Reset();
 
-    void Update(const std::vector<BoundingBox>& det_list);
+    void Update(const std::vector<BoundingBox>& det_list);                      /* one frame interval has passed since the last update */
+    void Update(const std::vector<BoundingBox>& det_list, double timestamp);    /* timestamp [sec]. for skipped frames and irregular frame timing */
+
+    void SetFrameInterval(double frame_interval);               /* [sec]. the interval the motion model is made for (default 1/30) */
+    void SetThresholdTimeToDelete(double threshold_time);       /* [sec]. delete a track not detected for this time. (0 = use frame count) */
 
-    std::vector<Track>& GetTrackList();
+    const TrackPool& GetTrackPool() const;     /* iterate over live tracks: for (const auto& track : tracker.GetTrackPool()) */
+    const Track* GetTrack(const TrackPool::Handle& handle) const;     /* nullptr if the track has been deleted */
+
+    /* Position of all tracks at timestamp [sec], extrapolated from the last update. bbox_list[i] is for track_list[i] */
+    /* The status is not updated, so this can be called at display rate between updates at inference rate */
+    void GetExtrapolatedBoundingBoxList(double timestamp, std::vector<BoundingBox>& bbox_list, std::vector<const Track*>& track_list) const;
+
+private:
+    /* Candidate pair of track and det (edge of bipartite graph) */
+    typedef struct AssociationEdge_ {
+        int32_t track;
+        int32_t det;
+        float cost;
+    } AssociationEdge;
+
+    /* Work buffers used to solve one connected component (one per thread) */
+    typedef struct AssociationWork_ {
+        LapjvAlgorithm<float> solver;
+        std::vector<float> cost_matrix;
+        std::vector<int32_t> det_for_track;
+        std::vector<int32_t> track_for_det;
+    } AssociationWork;
 
 private:
-    float CalculateSimilarity(const BoundingBox& bbox0, const BoundingBox& bbox1);
+    float CalculateSimilarity(float iou, int32_t class_id0, int32_t class_id1);
+    void UpdateImpl(const std::vector<BoundingBox>& det_list, double dt, double timestamp);
+    void GatherAssociationEdge();
+    void DecomposeAssociationGraph();
+    void SolveComponent(int32_t component, AssociationWork& work);
+    int32_t FindRoot(int32_t node);
 
 private:
-    std::vector<Track> track_list_;
+    TrackPool track_pool_;
+    Track::KalmanBankTrack kalman_bank_;    /* Kalman filter status of all tracks (tracks refer to it, so Tracker must not be copied) */
+    BoxBatch box_batch_pred_;           /* work buffer for predicted bbox of tracks */
+    BoxBatch box_batch_det_;            /* work buffer for detected bbox */
+    std::vector<BoundingBox> bbox_pred_list_;               /* work buffer */
+    std::vector<int32_t> track_slot_list_;                  /* work buffer (slot index in track_pool_ for each track index) */
+    std::vector<std::pair<float, int32_t>> sweep_list_;     /* work buffer for gating (x0, node) sorted by x0 */
+    std::vector<int32_t> active_track_list_;                /* work buffer for gating */
+    std::vector<int32_t> active_det_list_;                  /* work buffer for gating */
+    std::vector<AssociationEdge> edge_list_;                /* work buffer (candidate pairs only) */
+    std::vector<AssociationEdge> component_edge_list_;      /* work buffer (edge_list_ sorted by component) */
+    std::vector<int32_t> parent_list_;                      /* work buffer for union-find. node = track index, or track_num + det index */
+    std::vector<int32_t> component_id_list_;                /* work buffer (component id of each node, -1 for isolated node) */
+    std::vector<int32_t> component_node_offset_list_;       /* work buffer (offset to component_node_list_, component_num + 1) */
+    std::vector<int32_t> component_node_list_;              /* work buffer (nodes sorted by component. tracks first, then dets) */
+    std::vector<int32_t> component_track_num_list_;         /* work buffer */
+    std::vector<int32_t> component_edge_offset_list_;       /* work buffer (offset to component_edge_list_, component_num + 1) */
+    std::vector<int32_t> local_index_list_;                 /* work buffer (index of each node in its component) */
+    std::vector<int32_t> large_component_list_;             /* work buffer (components which need the solver) */
+    std::vector<AssociationWork> association_work_list_;    /* one per thread */
+    std::vector<int32_t> det_index_for_track_;              /* work buffer */
+    std::vector<int32_t> track_index_for_det_;              /* work buffer */
+    std::vector<bool> is_det_assigned_list_;                /* work buffer */
     int32_t track_sequence_num_;
+    double last_timestamp_;             /* timestamp of the last update (-1 before the first update) */
+    double dt_;                         /* interval [frame] which kalman_bank_ is set for */
+    double frame_interval_;
+    double threshold_time_to_delete_;
 
     int32_t threshold_frame_to_delete_;
     float threshold_iou_to_track_;
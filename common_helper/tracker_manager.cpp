@@ -0,0 +1,151 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/* for general */
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+
+/* for My modules */
+#include "common_helper.h"
+#include "bounding_box.h"
+#include "tracker.h"
+#include "tracker_manager.h"
+
+
+TrackerManager::TrackerManager()
+{
+    update_count_ = 0;
+    threshold_idle_to_evict_ = 300;
+}
+
+TrackerManager::~TrackerManager()
+{
+}
+
+void TrackerManager::Reset()
+{
+    stream_map_.clear();
+    update_count_ = 0;
+}
+
+void TrackerManager::SetThresholdIdleToEvict(int32_t threshold_idle_to_evict)
+{
+    threshold_idle_to_evict_ = threshold_idle_to_evict;
+}
+
+Tracker& TrackerManager::GetOrCreateTracker(int32_t stream_id)
+{
+    Stream& stream = stream_map_[stream_id];
+    if (!stream.tracker) {
+        stream.tracker.reset(new Tracker());
+        stream.last_update_count = update_count_;
+    }
+    return *stream.tracker;
+}
+
+Tracker* TrackerManager::GetTracker(int32_t stream_id)
+{
+    auto it = stream_map_.find(stream_id);
+    return (it == stream_map_.end()) ? nullptr : it->second.tracker.get();
+}
+
+void TrackerManager::Remove(int32_t stream_id)
+{
+    stream_map_.erase(stream_id);
+}
+
+size_t TrackerManager::GetStreamNum() const
+{
+    return stream_map_.size();
+}
+
+void TrackerManager::Update(int32_t stream_id, const std::vector<BoundingBox>& det_list, double timestamp)
+{
+    single_update_list_.resize(1);
+    single_update_list_[0].stream_id = stream_id;
+    single_update_list_[0].det_list = &det_list;
+    single_update_list_[0].timestamp = timestamp;
+    Update(single_update_list_);
+}
+
+void TrackerManager::Update(const std::vector<StreamUpdate>& update_list)
+{
+    update_count_++;
+
+    /* Group updates by stream. Sorting by (stream_id, index) keeps the order in each stream */
+    const int32_t update_num = static_cast<int32_t>(update_list.size());
+    order_list_.clear();
+    for (int32_t i = 0; i < update_num; i++) {
+        order_list_.push_back(std::make_pair(update_list[i].stream_id, i));
+    }
+    std::sort(order_list_.begin(), order_list_.end());
+
+    /* Trackers are created here (not in the parallel region) because stream_map_ is not thread safe */
+    group_offset_list_.clear();
+    group_tracker_list_.clear();
+    for (int32_t i = 0; i < update_num; i++) {
+        const int32_t stream_id = order_list_[i].first;
+        if (i == 0 || stream_id != order_list_[i - 1].first) {
+            group_offset_list_.push_back(i);
+            group_tracker_list_.push_back(&GetOrCreateTracker(stream_id));
+            stream_map_[stream_id].last_update_count = update_count_;
+        }
+    }
+    group_offset_list_.push_back(update_num);
+
+    /* Each stream is processed by one thread. Streams are distributed dynamically because the number of objects varies */
+    /* Each tracker uses one thread inside the parallel region. A single stream is updated outside of it, so that its tracker can use all threads */
+    const int32_t group_num = static_cast<int32_t>(group_tracker_list_.size());
+    if (group_num > 1 && CommonHelper::GetParallelThreadNum() > 1) {
+#pragma omp parallel for schedule(dynamic)
+        for (int32_t group = 0; group < group_num; group++) {
+            UpdateGroup(update_list, group);
+        }
+    } else {
+        for (int32_t group = 0; group < group_num; group++) {
+            UpdateGroup(update_list, group);
+        }
+    }
+
+    EvictIdleStream();
+}
+
+void TrackerManager::UpdateGroup(const std::vector<StreamUpdate>& update_list, int32_t group)
+{
+    Tracker& tracker = *group_tracker_list_[group];
+    for (int32_t i = group_offset_list_[group]; i < group_offset_list_[group + 1]; i++) {
+        const StreamUpdate& update = update_list[order_list_[i].second];
+        if (update.timestamp < 0) {
+            tracker.Update(*update.det_list);
+        } else {
+            tracker.Update(*update.det_list, update.timestamp);
+        }
+    }
+}
+
+void TrackerManager::EvictIdleStream()
+{
+    if (threshold_idle_to_evict_ <= 0) return;
+    for (auto it = stream_map_.begin(); it != stream_map_.end();) {
+        if (update_count_ - it->second.last_update_count >= threshold_idle_to_evict_) {
+            it = stream_map_.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
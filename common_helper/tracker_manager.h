@@ -0,0 +1,78 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TRACKER_MANAGER_
+#define TRACKER_MANAGER_
+
+/* for general */
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <unordered_map>
+
+/* for My modules */
+#include "bounding_box.h"
+#include "tracker.h"
+
+
+/* Tracker for each stream (camera), keyed by stream id */
+/* Updates of different streams run in parallel. Updates of the same stream run in the order of the list */
+class TrackerManager {
+public:
+    typedef struct StreamUpdate_ {
+        int32_t stream_id;
+        const std::vector<BoundingBox>* det_list;   /* must be valid during Update */
+        double timestamp;                           /* [sec]. negative value means one frame interval has passed (see Tracker::Update) */
+    } StreamUpdate;
+
+public:
+    TrackerManager();
+    ~TrackerManager();
+    TrackerManager(const TrackerManager&) = delete;
+    TrackerManager& operator=(const TrackerManager&) = delete;
+    void Reset();
+
+    /* A stream which has not been updated in the last threshold_idle_to_evict calls of Update is deleted. (0 = never) */
+    void SetThresholdIdleToEvict(int32_t threshold_idle_to_evict);
+
+    void Update(const std::vector<StreamUpdate>& update_list);
+    void Update(int32_t stream_id, const std::vector<BoundingBox>& det_list, double timestamp = -1);
+
+    Tracker& GetOrCreateTracker(int32_t stream_id);
+    Tracker* GetTracker(int32_t stream_id);     /* nullptr if the stream doesn't exist */
+    void Remove(int32_t stream_id);
+    size_t GetStreamNum() const;
+
+private:
+    typedef struct Stream_ {
+        std::unique_ptr<Tracker> tracker;
+        int64_t last_update_count;
+    } Stream;
+
+private:
+    void UpdateGroup(const std::vector<StreamUpdate>& update_list, int32_t group);
+    void EvictIdleStream();
+
+private:
+    std::unordered_map<int32_t, Stream> stream_map_;
+    int64_t update_count_;
+    int32_t threshold_idle_to_evict_;
+    std::vector<std::pair<int32_t, int32_t>> order_list_;   /* work buffer (stream_id, index in update_list) */
+    std::vector<int32_t> group_offset_list_;                /* work buffer (offset to order_list_ for each stream) */
+    std::vector<Tracker*> group_tracker_list_;              /* work buffer */
+    std::vector<StreamUpdate> single_update_list_;          /* work buffer */
+};
+
+#endif
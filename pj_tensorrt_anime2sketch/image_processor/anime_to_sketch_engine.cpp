@@ -74,6 +74,9 @@ int32_t Anime2SketchEngine::Initialize(const std::string& work_dir, const int32_
         return kRetErr;
     }
 
+    /* Allocate work buffer for pre-process in advance */
+    img_src_ = cv::Mat::zeros(input_tensor_info_list_[0].GetHeight(), input_tensor_info_list_[0].GetWidth(), CV_8UC3);
+
     return kRetOk;
 }
 
@@ -102,7 +105,8 @@ int32_t Anime2SketchEngine::Process(const cv::Mat& original_mat, Result& result)
     int32_t crop_y = 0;
     int32_t crop_w = original_mat.cols;
     int32_t crop_h = original_mat.rows;
-    cv::Mat img_src = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
+    cv::Mat& img_src = img_src_;   /* allocated in Initialize */
+    img_src.setTo(0);               /* clear the padding area for kCropTypeExpand */
     //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeStretch);
     //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeCut);
     CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeExpand);
@@ -134,7 +138,7 @@ int32_t Anime2SketchEngine::Process(const cv::Mat& original_mat, Result& result)
     /*** PostProcess ***/
     const auto& t_post_process0 = std::chrono::steady_clock::now();
     cv::Mat outmat_fp(cv::Size(output_tensor_info_list_[0].tensor_dims[3], output_tensor_info_list_[0].tensor_dims[2]), CV_32FC1, const_cast<float*>(output_tensor_info_list_[0].GetDataAsFloat()));
-    cv::Mat out_mat;
+    cv::Mat& out_mat = mat_out_;    /* reuse the buffer of the previous frame */
     outmat_fp.convertTo(out_mat, CV_8UC1, 128);
     const auto& t_post_process1 = std::chrono::steady_clock::now();
 
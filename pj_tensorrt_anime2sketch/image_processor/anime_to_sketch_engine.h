@@ -23,6 +23,7 @@ public:
         kRetErr = -1,
     };
 
+    /* image refers to the work buffer of the engine (not copied). It's overwritten by the next Process. Clone it to keep it */
     typedef struct Result_ {
         cv::Mat           image;
         double            time_pre_process;		// [msec]
@@ -44,6 +45,8 @@ private:
     std::unique_ptr<InferenceHelper> inference_helper_;
     std::vector<InputTensorInfo> input_tensor_info_list_;
     std::vector<OutputTensorInfo> output_tensor_info_list_;
+    cv::Mat img_src_;                           /* work buffer for pre-process */
+    cv::Mat mat_out_;                           /* work buffer for post-process */
 };
 
 #endif
@@ -17,6 +17,7 @@
 /* for My modules */
 #include "common_helper.h"
 #include "common_helper_cv.h"
+#include "host_tensor.h"
 #include "inference_helper.h"
 #include "inference_helper_tensorrt.h"      // to call SetDlaCore
 #include "classification_engine.h"
@@ -30,32 +31,56 @@
 #define MODEL_NAME   "mobilenetv2-7.onnx"
 // #define MODEL_NAME   "mobilenetv2-7.trt"
 #define TENSORTYPE    TensorInfo::kTensorTypeFp32
+#define HOST_TENSOR_TYPE  CommonHelper::kHostTensorTypeFp32
+//#define TENSORTYPE    TensorInfo::kTensorTypeFp16     /* the inference helper needs to support fp16 tensor */
+//#define HOST_TENSOR_TYPE  CommonHelper::kHostTensorTypeFp16
+//#define TENSORTYPE    TensorInfo::kTensorTypeUint8
+//#define HOST_TENSOR_TYPE  CommonHelper::kHostTensorTypeUint8
+/* Quantization of uint8 input: value = (q - zero_point) * scale. It is not in the model file, so set the values used to quantize the model */
+#define INPUT_QUANT_SCALE       0.0f                /* 0 = not set (Initialize fails for uint8 input) */
+#define INPUT_QUANT_ZERO_POINT  0
 #define INPUT_NAME   "data"
 #define INPUT_DIMS    { 1, 3, 224, 224 }
 #define IS_NCHW       true
 #define IS_RGB        true
 #define OUTPUT_NAME  "mobilenetv20_output_flatten0_reshape0"
+static constexpr float kMeanList[3] = { 0.485f, 0.456f, 0.406f };   /* https://github.com/onnx/models/tree/master/vision/classification/mobilenet#preprocessing */
+static constexpr float kNormList[3] = { 0.229f, 0.224f, 0.225f };
 
 #define LABEL_NAME   "label_imagenet.txt"
 
 /*** Function ***/
+/* Output tensor as it is on host memory. fp16 / uint8 tensor is not converted to float as a whole (GetDataAsFloat does) */
+static CommonHelper::HostTensorView GetOutputView(const OutputTensorInfo& output_tensor_info)
+{
+    return CommonHelper::HostTensorView(output_tensor_info.data, HOST_TENSOR_TYPE, output_tensor_info.quant.scale, output_tensor_info.quant.zero_point);
+}
+
 int32_t ClassificationEngine::Initialize(const std::string& work_dir, const int32_t num_threads)
 {
     /* Set model information */
     std::string model_filename = work_dir + "/model/" + MODEL_NAME;
     std::string label_filename = work_dir + "/model/" + LABEL_NAME;
 
+    if (HOST_TENSOR_TYPE == CommonHelper::kHostTensorTypeUint8 && !(INPUT_QUANT_SCALE > 0.0f)) {
+        PRINT_E("Quantization of uint8 input is not set. Set INPUT_QUANT_SCALE and INPUT_QUANT_ZERO_POINT for the model\n");
+        return kRetErr;
+    }
+
     /* Set input tensor info */
     input_tensor_info_list_.clear();
     InputTensorInfo input_tensor_info(INPUT_NAME, TENSORTYPE, IS_NCHW);
     input_tensor_info.tensor_dims = INPUT_DIMS;
-    input_tensor_info.data_type = InputTensorInfo::kDataTypeImage;
-    input_tensor_info.normalize.mean[0] = 0.485f;   	/* https://github.com/onnx/models/tree/master/vision/classification/mobilenet#preprocessing */
-    input_tensor_info.normalize.mean[1] = 0.456f;
-    input_tensor_info.normalize.mean[2] = 0.406f;
-    input_tensor_info.normalize.norm[0] = 0.229f;
-    input_tensor_info.normalize.norm[1] = 0.224f;
-    input_tensor_info.normalize.norm[2] = 0.225f;
+    /* Crop, resize, color conversion and normalization are done in one pass into NCHW blob in this class */
+    input_tensor_info.data_type = InputTensorInfo::kDataTypeBlobNchw;
+    for (int32_t i = 0; i < 3; i++) {
+        input_tensor_info.normalize.mean[i] = kMeanList[i];
+        input_tensor_info.normalize.norm[i] = kNormList[i];
+    }
+    if (batch_size_ > 1) {
+        /* Batch mode: images are converted to NCHW blob in this class and inferred as one batch */
+        input_tensor_info.tensor_dims[0] = batch_size_;
+    }
     input_tensor_info_list_.push_back(input_tensor_info);
 
     /* Set output tensor info */
@@ -63,6 +88,8 @@ int32_t ClassificationEngine::Initialize(const std::string& work_dir, const int3
     output_tensor_info_list_.push_back(OutputTensorInfo(OUTPUT_NAME, TENSORTYPE));
 
     /* Create and Initialize Inference Helper */
+    /* kOpencv runs on CPU without GPU. Batch mode works with it too because the input is NCHW blob created in this class */
+    // inference_helper_.reset(InferenceHelper::Create(InferenceHelper::kOpencv));
     inference_helper_.reset(InferenceHelper::Create(InferenceHelper::kTensorrt));
 
     if (!inference_helper_) {
@@ -79,6 +106,10 @@ int32_t ClassificationEngine::Initialize(const std::string& work_dir, const int3
         return kRetErr;
     }
 
+    /* Allocate work buffer for pre-process in advance */
+    batch_blob_.Create(batch_size_, input_tensor_info_list_[0].GetWidth(), input_tensor_info_list_[0].GetHeight(), HOST_TENSOR_TYPE, kMeanList, kNormList, IS_RGB);
+    batch_blob_.SetQuantization(INPUT_QUANT_SCALE, INPUT_QUANT_ZERO_POINT);
+
     /* read label */
     if (ReadLabel(label_filename, label_list_) != kRetOk) {
         return kRetErr;
@@ -105,31 +136,22 @@ int32_t ClassificationEngine::Process(const cv::Mat& original_mat, Result& resul
         PRINT_E("Inference helper is not created\n");
         return kRetErr;
     }
+    if (batch_size_ > 1) {
+        /* The model input is a batch of blob */
+        return ProcessBatch(&original_mat, &result, 1);
+    }
     /*** PreProcess ***/
     const auto& t_pre_process0 = std::chrono::steady_clock::now();
     InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
 
-    /* do resize and color conversion here because some inference engine doesn't support these operations */
-    int32_t crop_x = 0;
-    int32_t crop_y = 0;
-    int32_t crop_w = original_mat.cols;
-    int32_t crop_h = original_mat.rows;
-    cv::Mat img_src = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
-    //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeStretch);
-    //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeCut);
-    CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeExpand);
-
-    input_tensor_info.data = img_src.data;
-    input_tensor_info.data_type = InputTensorInfo::kDataTypeImage;
-    input_tensor_info.image_info.width = img_src.cols;
-    input_tensor_info.image_info.height = img_src.rows;
-    input_tensor_info.image_info.channel = img_src.channels();
-    input_tensor_info.image_info.crop_x = 0;
-    input_tensor_info.image_info.crop_y = 0;
-    input_tensor_info.image_info.crop_width = img_src.cols;
-    input_tensor_info.image_info.crop_height = img_src.rows;
-    input_tensor_info.image_info.is_bgr = false;
-    input_tensor_info.image_info.swap_color = false;
+    /* do resize, color conversion and normalization here because some inference engine doesn't support these operations */
+    /* The original image is read only once and written into the blob directly. The tables are re-calculated only when the image size changes */
+    if (batch_blob_.Write(0, original_mat, cv::Rect(0, 0, original_mat.cols, original_mat.rows)) != BatchBlob::kRetOk) {
+        PRINT_E("Input image must be 3-channel uint8\n");
+        return kRetErr;
+    }
+
+    input_tensor_info.data = batch_blob_.GetData();
 
     if (inference_helper_->PreProcess(input_tensor_info_list_) != InferenceHelper::kRetOk) {
         return kRetErr;
@@ -146,16 +168,12 @@ int32_t ClassificationEngine::Process(const cv::Mat& original_mat, Result& resul
     /*** PostProcess ***/
     const auto& t_post_process0 = std::chrono::steady_clock::now();
     /* Retrieve the result */
-    std::vector<float> output_score_list;
-    output_score_list.resize(output_tensor_info_list_[0].GetElementNum());
-    const float* val_float = output_tensor_info_list_[0].GetDataAsFloat();
-    for (int32_t i = 0; i < (int32_t)output_score_list.size(); i++) {
-        output_score_list[i] = val_float[i];
-    }
+    const CommonHelper::HostTensorView output_score_list = GetOutputView(output_tensor_info_list_[0]);   /* refer the tensor directly without copy */
+    const int32_t output_score_num = output_tensor_info_list_[0].GetElementNum();
 
     /* Find the max score */
-    int32_t max_index = (int32_t)(std::max_element(output_score_list.begin(), output_score_list.end()) - output_score_list.begin());
-    auto max_score = *std::max_element(output_score_list.begin(), output_score_list.end());
+    float max_score = 0;
+    int32_t max_index = output_score_list.ArgMax(0, output_score_num, max_score);
     PRINT("Result = %s (%d) (%.3f)\n", label_list_[max_index].c_str(), max_index, max_score);
     const auto& t_post_process1 = std::chrono::steady_clock::now();
 
@@ -171,6 +189,77 @@ int32_t ClassificationEngine::Process(const cv::Mat& original_mat, Result& resul
 }
 
 
+int32_t ClassificationEngine::ProcessBatch(const std::vector<cv::Mat>& original_mat_list, std::vector<Result>& result_list)
+{
+    result_list.resize(original_mat_list.size());
+    if (original_mat_list.empty()) return kRetOk;
+    return ProcessBatch(original_mat_list.data(), result_list.data(), static_cast<int32_t>(original_mat_list.size()));
+}
+
+int32_t ClassificationEngine::ProcessBatch(const cv::Mat* original_mat_list, Result* result_list, int32_t num)
+{
+    if (!inference_helper_) {
+        PRINT_E("Inference helper is not created\n");
+        return kRetErr;
+    }
+    if (batch_size_ <= 1) {
+        for (int32_t i = 0; i < num; i++) {
+            if (Process(original_mat_list[i], result_list[i]) != kRetOk) return kRetErr;
+        }
+        return kRetOk;
+    }
+
+    InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
+    for (int32_t batch_start = 0; batch_start < num; batch_start += batch_size_) {
+        const int32_t batch_num = (std::min)(batch_size_, num - batch_start);
+
+        /*** PreProcess ***/
+        /* Each image is written into its own area of the blob. (images, or rows of each image, are processed in parallel) */
+        const auto& t_pre_process0 = std::chrono::steady_clock::now();
+        if (batch_blob_.WriteImageList(original_mat_list + batch_start, batch_num) != BatchBlob::kRetOk) {
+            PRINT_E("Input image must be 3-channel uint8\n");
+            return kRetErr;
+        }
+        input_tensor_info.data = batch_blob_.GetData();
+        input_tensor_info.data_type = InputTensorInfo::kDataTypeBlobNchw;
+        if (inference_helper_->PreProcess(input_tensor_info_list_) != InferenceHelper::kRetOk) {
+            return kRetErr;
+        }
+        const auto& t_pre_process1 = std::chrono::steady_clock::now();
+
+        /*** Inference ***/
+        const auto& t_inference0 = std::chrono::steady_clock::now();
+        if (inference_helper_->Process(output_tensor_info_list_) != InferenceHelper::kRetOk) {
+            return kRetErr;
+        }
+        const auto& t_inference1 = std::chrono::steady_clock::now();
+
+        /*** PostProcess ***/
+        /* Scores of each item are stored contiguously. (the remaining items of the last batch are ignored) */
+        const CommonHelper::HostTensorView output_score_list_all = GetOutputView(output_tensor_info_list_[0]);
+        const int32_t output_score_num = output_tensor_info_list_[0].GetElementNum() / batch_size_;
+        for (int32_t i_batch = 0; i_batch < batch_num; i_batch++) {
+            const auto& t_post_process0 = std::chrono::steady_clock::now();
+            float max_score = 0;
+            int32_t max_index = output_score_list_all.ArgMax(i_batch * output_score_num, output_score_num, max_score);
+            PRINT("Result[%d] = %s (%d) (%.3f)\n", batch_start + i_batch, label_list_[max_index].c_str(), max_index, max_score);
+            const auto& t_post_process1 = std::chrono::steady_clock::now();
+
+            /* Return the results */
+            Result& result = result_list[batch_start + i_batch];
+            result.class_id = max_index;
+            result.class_name = label_list_[max_index];
+            result.score = max_score;
+            result.time_pre_process = static_cast<std::chrono::duration<double>>(t_pre_process1 - t_pre_process0).count() * 1000.0;
+            result.time_inference = static_cast<std::chrono::duration<double>>(t_inference1 - t_inference0).count() * 1000.0;
+            result.time_post_process = static_cast<std::chrono::duration<double>>(t_post_process1 - t_post_process0).count() * 1000.0;
+        }
+    }
+
+    return kRetOk;
+}
+
+
 int32_t ClassificationEngine::ReadLabel(const std::string& filename, std::vector<std::string>& label_list)
 {
     std::ifstream ifs(filename);
@@ -14,6 +14,8 @@
 
 /* for My modules */
 #include "inference_helper.h"
+#include "batch_blob.h"
+#include "host_tensor.h"
 
 
 class ClassificationEngine {
@@ -38,20 +40,32 @@ private:
     static constexpr bool with_background = false;
 
 public:
-    ClassificationEngine() {}
+    ClassificationEngine() {
+        batch_size_ = 1;
+    }
     ~ClassificationEngine() {}
     int32_t Initialize(const std::string& work_dir, const int32_t num_threads);
     int32_t Finalize(void);
     int32_t Process(const cv::Mat& original_mat, Result& result);
+    /* Process multiple images (e.g. from multiple cameras) with one inference for each batch_size images. The result of original_mat_list[i] is stored in result_list[i] */
+    /* time_pre_process and time_inference are the time of the batch which the image belongs to */
+    int32_t ProcessBatch(const std::vector<cv::Mat>& original_mat_list, std::vector<Result>& result_list);
+    /* Call before Initialize. The model needs to accept the batch size */
+    void SetBatchSize(int32_t batch_size) {
+        batch_size_ = batch_size;
+    }
 
 private:
     int32_t ReadLabel(const std::string& filename, std::vector<std::string>& label_list);
+    int32_t ProcessBatch(const cv::Mat* original_mat_list, Result* result_list, int32_t num);
 
 private:
     std::unique_ptr<InferenceHelper> inference_helper_;
     std::vector<InputTensorInfo> input_tensor_info_list_;
     std::vector<OutputTensorInfo> output_tensor_info_list_;
     std::vector<std::string> label_list_;
+    BatchBlob batch_blob_;                      /* work buffer for pre-process (NCHW blob of all batches in HOST_TENSOR_TYPE) */
+    int32_t batch_size_;
 };
 
 #endif
@@ -110,6 +110,9 @@ int32_t DepthEngine::Initialize(const std::string& work_dir, const int32_t num_t
         return kRetErr;
     }
 
+    /* Allocate work buffer for pre-process in advance */
+    img_src_ = cv::Mat::zeros(input_tensor_info_list_[0].GetHeight(), input_tensor_info_list_[0].GetWidth(), CV_8UC3);
+
     return kRetOk;
 }
 
@@ -140,7 +143,7 @@ int32_t DepthEngine::Process(const cv::Mat& original_mat, Result& result)
     int32_t crop_y = 0;
     int32_t crop_w = original_mat.cols;
     int32_t crop_h = original_mat.rows;
-    cv::Mat img_src = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
+    cv::Mat& img_src = img_src_;   /* allocated in Initialize */
     CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeCut);
 
     input_tensor_info.data = img_src.data;
@@ -174,18 +177,18 @@ int32_t DepthEngine::Process(const cv::Mat& original_mat, Result& result)
     // int32_t output_channel = 1;
     float* values = output_tensor_info_list_[0].GetDataAsFloat();
     //printf("%f, %f, %f\n", values[0], values[100], values[400]);
-    cv::Mat mat_out = cv::Mat(output_height, output_width, CV_32FC1, values);  /* value has no specific range */
+    cv::Mat mat_out_fp = cv::Mat(output_height, output_width, CV_32FC1, values);  /* value has no specific range */
+    cv::Mat& out_mat = mat_out_;    /* reuse the buffer of the previous frame */
 
     //double depth_min, depth_max;
-    //cv::minMaxLoc(mat_out, &depth_min, &depth_max);
-    //mat_out.convertTo(mat_out, CV_8UC1, 255. / (depth_max - depth_min), (-255. * depth_min) / (depth_max - depth_min));
-    //mat_out.convertTo(mat_out, CV_8UC1);
-    mat_out.convertTo(mat_out, CV_8UC1, -5, 255);   /* experimentally deterined */
-    mat_out = mat_out(cv::Rect(0, static_cast<int32_t>(mat_out.rows * 0.18), mat_out.cols, static_cast<int32_t>(mat_out.rows * (1.0 - 0.18))));
+    //cv::minMaxLoc(mat_out_fp, &depth_min, &depth_max);
+    //mat_out_fp.convertTo(out_mat, CV_8UC1, 255. / (depth_max - depth_min), (-255. * depth_min) / (depth_max - depth_min));
+    //mat_out_fp.convertTo(out_mat, CV_8UC1);
+    mat_out_fp.convertTo(out_mat, CV_8UC1, -5, 255);   /* experimentally deterined */
     const auto& t_post_process1 = std::chrono::steady_clock::now();
 
     /* Return the results */
-    result.mat_out = mat_out;
+    result.mat_out = out_mat(cv::Rect(0, static_cast<int32_t>(out_mat.rows * 0.18), out_mat.cols, static_cast<int32_t>(out_mat.rows * (1.0 - 0.18))));
     result.time_pre_process = static_cast<std::chrono::duration<double>>(t_pre_process1 - t_pre_process0).count() * 1000.0;
     result.time_inference = static_cast<std::chrono::duration<double>>(t_inference1 - t_inference0).count() * 1000.0;
     result.time_post_process = static_cast<std::chrono::duration<double>>(t_post_process1 - t_post_process0).count() * 1000.0;;
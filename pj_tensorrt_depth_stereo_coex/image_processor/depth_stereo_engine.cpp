@@ -36,12 +36,24 @@
 #define IS_RGB        false
 #define OUTPUT_NAME  "1603"
 
+/* Stereo calibration of raw cameras (in work_dir). Input images are treated as rectified if empty */
+#define CALIBRATION_NAME  ""
+//#define CALIBRATION_NAME  "stereo_calibration.yaml"
+
 /*** Function ***/
 int32_t DepthStereoEngine::Initialize(const std::string& work_dir, const int32_t num_threads)
 {
     /* Set model information */
     std::string model_filename = work_dir + "/model/" + MODEL_NAME;
 
+    /* Load stereo calibration to rectify raw camera images */
+    const std::string calibration_name = CALIBRATION_NAME;
+    if (!calibration_name.empty()) {
+        if (stereo_rectifier_.LoadCalibration(work_dir + "/" + calibration_name) != StereoRectifier::kRetOk) {
+            return kRetErr;
+        }
+    }
+
     /* Set input tensor info */
     input_tensor_info_list_.clear();
     InputTensorInfo input_tensor_info(INPUT_NAME_0, TENSORTYPE, IS_NCHW);
@@ -78,6 +90,11 @@ int32_t DepthStereoEngine::Initialize(const std::string& work_dir, const int32_t
         return kRetErr;
     }
 
+    /* Allocate work buffer for pre-process in advance */
+    for (int32_t i = 0; i < 2; i++) {
+        img_src_[i] = cv::Mat::zeros(input_tensor_info_list_[i].GetHeight(), input_tensor_info_list_[i].GetWidth(), CV_8UC3);
+    }
+
     return kRetOk;
 }
 
@@ -101,24 +118,36 @@ int32_t DepthStereoEngine::Process(const cv::Mat& image_l, const cv::Mat& image_
 
     /*** PreProcess ***/
     const auto& t_pre_process0 = std::chrono::steady_clock::now();
-    cv::Mat img_src[2];
+    cv::Mat* img_src = img_src_;    /* allocated in Initialize */
     int32_t crop_x;
     int32_t crop_y;
     int32_t crop_w;
     int32_t crop_h;
+    if (stereo_rectifier_.IsCalibrationLoaded()) {
+        /* Undistortion, rectification, crop and resize of both images are done in one remap pass */
+        if (!stereo_rectifier_.IsSame(img_src[0].cols, img_src[0].rows, CommonHelper::kCropTypeCut)) {
+            stereo_rectifier_.Create(img_src[0].cols, img_src[0].rows, CommonHelper::kCropTypeCut);
+        }
+        if (stereo_rectifier_.Rectify(image_l, image_r, img_src[0], img_src[1]) != StereoRectifier::kRetOk) {
+            return kRetErr;
+        }
+        stereo_rectifier_.GetCropArea(crop_x, crop_y, crop_w, crop_h);
+    } else {
+        for (int32_t i = 0; i < 2; i++) {
+            const cv::Mat& original_mat = (i == 0) ? image_l : image_r;
+            /* do resize and color conversion here because some inference engine doesn't support these operations */
+            crop_x = 0;
+            crop_y = 0;
+            crop_w = original_mat.cols;
+            crop_h = original_mat.rows;
+            // CommonHelper::CropResizeCvt(original_mat, img_src[i], crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeStretch);
+            CommonHelper::CropResizeCvt(original_mat, img_src[i], crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeCut);
+            // CommonHelper::CropResizeCvt(original_mat, img_src[i], crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeExpand);
+        }
+    }
+
     for (int32_t i = 0; i < 2; i++) {
         InputTensorInfo& input_tensor_info = input_tensor_info_list_[i];
-        const cv::Mat& original_mat = (i == 0) ? image_l : image_r;
-        /* do resize and color conversion here because some inference engine doesn't support these operations */
-        crop_x = 0;
-        crop_y = 0;
-        crop_w = original_mat.cols;
-        crop_h = original_mat.rows;
-        img_src[i] = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
-        // CommonHelper::CropResizeCvt(original_mat, img_src[i], crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeStretch);
-        CommonHelper::CropResizeCvt(original_mat, img_src[i], crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeCut);
-        // CommonHelper::CropResizeCvt(original_mat, img_src[i], crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeExpand);
-
         input_tensor_info.data = img_src[i].data;
         input_tensor_info.data_type = InputTensorInfo::kDataTypeImage;
         input_tensor_info.image_info.width = img_src[i].cols;
@@ -129,7 +158,7 @@ int32_t DepthStereoEngine::Process(const cv::Mat& image_l, const cv::Mat& image_
         input_tensor_info.image_info.crop_width = img_src[i].cols;
         input_tensor_info.image_info.crop_height = img_src[i].rows;
         input_tensor_info.image_info.is_bgr = false;
-        input_tensor_info.image_info.swap_color = false;
+        input_tensor_info.image_info.swap_color = stereo_rectifier_.IsCalibrationLoaded() && IS_RGB;   /* remap keeps the color order of the camera */
     }
 
     if (inference_helper_->PreProcess(input_tensor_info_list_) != InferenceHelper::kRetOk) {
@@ -151,7 +180,7 @@ int32_t DepthStereoEngine::Process(const cv::Mat& image_l, const cv::Mat& image_
     float* values = output_tensor_info_list_[0].GetDataAsFloat();
 
     cv::Mat out_fp = cv::Mat(output_height, output_width, CV_32FC1, values);
-    cv::Mat out_mat;
+    cv::Mat& out_mat = mat_out_;    /* reuse the buffer of the previous frame */
     out_fp.convertTo(out_mat, CV_8UC1);
 
     const auto& t_post_process1 = std::chrono::steady_clock::now();
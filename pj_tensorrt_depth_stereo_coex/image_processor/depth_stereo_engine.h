@@ -14,6 +14,7 @@
 
 /* for My modules */
 #include "inference_helper.h"
+#include "stereo_rectifier.h"
 
 
 class DepthStereoEngine {
@@ -23,6 +24,7 @@ public:
         kRetErr = -1,
     };
 
+    /* image shares the work buffer of the engine. The next Process overwrites it, so clone it if it's used after that */
     typedef struct Result_ {
         cv::Mat           image;                // [height, width, 1]. value is 0 - 255
         struct crop_ {
@@ -51,6 +53,9 @@ private:
     std::unique_ptr<InferenceHelper> inference_helper_;
     std::vector<InputTensorInfo> input_tensor_info_list_;
     std::vector<OutputTensorInfo> output_tensor_info_list_;
+    cv::Mat img_src_[2];                        /* work buffer for pre-process */
+    StereoRectifier stereo_rectifier_;          /* used if calibration is set */
+    cv::Mat mat_out_;                           /* work buffer for post-process */
 };
 
 #endif
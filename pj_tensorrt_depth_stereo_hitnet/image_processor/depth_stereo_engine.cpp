@@ -47,12 +47,24 @@
 #define OUTPUT_NAME  "reference_output_disparity"
 #define TENSORTYPE    TensorInfo::kTensorTypeFp32
 
+/* Stereo calibration of raw cameras (in work_dir). Input images are treated as rectified if empty */
+#define CALIBRATION_NAME  ""
+//#define CALIBRATION_NAME  "stereo_calibration.yaml"
+
 /*** Function ***/
 int32_t DepthStereoEngine::Initialize(const std::string& work_dir, const int32_t num_threads)
 {
     /* Set model information */
     std::string model_filename = work_dir + "/model/" + MODEL_NAME;
 
+    /* Load stereo calibration to rectify raw camera images */
+    const std::string calibration_name = CALIBRATION_NAME;
+    if (!calibration_name.empty()) {
+        if (stereo_rectifier_.LoadCalibration(work_dir + "/" + calibration_name) != StereoRectifier::kRetOk) {
+            return kRetErr;
+        }
+    }
+
     /* Set input tensor info */
     input_tensor_info_list_.clear();
     InputTensorInfo input_tensor_info(INPUT_NAME, TENSORTYPE, IS_NCHW);
@@ -106,39 +118,41 @@ int32_t DepthStereoEngine::Process(const cv::Mat& image_src_l, const cv::Mat& im
     
     InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
     /* Do preprocess here and set input data as nchw blob because InferenceHelper cannot handle Grayscale x 2 input */
-    cv::Mat image_l;
-    cv::Mat image_r;
-    cv::resize(image_src_l, image_l, cv::Size(input_tensor_info.GetWidth(), input_tensor_info.GetHeight()));
-    cv::resize(image_src_r, image_r, cv::Size(input_tensor_info.GetWidth(), input_tensor_info.GetHeight()));
-    int32_t image_size = input_tensor_info.GetWidth() * input_tensor_info.GetHeight();
-    
+    /* Resize, color conversion and scale of both images are done in one pass. The tables are re-calculated only when the image size changes */
+    if (image_src_l.size() != image_src_r.size() || image_src_l.type() != CV_8UC3 || image_src_r.type() != CV_8UC3) {
+        PRINT_E("Left and right images must be the same size BGR images\n");
+        return kRetErr;
+    }
 #ifdef IS_GRAYSCALE
-    const int32_t image_channel = 1;
-    cv::cvtColor(image_l, image_l, cv::COLOR_BGR2GRAY);
-    cv::cvtColor(image_r, image_r, cv::COLOR_BGR2GRAY);
+    const bool is_gray = true;
 #else
-    const int32_t image_channel = 3;
-    cv::cvtColor(image_l, image_l, cv::COLOR_BGR2RGB);
-    cv::cvtColor(image_r, image_r, cv::COLOR_BGR2RGB);
+    const bool is_gray = false;
 #endif
-    
-    auto data = std::make_unique<float[]>(image_size * image_channel * 2);
-#pragma omp parallel for
-    for (int32_t c = 0; c < image_channel; c++) {
-        for (int32_t i = 0; i < image_size; i++) {
-            data[i + c * image_size] = image_l.data[i * image_channel + c] / 255.0f;
+    int32_t crop_x = 0;
+    int32_t crop_y = 0;
+    int32_t crop_w = image_src_l.cols;
+    int32_t crop_h = image_src_l.rows;
+    const cv::Mat* image_l = &image_src_l;
+    const cv::Mat* image_r = &image_src_r;
+    if (stereo_rectifier_.IsCalibrationLoaded()) {
+        /* Undistortion, rectification and resize to the input size are done in one remap pass, so StereoPacker doesn't resize */
+        if (!stereo_rectifier_.IsSame(input_tensor_info.GetWidth(), input_tensor_info.GetHeight(), CommonHelper::kCropTypeStretch)) {
+            stereo_rectifier_.Create(input_tensor_info.GetWidth(), input_tensor_info.GetHeight(), CommonHelper::kCropTypeStretch);
+        }
+        if (stereo_rectifier_.Rectify(image_src_l, image_src_r, image_rectified_[0], image_rectified_[1]) != StereoRectifier::kRetOk) {
+            return kRetErr;
         }
+        stereo_rectifier_.GetCropArea(crop_x, crop_y, crop_w, crop_h);
+        image_l = &image_rectified_[0];
+        image_r = &image_rectified_[1];
     }
-
-    const int32_t offset_for_right_image = image_size * image_channel;
-#pragma omp parallel for
-    for (int32_t c = 0; c < image_channel; c++) {
-        for (int32_t i = 0; i < image_size; i++) {
-            data[i + c * image_size + offset_for_right_image] = image_r.data[i * image_channel + c] / 255.0f;
+    if (!stereo_packer_.IsSame(image_l->cols, image_l->rows, input_tensor_info.GetWidth(), input_tensor_info.GetHeight(), is_gray)) {
+        if (stereo_packer_.Create(image_l->cols, image_l->rows, input_tensor_info.GetWidth(), input_tensor_info.GetHeight(), is_gray) != StereoPacker::kRetOk) {
+            return kRetErr;
         }
     }
-
-    input_tensor_info.data = data.get();
+    stereo_packer_.Pack(image_l->data, static_cast<int32_t>(image_l->step[0]), image_r->data, static_cast<int32_t>(image_r->step[0]));
+    input_tensor_info.data = stereo_packer_.GetBlob();
    
     if (inference_helper_->PreProcess(input_tensor_info_list_) != InferenceHelper::kRetOk) {
         return kRetErr;
@@ -164,10 +178,10 @@ int32_t DepthStereoEngine::Process(const cv::Mat& image_src_l, const cv::Mat& im
 
     /* Return the results */
     result.image = out_fp;
-    result.crop.x = 0;
-    result.crop.y = 0;
-    result.crop.w = image_src_l.cols;
-    result.crop.h = image_src_l.rows;
+    result.crop.x = crop_x;
+    result.crop.y = crop_y;
+    result.crop.w = crop_w;
+    result.crop.h = crop_h;
     result.time_pre_process = static_cast<std::chrono::duration<double>>(t_pre_process1 - t_pre_process0).count() * 1000.0;
     result.time_inference = static_cast<std::chrono::duration<double>>(t_inference1 - t_inference0).count() * 1000.0;
     result.time_post_process = static_cast<std::chrono::duration<double>>(t_post_process1 - t_post_process0).count() * 1000.0;;
@@ -14,6 +14,8 @@
 
 /* for My modules */
 #include "inference_helper.h"
+#include "stereo_packer.h"
+#include "stereo_rectifier.h"
 
 
 class DepthStereoEngine {
@@ -52,6 +54,9 @@ private:
     std::unique_ptr<InferenceHelper> inference_helper_;
     std::vector<InputTensorInfo> input_tensor_info_list_;
     std::vector<OutputTensorInfo> output_tensor_info_list_;
+    StereoPacker stereo_packer_;                /* pre-process and input tensor (left and right in NCHW) */
+    StereoRectifier stereo_rectifier_;          /* used if calibration is set */
+    cv::Mat image_rectified_[2];                /* work buffer for rectification (input size) */
 };
 
 #endif
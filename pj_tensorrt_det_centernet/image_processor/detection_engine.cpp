@@ -53,9 +53,17 @@ limitations under the License.
 #define HM_HEIGHT  96
 #define HM_WIDTH   96
 #define HM_CHANNEL 80
+#define TOP_K      100  /* max number of peaks to be decoded (K in the original implementation) */
+static constexpr float kMeanList[3] = { 0.408f, 0.447f, 0.470f };
+static constexpr float kNormList[3] = { 0.289f, 0.274f, 0.278f };
 
 #define LABEL_NAME   "label_coco_80.txt"
 
+/* NMS parameters */
+#define NMS_NUM_MAX_PRE_NMS     1000    /* use only the top N boxes as input of NMS */
+#define NMS_NUM_MAX_DETECTION   100     /* stop NMS when N boxes are kept */
+#define NMS_CHECK_CLASS_ID      false   /* true: suppress boxes only in the same class */
+
 
 /*** Function ***/
 int32_t DetectionEngine::Initialize(const std::string& work_dir, const int32_t num_threads)
@@ -68,13 +76,16 @@ int32_t DetectionEngine::Initialize(const std::string& work_dir, const int32_t n
     input_tensor_info_list_.clear();
     InputTensorInfo input_tensor_info(INPUT_NAME, TENSORTYPE, IS_NCHW);
     input_tensor_info.tensor_dims = INPUT_DIMS;
-    input_tensor_info.data_type = InputTensorInfo::kDataTypeImage;
-    input_tensor_info.normalize.mean[0] = 0.408f;
-    input_tensor_info.normalize.mean[1] = 0.447f;
-    input_tensor_info.normalize.mean[2] = 0.470f;
-    input_tensor_info.normalize.norm[0] = 0.289f;
-    input_tensor_info.normalize.norm[1] = 0.274f;
-    input_tensor_info.normalize.norm[2] = 0.278f;
+    /* Crop, resize, color conversion and normalization are done in one pass into NCHW blob in this class */
+    input_tensor_info.data_type = InputTensorInfo::kDataTypeBlobNchw;
+    for (int32_t i = 0; i < 3; i++) {
+        input_tensor_info.normalize.mean[i] = kMeanList[i];
+        input_tensor_info.normalize.norm[i] = kNormList[i];
+    }
+    if (GetBatchSize() > 1) {
+        /* Tiled mode / Batch mode: tiles (images) are converted to NCHW blob in this class and inferred as one batch */
+        input_tensor_info.tensor_dims[0] = GetBatchSize();
+    }
     input_tensor_info_list_.push_back(input_tensor_info);
 
     /* Set output tensor info */
@@ -84,6 +95,7 @@ int32_t DetectionEngine::Initialize(const std::string& work_dir, const int32_t n
     output_tensor_info_list_.push_back(OutputTensorInfo(OUTPUT_NAME_2, TENSORTYPE));
 
     /* Create and Initialize Inference Helper */
+    /* kOpencv runs on CPU without GPU. Tiled / batch mode works with it too because the input is NCHW blob created in this class */
     //inference_helper_.reset(InferenceHelper::Create(InferenceHelper::kOpencv));
     //inference_helper_.reset(InferenceHelper::Create(InferenceHelper::kOpencvGpu));
     inference_helper_.reset(InferenceHelper::Create(InferenceHelper::kTensorrt));
@@ -102,11 +114,26 @@ int32_t DetectionEngine::Initialize(const std::string& work_dir, const int32_t n
         return kRetErr;
     }
 
+    /* Allocate work buffer for pre-process in advance */
+    batch_blob_.Create(GetBatchSize(), input_tensor_info_list_[0].GetWidth(), input_tensor_info_list_[0].GetHeight(), CommonHelper::kHostTensorTypeFp32, kMeanList, kNormList, IS_RGB);
+
     /* read label */
     if (ReadLabel(labelFilename, label_list_) != kRetOk) {
         return kRetErr;
     }
 
+    /* Allocate work buffer for NMS in advance. (the input is at most TOP_K peaks of each tile) */
+    nms_.Reserve(TOP_K * GetTileNum());
+
+    /* Allocate work buffer for decode in advance */
+    peak_list_per_class_.resize(HM_CHANNEL);
+    for (auto& peak_list : peak_list_per_class_) peak_list.reserve(TOP_K);
+    peak_list_.reserve(TOP_K);
+    bbox_list_.reserve(TOP_K * GetTileNum());
+    if (GetBatchSize() > 1) {
+        tile_id_list_.reserve(TOP_K * GetTileNum());
+    }
+
     return kRetOk;
 }
 
@@ -120,36 +147,125 @@ int32_t DetectionEngine::Finalize()
     return kRetOk;
 }
 
+static bool IsPeak(const float* hm, int32_t hm_w, int32_t hm_h, int32_t hm_x, int32_t hm_y)
+{
+    /* same as (max_pool2d(3x3, stride=1, pad=1)(hm) == hm) */
+    const float value = hm[hm_y * hm_w + hm_x];
+    const int32_t y0 = (std::max)(0, hm_y - 1);
+    const int32_t y1 = (std::min)(hm_h - 1, hm_y + 1);
+    const int32_t x0 = (std::max)(0, hm_x - 1);
+    const int32_t x1 = (std::min)(hm_w - 1, hm_x + 1);
+    for (int32_t y = y0; y <= y1; y++) {
+        for (int32_t x = x0; x <= x1; x++) {
+            if (hm[y * hm_w + x] > value) return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+static bool IsHigherScore(const T& lhs, const T& rhs)
+{
+    return lhs.score_logit > rhs.score_logit;
+}
+
+/* Keep the top num_max elements in min-heap */
+template <typename T>
+static void PushToBoundedHeap(std::vector<T>& heap, const T& value, size_t num_max)
+{
+    if (heap.size() < num_max) {
+        heap.push_back(value);
+        std::push_heap(heap.begin(), heap.end(), IsHigherScore<T>);
+    } else if (IsHigherScore(value, heap.front())) {
+        std::pop_heap(heap.begin(), heap.end(), IsHigherScore<T>);
+        heap.back() = value;
+        std::push_heap(heap.begin(), heap.end(), IsHigherScore<T>);
+    }
+}
+
+void DetectionEngine::GetPeakList(const float* hm_list, int32_t hm_c, int32_t hm_h, int32_t hm_w, float threshold_score_logit)
+{
+    /* Find local maximum in each class channel, and keep the top K for each class */
+    const int32_t hm_size = hm_h * hm_w;
+    peak_list_per_class_.resize(hm_c);
+#pragma omp parallel for
+    for (int32_t class_id = 0; class_id < hm_c; class_id++) {
+        const float* hm = hm_list + class_id * hm_size;
+        std::vector<Peak>& peak_list = peak_list_per_class_[class_id];
+        peak_list.clear();
+        for (int32_t hm_y = 0; hm_y < hm_h; hm_y++) {
+            for (int32_t hm_x = 0; hm_x < hm_w; hm_x++) {
+                const int32_t index = hm_y * hm_w + hm_x;
+                if (hm[index] > threshold_score_logit && IsPeak(hm, hm_w, hm_h, hm_x, hm_y)) {
+                    PushToBoundedHeap(peak_list, Peak{ hm[index], class_id, index }, TOP_K);
+                }
+            }
+        }
+    }
+
+    /* Keep the top K in the image */
+    peak_list_.clear();
+    for (const auto& peak_list : peak_list_per_class_) {
+        for (const auto& peak : peak_list) {
+            PushToBoundedHeap(peak_list_, peak, TOP_K);
+        }
+    }
+    std::sort_heap(peak_list_.begin(), peak_list_.end(), IsHigherScore<Peak>);
+}
+
+void DetectionEngine::GetBoundingBox(const float* hm_list, const float* reg_xy_list, const float* reg_wh_list, int32_t hm_c, int32_t hm_h, int32_t hm_w, float threshold_score_logit, float scale_w, float scale_h, std::vector<BoundingBox>& bbox_list)
+{
+    /* https://github.com/xingyizhou/CenterNet/blob/master/src/lib/models/decode.py#L472 */
+    GetPeakList(hm_list, hm_c, hm_h, hm_w, threshold_score_logit);
+
+    for (const auto& peak : peak_list_) {
+        const int32_t hm_x = peak.index % hm_w;
+        const int32_t hm_y = peak.index / hm_w;
+        const int32_t index_x = peak.index;
+        const int32_t index_y = index_x + hm_h * hm_w;
+        const float width = reg_wh_list[index_x];
+        const float height = reg_wh_list[index_y];
+        const float cx = hm_x + reg_xy_list[index_x];  /* no need to add +0.5f according to sample code */
+        const float cy = hm_y + reg_xy_list[index_y];
+        const float x0 = cx - width / 2.0f;
+        const float y0 = cy - height / 2.0f;
+
+        BoundingBox bbox;
+        bbox.class_id = peak.class_id;
+        bbox.score = CommonHelper::Sigmoid(peak.score_logit);
+        bbox.x = static_cast<int32_t>(x0 * 4 * scale_w);
+        bbox.y = static_cast<int32_t>(y0 * 4 * scale_h);
+        bbox.w = static_cast<int32_t>(width * 4 * scale_w);
+        bbox.h = static_cast<int32_t>(height * 4 * scale_h);
+        bbox_list.push_back(bbox);
+    }
+}
+
 int32_t DetectionEngine::Process(const cv::Mat& original_mat, Result& result)
 {
     if (!inference_helper_) {
         PRINT_E("Inference helper is not created\n");
         return kRetErr;
     }
+    if (GetTileNum() > 1) {
+        return ProcessTiled(original_mat, result);
+    }
+    if (GetBatchSize() > 1) {
+        /* The model input is a batch of blob */
+        return ProcessBatch(&original_mat, &result, 1);
+    }
+
     /*** PreProcess ***/
     const auto& t_pre_process0 = std::chrono::steady_clock::now();
     InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
-    /* do crop, resize and color conversion here because some inference engine doesn't support these operations */
-    int32_t crop_x = 0;
-    int32_t crop_y = 0;
-    int32_t crop_w = original_mat.cols;
-    int32_t crop_h = original_mat.rows;
-    cv::Mat img_src = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
-    //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeStretch);
-    //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeCut);
-    CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeExpand);
-
-    input_tensor_info.data = img_src.data;
-    input_tensor_info.data_type = InputTensorInfo::kDataTypeImage;
-    input_tensor_info.image_info.width = img_src.cols;
-    input_tensor_info.image_info.height = img_src.rows;
-    input_tensor_info.image_info.channel = img_src.channels();
-    input_tensor_info.image_info.crop_x = 0;
-    input_tensor_info.image_info.crop_y = 0;
-    input_tensor_info.image_info.crop_width = img_src.cols;
-    input_tensor_info.image_info.crop_height = img_src.rows;
-    input_tensor_info.image_info.is_bgr = false;
-    input_tensor_info.image_info.swap_color = false;
+    /* do crop, resize, color conversion and normalization here because some inference engine doesn't support these operations */
+    /* The original image is read only once and written into the blob directly. The tables are re-calculated only when the image size changes */
+    if (batch_blob_.Write(0, original_mat, cv::Rect(0, 0, original_mat.cols, original_mat.rows)) != BatchBlob::kRetOk) {
+        PRINT_E("Input image must be 3-channel uint8\n");
+        return kRetErr;
+    }
+
+    input_tensor_info.data = batch_blob_.GetData();
     if (inference_helper_->PreProcess(input_tensor_info_list_) != InferenceHelper::kRetOk) {
         return kRetErr;
     }
@@ -165,66 +281,39 @@ int32_t DetectionEngine::Process(const cv::Mat& original_mat, Result& result)
     /*** PostProcess ***/
     const auto& t_post_process0 = std::chrono::steady_clock::now();
     /* Get boundig box */
-    float* hm_list = output_tensor_info_list_[0].GetDataAsFloat();
+    const float* hm_list = output_tensor_info_list_[0].GetDataAsFloat();
     float* reg_xy_list = output_tensor_info_list_[1].GetDataAsFloat();
     float* reg_wh_list = output_tensor_info_list_[2].GetDataAsFloat();
     const int32_t hm_h = output_tensor_info_list_[0].GetHeight() != -1 ? output_tensor_info_list_[0].GetHeight() : HM_HEIGHT;
     const int32_t hm_w = output_tensor_info_list_[0].GetWidth() != -1 ? output_tensor_info_list_[0].GetWidth() : HM_WIDTH;
     const int32_t hm_c = output_tensor_info_list_[0].GetChannel() > 1 ? output_tensor_info_list_[0].GetChannel() : HM_CHANNEL;
     const float threshold_score_logit = CommonHelper::Logit(threshold_class_confidence_);
-    const float scale_w = static_cast<float>(crop_w) / input_tensor_info.GetWidth();
-    const float scale_h = static_cast<float>(crop_h) / input_tensor_info.GetHeight();
+    const cv::Rect& crop = batch_blob_.GetCrop(0);
 
-    /* https://github.com/xingyizhou/CenterNet/blob/master/src/lib/models/decode.py#L472 */
-    std::vector<BoundingBox> bbox_list;
-    for (int32_t class_id = 0; class_id < hm_c; class_id++) {
-        for (int32_t hm_y = 0; hm_y < hm_h; hm_y++) {
-            for (int32_t hm_x = 0; hm_x < hm_w; hm_x++) {
-                const float score_logit = *hm_list;
-                hm_list++;
-                if (score_logit > threshold_score_logit) {
-                    const int32_t index_x = hm_w * hm_y + hm_x;
-                    const int32_t index_y = index_x + hm_h * hm_w;
-                    const float width = reg_wh_list[index_x];
-                    const float height = reg_wh_list[index_y];
-                    const float cx = hm_x + reg_xy_list[index_x];  /* no need to add +0.5f according to sample code */
-                    const float cy = hm_y + reg_xy_list[index_y];
-                    const float x0 = cx - width / 2.0f;
-                    const float y0 = cy - height / 2.0f;
-
-                    BoundingBox bbox;
-                    bbox.class_id = class_id;
-                    bbox.label = label_list_[class_id];
-                    bbox.score = CommonHelper::Sigmoid(score_logit);
-                    bbox.x = static_cast<int32_t>(x0 * 4 * scale_w);
-                    bbox.y = static_cast<int32_t>(y0 * 4 * scale_h);
-                    bbox.w = static_cast<int32_t>(width * 4 * scale_w);
-                    bbox.h = static_cast<int32_t>(height * 4 * scale_h);
-                    bbox_list.push_back(bbox);
-                }
-            }
-        }
-    }
+    std::vector<BoundingBox>& bbox_list = bbox_list_;   /* reserved in Initialize */
+    bbox_list.clear();
+    GetBoundingBox(hm_list, reg_xy_list, reg_wh_list, hm_c, hm_h, hm_w, threshold_score_logit, batch_blob_.GetScaleX(0), batch_blob_.GetScaleY(0), bbox_list);
 
     /* Adjust bounding box */
     for (auto& bbox : bbox_list) {
-        bbox.x += crop_x;  
-        bbox.y += crop_y;
-        bbox.label = label_list_[bbox.class_id];
+        bbox.x += crop.x;
+        bbox.y += crop.y;
     }
 
     /* NMS */
-    std::vector<BoundingBox> bbox_nms_list;
-    BoundingBoxUtils::Nms(bbox_list, bbox_nms_list, threshold_nms_iou_);
+    /* Output to result directly to reuse the buffer of the previous frame if the caller keeps result */
+    std::vector<BoundingBox>& bbox_nms_list = result.bbox_list;
+    nms_.SetParam(threshold_nms_iou_, NMS_NUM_MAX_PRE_NMS, NMS_NUM_MAX_DETECTION, NMS_CHECK_CLASS_ID);
+    nms_.Run(bbox_list, bbox_nms_list);
 
     const auto& t_post_process1 = std::chrono::steady_clock::now();
 
     /* Return the results */
-    result.bbox_list = bbox_nms_list;
-    result.crop.x = (std::max)(0, crop_x);
-    result.crop.y = (std::max)(0, crop_y);
-    result.crop.w = (std::min)(crop_w, original_mat.cols - result.crop.x);
-    result.crop.h = (std::min)(crop_h, original_mat.rows - result.crop.y);
+    const cv::Rect& image_crop = batch_blob_.GetImageCrop(0);
+    result.crop.x = image_crop.x;
+    result.crop.y = image_crop.y;
+    result.crop.w = image_crop.width;
+    result.crop.h = image_crop.height;
     result.time_pre_process = static_cast<std::chrono::duration<double>>(t_pre_process1 - t_pre_process0).count() * 1000.0;
     result.time_inference = static_cast<std::chrono::duration<double>>(t_inference1 - t_inference0).count() * 1000.0;
     result.time_post_process = static_cast<std::chrono::duration<double>>(t_post_process1 - t_post_process0).count() * 1000.0;;
@@ -233,6 +322,159 @@ int32_t DetectionEngine::Process(const cv::Mat& original_mat, Result& result)
 }
 
 
+int32_t DetectionEngine::ProcessTiled(const cv::Mat& original_mat, Result& result)
+{
+    /*** PreProcess ***/
+    const auto& t_pre_process0 = std::chrono::steady_clock::now();
+    InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
+    if (batch_blob_.WriteTileList(original_mat, tile_num_x_, tile_num_y_, tile_overlap_ratio_) != BatchBlob::kRetOk) {
+        PRINT_E("Input image must be 3-channel uint8\n");
+        return kRetErr;
+    }
+    input_tensor_info.data = batch_blob_.GetData();
+    input_tensor_info.data_type = InputTensorInfo::kDataTypeBlobNchw;
+    if (inference_helper_->PreProcess(input_tensor_info_list_) != InferenceHelper::kRetOk) {
+        return kRetErr;
+    }
+    const auto& t_pre_process1 = std::chrono::steady_clock::now();
+
+    /*** Inference ***/
+    const auto& t_inference0 = std::chrono::steady_clock::now();
+    if (inference_helper_->Process(output_tensor_info_list_) != InferenceHelper::kRetOk) {
+        return kRetErr;
+    }
+    const auto& t_inference1 = std::chrono::steady_clock::now();
+
+    /*** PostProcess ***/
+    const auto& t_post_process0 = std::chrono::steady_clock::now();
+    /* Get boundig box of each tile, and convert to the coordinate of the original image */
+    const float* hm_list = output_tensor_info_list_[0].GetDataAsFloat();
+    const float* reg_xy_list = output_tensor_info_list_[1].GetDataAsFloat();
+    const float* reg_wh_list = output_tensor_info_list_[2].GetDataAsFloat();
+    const int32_t hm_h = output_tensor_info_list_[0].GetHeight() != -1 ? output_tensor_info_list_[0].GetHeight() : HM_HEIGHT;
+    const int32_t hm_w = output_tensor_info_list_[0].GetWidth() != -1 ? output_tensor_info_list_[0].GetWidth() : HM_WIDTH;
+    const int32_t hm_c = output_tensor_info_list_[0].GetChannel() > 1 ? output_tensor_info_list_[0].GetChannel() : HM_CHANNEL;
+    const float threshold_score_logit = CommonHelper::Logit(threshold_class_confidence_);
+    bbox_list_.clear();
+    tile_id_list_.clear();
+    for (int32_t i = 0; i < GetTileNum(); i++) {
+        const cv::Rect& tile = batch_blob_.GetCrop(i);
+        const size_t index_start = bbox_list_.size();
+        GetBoundingBox(hm_list + i * hm_c * hm_h * hm_w, reg_xy_list + i * 2 * hm_h * hm_w, reg_wh_list + i * 2 * hm_h * hm_w,
+            hm_c, hm_h, hm_w, threshold_score_logit, batch_blob_.GetScaleX(i), batch_blob_.GetScaleY(i), bbox_list_);
+        for (size_t index = index_start; index < bbox_list_.size(); index++) {
+            bbox_list_[index].x += tile.x;
+            bbox_list_[index].y += tile.y;
+            tile_id_list_.push_back(i);
+        }
+    }
+
+    /* NMS (merge boxes cut at tile borders) */
+    nms_.SetParam(threshold_nms_iou_, NMS_NUM_MAX_PRE_NMS, NMS_NUM_MAX_DETECTION, NMS_CHECK_CLASS_ID);
+    nms_.RunTiled(bbox_list_, tile_id_list_, threshold_tile_merge_ios_, result.bbox_list);
+
+    const auto& t_post_process1 = std::chrono::steady_clock::now();
+
+    /* Return the results */
+    result.crop.x = 0;
+    result.crop.y = 0;
+    result.crop.w = original_mat.cols;
+    result.crop.h = original_mat.rows;
+    result.time_pre_process = static_cast<std::chrono::duration<double>>(t_pre_process1 - t_pre_process0).count() * 1000.0;
+    result.time_inference = static_cast<std::chrono::duration<double>>(t_inference1 - t_inference0).count() * 1000.0;
+    result.time_post_process = static_cast<std::chrono::duration<double>>(t_post_process1 - t_post_process0).count() * 1000.0;;
+
+    return kRetOk;
+}
+
+
+int32_t DetectionEngine::ProcessBatch(const std::vector<cv::Mat>& original_mat_list, std::vector<Result>& result_list)
+{
+    result_list.resize(original_mat_list.size());
+    if (original_mat_list.empty()) return kRetOk;
+    return ProcessBatch(original_mat_list.data(), result_list.data(), static_cast<int32_t>(original_mat_list.size()));
+}
+
+int32_t DetectionEngine::ProcessBatch(const cv::Mat* original_mat_list, Result* result_list, int32_t num)
+{
+    if (!inference_helper_) {
+        PRINT_E("Inference helper is not created\n");
+        return kRetErr;
+    }
+    if (GetTileNum() > 1) {
+        /* Tiles of each image already fill the batch */
+        for (int32_t i = 0; i < num; i++) {
+            if (ProcessTiled(original_mat_list[i], result_list[i]) != kRetOk) return kRetErr;
+        }
+        return kRetOk;
+    }
+
+    InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
+    const int32_t batch_size = GetBatchSize();
+    for (int32_t batch_start = 0; batch_start < num; batch_start += batch_size) {
+        const int32_t batch_num = (std::min)(batch_size, num - batch_start);
+
+        /*** PreProcess ***/
+        /* Each image is written into its own area of the blob. (images, or rows of each image, are processed in parallel) */
+        const auto& t_pre_process0 = std::chrono::steady_clock::now();
+        if (batch_blob_.WriteImageList(original_mat_list + batch_start, batch_num) != BatchBlob::kRetOk) {
+            PRINT_E("Input image must be 3-channel uint8\n");
+            return kRetErr;
+        }
+        input_tensor_info.data = batch_blob_.GetData();
+        input_tensor_info.data_type = InputTensorInfo::kDataTypeBlobNchw;
+        if (inference_helper_->PreProcess(input_tensor_info_list_) != InferenceHelper::kRetOk) {
+            return kRetErr;
+        }
+        const auto& t_pre_process1 = std::chrono::steady_clock::now();
+
+        /*** Inference ***/
+        const auto& t_inference0 = std::chrono::steady_clock::now();
+        if (inference_helper_->Process(output_tensor_info_list_) != InferenceHelper::kRetOk) {
+            return kRetErr;
+        }
+        const auto& t_inference1 = std::chrono::steady_clock::now();
+
+        /*** PostProcess ***/
+        /* Decode each item of the batch with the crop area of the image. (the remaining items of the last batch are ignored) */
+        const float* hm_list = output_tensor_info_list_[0].GetDataAsFloat();
+        const float* reg_xy_list = output_tensor_info_list_[1].GetDataAsFloat();
+        const float* reg_wh_list = output_tensor_info_list_[2].GetDataAsFloat();
+        const int32_t hm_h = output_tensor_info_list_[0].GetHeight() != -1 ? output_tensor_info_list_[0].GetHeight() : HM_HEIGHT;
+        const int32_t hm_w = output_tensor_info_list_[0].GetWidth() != -1 ? output_tensor_info_list_[0].GetWidth() : HM_WIDTH;
+        const int32_t hm_c = output_tensor_info_list_[0].GetChannel() > 1 ? output_tensor_info_list_[0].GetChannel() : HM_CHANNEL;
+        const float threshold_score_logit = CommonHelper::Logit(threshold_class_confidence_);
+        for (int32_t i_batch = 0; i_batch < batch_num; i_batch++) {
+            const auto& t_post_process0 = std::chrono::steady_clock::now();
+            const cv::Rect& crop = batch_blob_.GetCrop(i_batch);
+            Result& result = result_list[batch_start + i_batch];
+            bbox_list_.clear();
+            GetBoundingBox(hm_list + i_batch * hm_c * hm_h * hm_w, reg_xy_list + i_batch * 2 * hm_h * hm_w, reg_wh_list + i_batch * 2 * hm_h * hm_w,
+                hm_c, hm_h, hm_w, threshold_score_logit, batch_blob_.GetScaleX(i_batch), batch_blob_.GetScaleY(i_batch), bbox_list_);
+            for (auto& bbox : bbox_list_) {
+                bbox.x += crop.x;
+                bbox.y += crop.y;
+            }
+            nms_.SetParam(threshold_nms_iou_, NMS_NUM_MAX_PRE_NMS, NMS_NUM_MAX_DETECTION, NMS_CHECK_CLASS_ID);
+            nms_.Run(bbox_list_, result.bbox_list);
+            const auto& t_post_process1 = std::chrono::steady_clock::now();
+
+            /* Return the results */
+            const cv::Rect& image_crop = batch_blob_.GetImageCrop(i_batch);
+            result.crop.x = image_crop.x;
+            result.crop.y = image_crop.y;
+            result.crop.w = image_crop.width;
+            result.crop.h = image_crop.height;
+            result.time_pre_process = static_cast<std::chrono::duration<double>>(t_pre_process1 - t_pre_process0).count() * 1000.0;
+            result.time_inference = static_cast<std::chrono::duration<double>>(t_inference1 - t_inference0).count() * 1000.0;
+            result.time_post_process = static_cast<std::chrono::duration<double>>(t_post_process1 - t_post_process0).count() * 1000.0;
+        }
+    }
+
+    return kRetOk;
+}
+
+
 int32_t DetectionEngine::ReadLabel(const std::string& filename, std::vector<std::string>& label_list)
 {
     std::ifstream ifs(filename);
@@ -248,3 +490,9 @@ int32_t DetectionEngine::ReadLabel(const std::string& filename, std::vector<std:
     return kRetOk;
 }
 
+const std::string& DetectionEngine::GetLabel(int32_t class_id) const
+{
+    static const std::string kUnknownLabel = "";
+    if (class_id < 0 || class_id >= static_cast<int32_t>(label_list_.size())) return kUnknownLabel;
+    return label_list_[class_id];
+}
@@ -29,6 +29,8 @@ limitations under the License.
 /* for My modules */
 #include "inference_helper.h"
 #include "bounding_box.h"
+#include "batched_nms.h"
+#include "batch_blob.h"
 
 
 class DetectionEngine {
@@ -58,27 +60,72 @@ public:
     DetectionEngine() {
         threshold_class_confidence_ = 0.4f;
         threshold_nms_iou_ = 0.5f;
+        tile_num_x_ = 1;
+        tile_num_y_ = 1;
+        tile_overlap_ratio_ = 0.2f;
+        threshold_tile_merge_ios_ = 0.6f;
+        batch_size_ = 1;
     }
     ~DetectionEngine() {}
     int32_t Initialize(const std::string& work_dir, const int32_t num_threads);
     int32_t Finalize(void);
     int32_t Process(const cv::Mat& original_mat, Result& result);
+    /* Process multiple images (e.g. from multiple cameras) with one inference for each batch_size images. The result of original_mat_list[i] is stored in result_list[i] */
+    /* time_pre_process and time_inference are the time of the batch which the image belongs to */
+    int32_t ProcessBatch(const std::vector<cv::Mat>& original_mat_list, std::vector<Result>& result_list);
     void SetThreshold(float threshold_box_confidence, float threshold_class_confidence, float threshold_nms_iou) {
         threshold_class_confidence_ = threshold_class_confidence;
         threshold_nms_iou_ = threshold_nms_iou;
     }
+    /* Tiled mode for high resolution image: the image is split into tile_num_x * tile_num_y overlapping tiles which are processed as one batch */
+    /* Call before Initialize because the batch size of the model is decided by the number of tiles (the model needs to accept the batch size) */
+    void SetTileParam(int32_t tile_num_x, int32_t tile_num_y, float overlap_ratio, float threshold_merge_ios = 0.6f) {
+        tile_num_x_ = tile_num_x;
+        tile_num_y_ = tile_num_y;
+        tile_overlap_ratio_ = overlap_ratio;
+        threshold_tile_merge_ios_ = threshold_merge_ios;
+    }
+    /* Call before Initialize. The model needs to accept the batch size (the larger of batch_size and the number of tiles is used) */
+    void SetBatchSize(int32_t batch_size) {
+        batch_size_ = batch_size;
+    }
+    const std::string& GetLabel(int32_t class_id) const;
+
+private:
+    typedef struct Peak_ {
+        float   score_logit;
+        int32_t class_id;
+        int32_t index;      /* hm_y * hm_w + hm_x */
+    } Peak;
 
 private:
     int32_t ReadLabel(const std::string& filename, std::vector<std::string>& label_list);
+    void GetPeakList(const float* hm_list, int32_t hm_c, int32_t hm_h, int32_t hm_w, float threshold_score_logit);
+    void GetBoundingBox(const float* hm_list, const float* reg_xy_list, const float* reg_wh_list, int32_t hm_c, int32_t hm_h, int32_t hm_w, float threshold_score_logit, float scale_w, float scale_h, std::vector<BoundingBox>& bbox_list);
+    int32_t ProcessTiled(const cv::Mat& original_mat, Result& result);
+    int32_t ProcessBatch(const cv::Mat* original_mat_list, Result* result_list, int32_t num);
+    int32_t GetTileNum() const { return tile_num_x_ * tile_num_y_; }
+    int32_t GetBatchSize() const { return (batch_size_ > GetTileNum()) ? batch_size_ : GetTileNum(); }
 
 private:
     std::unique_ptr<InferenceHelper> inference_helper_;
     std::vector<InputTensorInfo> input_tensor_info_list_;
     std::vector<OutputTensorInfo> output_tensor_info_list_;
     std::vector<std::string> label_list_;
+    BatchedNms nms_;
+    std::vector<std::vector<Peak>> peak_list_per_class_;    /* work buffer */
+    std::vector<Peak> peak_list_;                           /* top K peaks in the image (sorted by score) */
+    std::vector<BoundingBox> bbox_list_;                    /* work buffer to keep bbox before NMS */
+    std::vector<int32_t> tile_id_list_;                     /* work buffer for tiled mode (tile index of each bbox in bbox_list_) */
+    BatchBlob batch_blob_;                                  /* work buffer for pre-process (NCHW blob of all batches, and crop area of each item) */
 
     float threshold_class_confidence_;
     float threshold_nms_iou_;
+    int32_t tile_num_x_;
+    int32_t tile_num_y_;
+    float tile_overlap_ratio_;
+    float threshold_tile_merge_ios_;
+    int32_t batch_size_;
 };
 
 #endif
@@ -35,6 +35,7 @@ limitations under the License.
 #include "bounding_box.h"
 #include "detection_engine.h"
 #include "tracker.h"
+#include "detection_trace.h"
 #include "image_processor.h"
 
 /*** Macro ***/
@@ -42,9 +43,19 @@ limitations under the License.
 #define PRINT(...)   COMMON_HELPER_PRINT(TAG, __VA_ARGS__)
 #define PRINT_E(...) COMMON_HELPER_PRINT_E(TAG, __VA_ARGS__)
 
+/* Tiled mode for high resolution input (1 x 1 = no tiling). The model must accept batch size = TILE_NUM_X * TILE_NUM_Y */
+#define TILE_NUM_X          1
+#define TILE_NUM_Y          1
+#define TILE_OVERLAP_RATIO  0.2f
+
+/* Record detection results to replay tracker offline with trace_replay in common_helper/benchmark ("" = no recording) */
+#define DETECTION_TRACE_FILE    ""
+
 /*** Global variable ***/
 std::unique_ptr<DetectionEngine> s_engine;
+DetectionTraceWriter s_trace_writer;
 Tracker s_tracker;
+DetectionEngine::Result s_det_result;   /* keep it to reuse the buffer every frame */
 
 /*** Function ***/
 static void DrawFps(cv::Mat& mat, double time_inference, cv::Point pos, double font_scale, int32_t thickness, cv::Scalar color_front, cv::Scalar color_back, bool is_text_on_rect = true)
@@ -79,11 +90,15 @@ int32_t ImageProcessor::Initialize(const ImageProcessor::InputParam& input_param
     }
 
     s_engine.reset(new DetectionEngine());
+    s_engine->SetTileParam(TILE_NUM_X, TILE_NUM_Y, TILE_OVERLAP_RATIO);
     if (s_engine->Initialize(input_param.work_dir, input_param.num_threads) != DetectionEngine::kRetOk) {
         s_engine->Finalize();
         s_engine.reset();
         return -1;
     }
+    if (DETECTION_TRACE_FILE[0] != '\0') {
+        s_trace_writer.Open(DETECTION_TRACE_FILE);
+    }
     return 0;
 }
 
@@ -94,6 +109,7 @@ int32_t ImageProcessor::Finalize(void)
         return -1;
     }
 
+    s_trace_writer.Close();
     if (s_engine->Finalize() != DetectionEngine::kRetOk) {
         return -1;
     }
@@ -126,10 +142,15 @@ int32_t ImageProcessor::Process(cv::Mat& mat, ImageProcessor::Result& result)
         return -1;
     }
 
-    DetectionEngine::Result det_result;
+    /* Engine and tracker reuse work buffers not to allocate heap memory every frame. (checked by alloc_check in common_helper/benchmark) */
+    DetectionEngine::Result& det_result = s_det_result;
     if (s_engine->Process(mat, det_result) != DetectionEngine::kRetOk) {
         return -1;
     }
+    if (s_trace_writer.IsOpened()) {
+        s_trace_writer.Write(-1, det_result.crop.x, det_result.crop.y, det_result.crop.w, det_result.crop.h, det_result.bbox_list);
+    }
+    s_tracker.Update(det_result.bbox_list);
 
     /* Display target area  */
     cv::rectangle(mat, cv::Rect(det_result.crop.x, det_result.crop.y, det_result.crop.w, det_result.crop.h), CommonHelper::CreateCvColor(0, 0, 0), 2);
@@ -142,18 +163,17 @@ int32_t ImageProcessor::Process(cv::Mat& mat, ImageProcessor::Result& result)
     }
 
     /* Display tracking result  */
-    s_tracker.Update(det_result.bbox_list);
     int32_t num_track = 0;
-    auto& track_list = s_tracker.GetTrackList();
-    for (auto& track : track_list) {
+    const auto& track_pool = s_tracker.GetTrackPool();
+    for (const auto& track : track_pool) {
         if (track.GetDetectedCount() < 2) continue;
         const auto& bbox = track.GetLatestData().bbox;
         /* Use white rectangle for the object which was not detected but just predicted */
         cv::Scalar color = bbox.score == 0 ? CommonHelper::CreateCvColor(255, 255, 255) : GetColorForId(track.GetId());
         cv::rectangle(mat, cv::Rect(bbox.x, bbox.y, bbox.w, bbox.h), color, 2);
-        CommonHelper::DrawText(mat, std::to_string(track.GetId()) + ": " + bbox.label, cv::Point(bbox.x, bbox.y - 15), 0.35, 1, CommonHelper::CreateCvColor(0, 0, 0), CommonHelper::CreateCvColor(220, 220, 220));
+        CommonHelper::DrawText(mat, std::to_string(track.GetId()) + ": " + s_engine->GetLabel(bbox.class_id), cv::Point(bbox.x, bbox.y - 15), 0.35, 1, CommonHelper::CreateCvColor(0, 0, 0), CommonHelper::CreateCvColor(220, 220, 220));
 
-        auto& track_history = track.GetDataHistory();
+        const auto& track_history = track.GetDataHistory();
         for (size_t i = 1; i < track_history.size(); i++) {
             cv::Point p0(track_history[i].bbox.x + track_history[i].bbox.w / 2, track_history[i].bbox.y + track_history[i].bbox.h);
             cv::Point p1(track_history[i - 1].bbox.x + track_history[i - 1].bbox.w / 2, track_history[i - 1].bbox.y + track_history[i - 1].bbox.h);
@@ -167,10 +187,10 @@ int32_t ImageProcessor::Process(cv::Mat& mat, ImageProcessor::Result& result)
 
     /* Return the results */
     int32_t bbox_num = 0;
-    for (auto& track : track_list) {
+    for (const auto& track : track_pool) {
         const auto& bbox = track.GetLatestData().bbox;
         result.object_list[bbox_num].class_id = bbox.class_id;
-        snprintf(result.object_list[bbox_num].label, sizeof(result.object_list[bbox_num].label), "%s", bbox.label.c_str());
+        snprintf(result.object_list[bbox_num].label, sizeof(result.object_list[bbox_num].label), "%s", s_engine->GetLabel(bbox.class_id).c_str());
         result.object_list[bbox_num].score = bbox.score;
         result.object_list[bbox_num].x = bbox.x;
         result.object_list[bbox_num].y = bbox.y;
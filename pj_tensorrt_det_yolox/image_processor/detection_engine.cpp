@@ -25,12 +25,25 @@ limitations under the License.
 #include <chrono>
 #include <fstream>
 
+/* for SIMD */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define DECODER_USE_AVX2
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#define DECODER_USE_SSE4
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DECODER_USE_NEON
+#endif
+
 /* for OpenCV */
 #include <opencv2/opencv.hpp>
 
 /* for My modules */
 #include "common_helper.h"
 #include "common_helper_cv.h"
+#include "host_tensor.h"
 #include "inference_helper.h"
 #include "inference_helper_tensorrt.h"      // to call SetDlaCore
 #include "detection_engine.h"
@@ -43,6 +56,14 @@ limitations under the License.
 /* Model parameters */
 #define MODEL_NAME  "yolox_nano_480x640.onnx"
 #define TENSORTYPE  TensorInfo::kTensorTypeFp32
+#define HOST_TENSOR_TYPE  CommonHelper::kHostTensorTypeFp32
+//#define TENSORTYPE  TensorInfo::kTensorTypeFp16       /* the inference helper needs to support fp16 tensor */
+//#define HOST_TENSOR_TYPE  CommonHelper::kHostTensorTypeFp16
+//#define TENSORTYPE  TensorInfo::kTensorTypeUint8
+//#define HOST_TENSOR_TYPE  CommonHelper::kHostTensorTypeUint8
+/* Quantization of uint8 input: value = (q - zero_point) * scale. It is not in the model file, so set the values used to quantize the model */
+#define INPUT_QUANT_SCALE       0.0f                /* 0 = not set (Initialize fails for uint8 input) */
+#define INPUT_QUANT_ZERO_POINT  0
 #define INPUT_NAME  "images"
 #define INPUT_DIMS  { 1, 3, 480, 640 }
 #define IS_NCHW     true
@@ -53,28 +74,49 @@ static constexpr int32_t kGridScaleList[] = { 8, 16, 32 };
 static constexpr int32_t kGridChannel = 1;
 static constexpr int32_t kNumberOfClass = 80;
 static constexpr int32_t kElementNumOfAnchor = kNumberOfClass + 5;    // x, y, w, h, bbox confidence, [class confidence]
+static constexpr float kMeanList[3] = { 0.485f, 0.456f, 0.406f };
+static constexpr float kNormList[3] = { 0.229f, 0.224f, 0.225f };
 
 #define LABEL_NAME   "label_coco_80.txt"
 
+/* NMS parameters */
+#define NMS_NUM_MAX_PRE_NMS     1000    /* use only the top N boxes as input of NMS */
+#define NMS_NUM_MAX_DETECTION   100     /* stop NMS when N boxes are kept */
+#define NMS_CHECK_CLASS_ID      false   /* true: suppress boxes only in the same class */
+
 
 /*** Function ***/
+/* Output tensor as it is on host memory. fp16 / uint8 tensor is not converted to float as a whole (GetDataAsFloat does) */
+static CommonHelper::HostTensorView GetOutputView(const OutputTensorInfo& output_tensor_info)
+{
+    return CommonHelper::HostTensorView(output_tensor_info.data, HOST_TENSOR_TYPE, output_tensor_info.quant.scale, output_tensor_info.quant.zero_point);
+}
+
 int32_t DetectionEngine::Initialize(const std::string& work_dir, const int32_t num_threads)
 {
     /* Set model information */
     std::string model_filename = work_dir + "/model/" + MODEL_NAME;
     std::string labelFilename = work_dir + "/model/" + LABEL_NAME;
 
+    if (HOST_TENSOR_TYPE == CommonHelper::kHostTensorTypeUint8 && !(INPUT_QUANT_SCALE > 0.0f)) {
+        PRINT_E("Quantization of uint8 input is not set. Set INPUT_QUANT_SCALE and INPUT_QUANT_ZERO_POINT for the model\n");
+        return kRetErr;
+    }
+
     /* Set input tensor info */
     input_tensor_info_list_.clear();
     InputTensorInfo input_tensor_info(INPUT_NAME, TENSORTYPE, IS_NCHW);
     input_tensor_info.tensor_dims = INPUT_DIMS;
-    input_tensor_info.data_type = InputTensorInfo::kDataTypeImage;
-    input_tensor_info.normalize.mean[0] = 0.485f;
-    input_tensor_info.normalize.mean[1] = 0.456f;
-    input_tensor_info.normalize.mean[2] = 0.406f;
-    input_tensor_info.normalize.norm[0] = 0.229f;
-    input_tensor_info.normalize.norm[1] = 0.224f;
-    input_tensor_info.normalize.norm[2] = 0.225f;
+    /* Crop, resize, color conversion and normalization are done in one pass into NCHW blob in this class */
+    input_tensor_info.data_type = InputTensorInfo::kDataTypeBlobNchw;
+    for (int32_t i = 0; i < 3; i++) {
+        input_tensor_info.normalize.mean[i] = kMeanList[i];
+        input_tensor_info.normalize.norm[i] = kNormList[i];
+    }
+    if (GetBatchSize() > 1) {
+        /* Tiled mode / Batch mode: tiles (images) are converted to NCHW blob in this class and inferred as one batch */
+        input_tensor_info.tensor_dims[0] = GetBatchSize();
+    }
     input_tensor_info_list_.push_back(input_tensor_info);
 
     /* Set output tensor info */
@@ -82,6 +124,7 @@ int32_t DetectionEngine::Initialize(const std::string& work_dir, const int32_t n
     output_tensor_info_list_.push_back(OutputTensorInfo(OUTPUT_NAME, TENSORTYPE));
 
     /* Create and Initialize Inference Helper */
+    /* kOpencv runs on CPU without GPU. Tiled / batch mode works with it too because the input is NCHW blob created in this class */
     // inference_helper_.reset(InferenceHelper::Create(InferenceHelper::kOpencv));
     inference_helper_.reset(InferenceHelper::Create(InferenceHelper::kTensorrt));
 
@@ -99,11 +142,28 @@ int32_t DetectionEngine::Initialize(const std::string& work_dir, const int32_t n
         return kRetErr;
     }
 
+    /* Allocate work buffer for pre-process in advance */
+    batch_blob_.Create(GetBatchSize(), input_tensor_info_list_[0].GetWidth(), input_tensor_info_list_[0].GetHeight(), HOST_TENSOR_TYPE, kMeanList, kNormList, IS_RGB);
+    batch_blob_.SetQuantization(INPUT_QUANT_SCALE, INPUT_QUANT_ZERO_POINT);
+    region_blob_.resize(batch_blob_.GetBatchSize() * batch_blob_.GetItemSize());
+    region_plan_list_.resize(GetBatchSize());   /* resized in ProcessRegion for the number of cells */
+    for (auto& resize_plan : region_plan_list_) resize_plan.SetQuantization(INPUT_QUANT_SCALE, INPUT_QUANT_ZERO_POINT);
+
     /* read label */
     if (ReadLabel(labelFilename, label_list_) != kRetOk) {
         return kRetErr;
     }
 
+    /* Create table of grid offset and stride for each anchor to decode output tensor */
+    CreateGridTable(input_tensor_info_list_[0].GetWidth(), input_tensor_info_list_[0].GetHeight());
+
+    /* Allocate work buffer for NMS in advance. (NMS sorts all candidates before the top N cut, so the input can be all anchors of all batch items) */
+    nms_.Reserve(static_cast<int32_t>(grid_table_.size()) * GetBatchSize());
+    bbox_list_.reserve(grid_table_.size() * GetBatchSize());
+    bbox_cell_list_.reserve(grid_table_.size());
+    tile_list_.reserve(GetTileNum());
+    tile_id_list_.reserve(grid_table_.size() * GetBatchSize());
+
     return kRetOk;
 }
 
@@ -118,38 +178,169 @@ int32_t DetectionEngine::Finalize()
 }
 
 
-void DetectionEngine::GetBoundingBox(const float* data, float scale_x, float  scale_y, int32_t grid_w, int32_t grid_h, std::vector<BoundingBox>& bbox_list)
+void DetectionEngine::CreateGridTable(int32_t input_width, int32_t input_height)
 {
-    int32_t index = 0;
-    for (int32_t grid_y = 0; grid_y < grid_h; grid_y++) {
-        for (int32_t grid_x = 0; grid_x < grid_w; grid_x++) {
-            for (int32_t grid_c = 0; grid_c < kGridChannel; grid_c++) {
-                float box_confidence = data[index + 4];
-                if (box_confidence >= threshold_box_confidence_) {
-                    int32_t class_id = 0;
-                    float confidence = 0;
-                    for (int32_t class_index = 0; class_index < kNumberOfClass; class_index++) {
-                        float confidence_of_class = data[index + 5 + class_index];
-                        if (confidence_of_class > confidence) {
-                            confidence = confidence_of_class;
-                            class_id = class_index;
-                        }
-                    }
-
-                    if (confidence >= threshold_class_confidence_) {
-                        int32_t cx = static_cast<int32_t>((data[index + 0] + grid_x) * scale_x);
-                        int32_t cy = static_cast<int32_t>((data[index + 1] + grid_y) * scale_y);
-                        int32_t w = static_cast<int32_t>(std::exp(data[index + 2]) * scale_x);
-                        int32_t h = static_cast<int32_t>(std::exp(data[index + 3]) * scale_y);
-                        int32_t x = cx - w / 2;
-                        int32_t y = cy - h / 2;
-                        bbox_list.push_back(BoundingBox(class_id, "", confidence, x, y, w, h));
-                    }
+    grid_table_.clear();
+    for (const auto& grid_scale : kGridScaleList) {
+        const int32_t grid_w = input_width / grid_scale;
+        const int32_t grid_h = input_height / grid_scale;
+        for (int32_t grid_y = 0; grid_y < grid_h; grid_y++) {
+            for (int32_t grid_x = 0; grid_x < grid_w; grid_x++) {
+                for (int32_t grid_c = 0; grid_c < kGridChannel; grid_c++) {
+                    GridInfo grid_info;
+                    grid_info.grid_x = static_cast<float>(grid_x);
+                    grid_info.grid_y = static_cast<float>(grid_y);
+                    grid_info.stride = static_cast<float>(grid_scale);
+                    grid_table_.push_back(grid_info);
                 }
-                index += kElementNumOfAnchor;
             }
         }
     }
+    anchor_index_list_.resize(grid_table_.size());
+}
+
+
+/* Pass 1: collect indices of anchors whose box confidence is over the threshold */
+static int32_t GatherAnchorOverThreshold(const float* data, int32_t anchor_num, float threshold, int32_t* index_list)
+{
+    const float* conf = data + 4;
+    int32_t num = 0;
+    int32_t i = 0;
+#if defined(DECODER_USE_AVX2)
+    const __m256i offset = _mm256_setr_epi32(0, kElementNumOfAnchor * 1, kElementNumOfAnchor * 2, kElementNumOfAnchor * 3,
+        kElementNumOfAnchor * 4, kElementNumOfAnchor * 5, kElementNumOfAnchor * 6, kElementNumOfAnchor * 7);
+    const __m256 th = _mm256_set1_ps(threshold);
+    for (; i + 8 <= anchor_num; i += 8) {
+        const __m256 v = _mm256_i32gather_ps(conf + i * kElementNumOfAnchor, offset, 4);
+        int32_t mask = _mm256_movemask_ps(_mm256_cmp_ps(v, th, _CMP_GE_OQ));
+        for (int32_t k = 0; mask != 0; k++, mask >>= 1) {
+            if (mask & 1) index_list[num++] = i + k;
+        }
+    }
+#elif defined(DECODER_USE_SSE4)
+    const __m128 th = _mm_set1_ps(threshold);
+    for (; i + 4 <= anchor_num; i += 4) {
+        const float* p = conf + i * kElementNumOfAnchor;
+        const __m128 v = _mm_setr_ps(p[0], p[kElementNumOfAnchor], p[kElementNumOfAnchor * 2], p[kElementNumOfAnchor * 3]);
+        int32_t mask = _mm_movemask_ps(_mm_cmpge_ps(v, th));
+        for (int32_t k = 0; mask != 0; k++, mask >>= 1) {
+            if (mask & 1) index_list[num++] = i + k;
+        }
+    }
+#elif defined(DECODER_USE_NEON)
+    const float32x4_t th = vdupq_n_f32(threshold);
+    for (; i + 4 <= anchor_num; i += 4) {
+        const float* p = conf + i * kElementNumOfAnchor;
+        float32x4_t v = vdupq_n_f32(p[0]);
+        v = vsetq_lane_f32(p[kElementNumOfAnchor], v, 1);
+        v = vsetq_lane_f32(p[kElementNumOfAnchor * 2], v, 2);
+        v = vsetq_lane_f32(p[kElementNumOfAnchor * 3], v, 3);
+        const uint32x4_t ge = vcgeq_f32(v, th);
+        const uint32x2_t ge_any = vorr_u32(vget_low_u32(ge), vget_high_u32(ge));
+        if ((vget_lane_u32(ge_any, 0) | vget_lane_u32(ge_any, 1)) == 0) continue;
+        if (vgetq_lane_u32(ge, 0)) index_list[num++] = i + 0;
+        if (vgetq_lane_u32(ge, 1)) index_list[num++] = i + 1;
+        if (vgetq_lane_u32(ge, 2)) index_list[num++] = i + 2;
+        if (vgetq_lane_u32(ge, 3)) index_list[num++] = i + 3;
+    }
+#endif
+    for (; i < anchor_num; i++) {
+        if (conf[i * kElementNumOfAnchor] >= threshold) index_list[num++] = i;
+    }
+    return num;
+}
+
+/* Pass 2: find the class which has the max confidence (the first one is used if some classes have the same value) */
+static int32_t ArgMaxClass(const float* class_confidence, float& confidence)
+{
+    float max_value;
+    int32_t c = 0;
+#if defined(DECODER_USE_AVX2)
+    if (kNumberOfClass >= 8) {
+        __m256 vmax = _mm256_loadu_ps(class_confidence);
+        for (c = 8; c + 8 <= kNumberOfClass; c += 8) {
+            vmax = _mm256_max_ps(vmax, _mm256_loadu_ps(class_confidence + c));
+        }
+        __m128 m = _mm_max_ps(_mm256_castps256_ps128(vmax), _mm256_extractf128_ps(vmax, 1));
+        m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+        m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+        max_value = _mm_cvtss_f32(m);
+    } else {
+        max_value = class_confidence[0];
+    }
+#elif defined(DECODER_USE_SSE4)
+    if (kNumberOfClass >= 4) {
+        __m128 m = _mm_loadu_ps(class_confidence);
+        for (c = 4; c + 4 <= kNumberOfClass; c += 4) {
+            m = _mm_max_ps(m, _mm_loadu_ps(class_confidence + c));
+        }
+        m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+        m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+        max_value = _mm_cvtss_f32(m);
+    } else {
+        max_value = class_confidence[0];
+    }
+#elif defined(DECODER_USE_NEON)
+    if (kNumberOfClass >= 4) {
+        float32x4_t m = vld1q_f32(class_confidence);
+        for (c = 4; c + 4 <= kNumberOfClass; c += 4) {
+            m = vmaxq_f32(m, vld1q_f32(class_confidence + c));
+        }
+        float32x2_t m2 = vpmax_f32(vget_low_f32(m), vget_high_f32(m));
+        m2 = vpmax_f32(m2, m2);
+        max_value = vget_lane_f32(m2, 0);
+    } else {
+        max_value = class_confidence[0];
+    }
+#else
+    max_value = class_confidence[0];
+#endif
+    for (; c < kNumberOfClass; c++) {
+        max_value = (std::max)(max_value, class_confidence[c]);
+    }
+
+    /* Keep the same behavior as the original scalar loop: confidence starts from 0 and class 0 is used when no class exceeds it */
+    if (max_value <= 0) {
+        confidence = 0;
+        return 0;
+    }
+    confidence = max_value;
+    for (c = 0; c < kNumberOfClass; c++) {
+        if (class_confidence[c] == max_value) break;
+    }
+    return c;
+}
+
+void DetectionEngine::GetBoundingBox(const CommonHelper::HostTensorView& data, float scale_x, float  scale_y, std::vector<BoundingBox>& bbox_list)
+{
+    const int32_t anchor_num = static_cast<int32_t>(grid_table_.size());
+    int32_t candidate_num = 0;
+    if (data.IsFloat()) {
+        candidate_num = GatherAnchorOverThreshold(static_cast<const float*>(data.GetData()), anchor_num, threshold_box_confidence_, anchor_index_list_.data());
+    } else {
+        /* fp16 / uint8: only the box confidence is converted for all anchors */
+        for (int32_t i = 0; i < anchor_num; i++) {
+            if (data.Get(i * kElementNumOfAnchor + 4) >= threshold_box_confidence_) anchor_index_list_[candidate_num++] = i;
+        }
+    }
+
+    float anchor_work[kElementNumOfAnchor];     /* converted values of a candidate (not used for fp32) */
+    for (int32_t i = 0; i < candidate_num; i++) {
+        const int32_t anchor_index = anchor_index_list_[i];
+        const float* anchor = data.Read(anchor_index * kElementNumOfAnchor, kElementNumOfAnchor, anchor_work);
+        float confidence = 0;
+        const int32_t class_id = ArgMaxClass(anchor + 5, confidence);
+        if (confidence >= threshold_class_confidence_) {
+            const GridInfo& grid_info = grid_table_[anchor_index];
+            int32_t cx = static_cast<int32_t>((anchor[0] + grid_info.grid_x) * grid_info.stride * scale_x);
+            int32_t cy = static_cast<int32_t>((anchor[1] + grid_info.grid_y) * grid_info.stride * scale_y);
+            int32_t w = static_cast<int32_t>(std::exp(anchor[2]) * grid_info.stride * scale_x);
+            int32_t h = static_cast<int32_t>(std::exp(anchor[3]) * grid_info.stride * scale_y);
+            int32_t x = cx - w / 2;
+            int32_t y = cy - h / 2;
+            bbox_list.push_back(BoundingBox(class_id, confidence, x, y, w, h));
+        }
+    }
 }
 
 
@@ -159,30 +350,25 @@ int32_t DetectionEngine::Process(const cv::Mat& original_mat, Result& result)
         PRINT_E("Inference helper is not created\n");
         return kRetErr;
     }
+    if (GetTileNum() > 1) {
+        return ProcessTiled(original_mat, result);
+    }
+    if (GetBatchSize() > 1) {
+        /* The model input is a batch of blob */
+        return ProcessBatch(&original_mat, &result, 1);
+    }
+
     /*** PreProcess ***/
     const auto& t_pre_process0 = std::chrono::steady_clock::now();
     InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
-    /* do crop, resize and color conversion here because some inference engine doesn't support these operations */
-    int32_t crop_x = 0;
-    int32_t crop_y = 0;
-    int32_t crop_w = original_mat.cols;
-    int32_t crop_h = original_mat.rows;
-    cv::Mat img_src = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
-    //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeStretch);
-    //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeCut);
-    CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeExpand);
-
-    input_tensor_info.data = img_src.data;
-    input_tensor_info.data_type = InputTensorInfo::kDataTypeImage;
-    input_tensor_info.image_info.width = img_src.cols;
-    input_tensor_info.image_info.height = img_src.rows;
-    input_tensor_info.image_info.channel = img_src.channels();
-    input_tensor_info.image_info.crop_x = 0;
-    input_tensor_info.image_info.crop_y = 0;
-    input_tensor_info.image_info.crop_width = img_src.cols;
-    input_tensor_info.image_info.crop_height = img_src.rows;
-    input_tensor_info.image_info.is_bgr = false;
-    input_tensor_info.image_info.swap_color = false;
+    /* do crop, resize, color conversion and normalization here because some inference engine doesn't support these operations */
+    /* The original image is read only once and written into the blob directly. The tables are re-calculated only when the image size changes */
+    if (batch_blob_.Write(0, original_mat, cv::Rect(0, 0, original_mat.cols, original_mat.rows)) != BatchBlob::kRetOk) {
+        PRINT_E("Input image must be 3-channel uint8\n");
+        return kRetErr;
+    }
+
+    input_tensor_info.data = batch_blob_.GetData();
     if (inference_helper_->PreProcess(input_tensor_info_list_) != InferenceHelper::kRetOk) {
         return kRetErr;
     }
@@ -198,37 +384,32 @@ int32_t DetectionEngine::Process(const cv::Mat& original_mat, Result& result)
     /*** PostProcess ***/
     const auto& t_post_process0 = std::chrono::steady_clock::now();
     /* Get boundig box */
-    std::vector<BoundingBox> bbox_list;
-    float* output_data = output_tensor_info_list_[0].GetDataAsFloat();
-    for (const auto& grid_scale : kGridScaleList) {
-        int32_t grid_w = input_tensor_info.GetWidth() / grid_scale;
-        int32_t grid_h = input_tensor_info.GetHeight() / grid_scale;
-        float scale_x = static_cast<float>(grid_scale) * crop_w / input_tensor_info.GetWidth();      /* scale to original image */
-        float scale_y = static_cast<float>(grid_scale) * crop_h / input_tensor_info.GetHeight();
-        GetBoundingBox(output_data, scale_x, scale_y, grid_w, grid_h, bbox_list);
-        output_data += grid_w * grid_h * kGridChannel * kElementNumOfAnchor;
-    }
-
+    std::vector<BoundingBox>& bbox_list = bbox_list_;   /* reserved in Initialize */
+    bbox_list.clear();
+    const CommonHelper::HostTensorView output_data = GetOutputView(output_tensor_info_list_[0]);
+    GetBoundingBox(output_data, batch_blob_.GetScaleX(0), batch_blob_.GetScaleY(0), bbox_list);   /* scale to original image */
 
     /* Adjust bounding box */
+    const cv::Rect& crop = batch_blob_.GetCrop(0);
     for (auto& bbox : bbox_list) {
-        bbox.x += crop_x;  
-        bbox.y += crop_y;
-        bbox.label = label_list_[bbox.class_id];
+        bbox.x += crop.x;
+        bbox.y += crop.y;
     }
 
     /* NMS */
-    std::vector<BoundingBox> bbox_nms_list;
-    BoundingBoxUtils::Nms(bbox_list, bbox_nms_list, threshold_nms_iou_);
+    /* Output to result directly to reuse the buffer of the previous frame if the caller keeps result */
+    std::vector<BoundingBox>& bbox_nms_list = result.bbox_list;
+    nms_.SetParam(threshold_nms_iou_, NMS_NUM_MAX_PRE_NMS, NMS_NUM_MAX_DETECTION, NMS_CHECK_CLASS_ID);
+    nms_.Run(bbox_list, bbox_nms_list);
 
     const auto& t_post_process1 = std::chrono::steady_clock::now();
 
     /* Return the results */
-    result.bbox_list = bbox_nms_list;
-    result.crop.x = (std::max)(0, crop_x);
-    result.crop.y = (std::max)(0, crop_y);
-    result.crop.w = (std::min)(crop_w, original_mat.cols - result.crop.x);
-    result.crop.h = (std::min)(crop_h, original_mat.rows - result.crop.y);
+    const cv::Rect& image_crop = batch_blob_.GetImageCrop(0);
+    result.crop.x = image_crop.x;
+    result.crop.y = image_crop.y;
+    result.crop.w = image_crop.width;
+    result.crop.h = image_crop.height;
     result.time_pre_process = static_cast<std::chrono::duration<double>>(t_pre_process1 - t_pre_process0).count() * 1000.0;
     result.time_inference = static_cast<std::chrono::duration<double>>(t_inference1 - t_inference0).count() * 1000.0;
     result.time_post_process = static_cast<std::chrono::duration<double>>(t_post_process1 - t_post_process0).count() * 1000.0;;
@@ -237,6 +418,218 @@ int32_t DetectionEngine::Process(const cv::Mat& original_mat, Result& result)
 }
 
 
+int32_t DetectionEngine::ProcessTiled(const cv::Mat& original_mat, Result& result)
+{
+    CommonHelper::CreateTileList(original_mat.cols, original_mat.rows, tile_num_x_, tile_num_y_, tile_overlap_ratio_, tile_list_);
+    return ProcessRegion(original_mat, tile_list_, 1, 1, result);
+}
+
+int32_t DetectionEngine::ProcessRegion(const cv::Mat& original_mat, const std::vector<cv::Rect>& region_list, int32_t cell_num_x, int32_t cell_num_y, Result& result)
+{
+    if (!inference_helper_) {
+        PRINT_E("Inference helper is not created\n");
+        return kRetErr;
+    }
+    InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
+    const int32_t batch_size = GetBatchSize();
+    const int32_t cell_num = cell_num_x * cell_num_y;
+    const int32_t cell_w = input_tensor_info.GetWidth() / cell_num_x;
+    const int32_t cell_h = input_tensor_info.GetHeight() / cell_num_y;
+
+    /* Crop area in the original image for each cell. (updated by the plan to include padding) */
+    region_crop_list_.clear();
+    for (const auto& region : region_list) {
+        const cv::Rect crop = region & cv::Rect(0, 0, original_mat.cols, original_mat.rows);
+        if (crop.width > 0 && crop.height > 0) region_crop_list_.push_back(crop);
+    }
+    const int32_t region_num = static_cast<int32_t>(region_crop_list_.size());
+    if (static_cast<int32_t>(region_plan_list_.size()) < batch_size * cell_num) {
+        region_plan_list_.resize(batch_size * cell_num);
+        for (auto& plan : region_plan_list_) plan.SetQuantization(INPUT_QUANT_SCALE, INPUT_QUANT_ZERO_POINT);
+    }
+    if (cell_num_x != region_cell_num_x_ || cell_num_y != region_cell_num_y_) {
+        /* The cell of each plan is moved, so the padding written by the plans in region_blob_ is not valid */
+        for (auto& plan : region_plan_list_) plan.ResetPadding();
+        region_cell_num_x_ = cell_num_x;
+        region_cell_num_y_ = cell_num_y;
+    }
+
+    bbox_list_.clear();
+    tile_id_list_.clear();
+    result.time_pre_process = 0;
+    result.time_inference = 0;
+    result.time_post_process = 0;
+    for (int32_t region_start = 0; region_start < region_num; region_start += batch_size * cell_num) {
+        /*** PreProcess ***/
+        const auto& t_pre_process0 = std::chrono::steady_clock::now();
+        /* Each region is resized into its cell of the blob directly by the plan of the cell. Unused cells are filled with the value of black */
+        /* The blob is written only by the plans of cells (not shared with batch_blob_), so the padding is kept while the cell layout is the same */
+        for (int32_t i_batch = 0; i_batch < batch_size; i_batch++) {
+            for (int32_t i_cell = 0; i_cell < cell_num; i_cell++) {
+                const int32_t index = region_start + i_batch * cell_num + i_cell;
+                CommonHelper::ResizePlan& plan = region_plan_list_[i_batch * cell_num + i_cell];
+                plan.SetDstLayout(input_tensor_info.GetWidth(), input_tensor_info.GetWidth() * input_tensor_info.GetHeight());
+                const int32_t cell_offset = (i_cell / cell_num_x) * cell_h * input_tensor_info.GetWidth() + (i_cell % cell_num_x) * cell_w;
+                uint8_t* dst = region_blob_.data() + i_batch * batch_blob_.GetItemSize() + cell_offset * CommonHelper::GetHostTensorElementSize(HOST_TENSOR_TYPE);
+                if (index < region_num) {
+                    /* crop area is updated to include padding */
+                    cv::Rect& crop = region_crop_list_[index];
+                    if (!CommonHelper::CropResizeNormalizeNchw(original_mat, dst, HOST_TENSOR_TYPE, plan, cell_w, cell_h,
+                        crop.x, crop.y, crop.width, crop.height, kMeanList, kNormList, IS_RGB, CommonHelper::kCropTypeExpand)) {
+                        PRINT_E("Input image must be 3-channel uint8\n");
+                        return kRetErr;
+                    }
+                } else {
+                    if (!plan.IsSame(cell_w, cell_h, 0, 0, cell_w, cell_h, CommonHelper::kCropTypeStretch, kMeanList, kNormList, false)) {
+                        plan.Create(cell_w, cell_h, 0, 0, cell_w, cell_h, CommonHelper::kCropTypeStretch, kMeanList, kNormList, false);
+                    }
+                    plan.Fill(dst, HOST_TENSOR_TYPE);
+                }
+            }
+        }
+        input_tensor_info.data = region_blob_.data();
+        input_tensor_info.data_type = InputTensorInfo::kDataTypeBlobNchw;
+        if (inference_helper_->PreProcess(input_tensor_info_list_) != InferenceHelper::kRetOk) {
+            return kRetErr;
+        }
+        const auto& t_pre_process1 = std::chrono::steady_clock::now();
+
+        /*** Inference ***/
+        const auto& t_inference0 = std::chrono::steady_clock::now();
+        if (inference_helper_->Process(output_tensor_info_list_) != InferenceHelper::kRetOk) {
+            return kRetErr;
+        }
+        const auto& t_inference1 = std::chrono::steady_clock::now();
+
+        /*** PostProcess ***/
+        /* Get boundig box in the model input, and convert to the coordinate of the original image via the cell which contains the center of bbox */
+        const auto& t_post_process0 = std::chrono::steady_clock::now();
+        const CommonHelper::HostTensorView output_data = GetOutputView(output_tensor_info_list_[0]);
+        for (int32_t i_batch = 0; i_batch < batch_size; i_batch++) {
+            bbox_cell_list_.clear();
+            GetBoundingBox(output_data.Offset(i_batch * static_cast<int32_t>(grid_table_.size()) * kElementNumOfAnchor), 1.0f, 1.0f, bbox_cell_list_);
+            for (const auto& bbox_cell : bbox_cell_list_) {
+                const int32_t cell_x = (std::min)((std::max)(0, (bbox_cell.x + bbox_cell.w / 2) / cell_w), cell_num_x - 1);
+                const int32_t cell_y = (std::min)((std::max)(0, (bbox_cell.y + bbox_cell.h / 2) / cell_h), cell_num_y - 1);
+                const int32_t index = region_start + i_batch * cell_num + cell_y * cell_num_x + cell_x;
+                if (index >= region_num) continue;
+                const cv::Rect& crop = region_crop_list_[index];
+                const int32_t x0 = (std::max)(bbox_cell.x, cell_x * cell_w);
+                const int32_t y0 = (std::max)(bbox_cell.y, cell_y * cell_h);
+                const int32_t x1 = (std::min)(bbox_cell.x + bbox_cell.w, (cell_x + 1) * cell_w);
+                const int32_t y1 = (std::min)(bbox_cell.y + bbox_cell.h, (cell_y + 1) * cell_h);
+                BoundingBox bbox = bbox_cell;
+                bbox.x = crop.x + (x0 - cell_x * cell_w) * crop.width / cell_w;
+                bbox.y = crop.y + (y0 - cell_y * cell_h) * crop.height / cell_h;
+                bbox.w = (x1 - x0) * crop.width / cell_w;
+                bbox.h = (y1 - y0) * crop.height / cell_h;
+                bbox_list_.push_back(bbox);
+                tile_id_list_.push_back(index);
+            }
+        }
+        const auto& t_post_process1 = std::chrono::steady_clock::now();
+        result.time_pre_process += static_cast<std::chrono::duration<double>>(t_pre_process1 - t_pre_process0).count() * 1000.0;
+        result.time_inference += static_cast<std::chrono::duration<double>>(t_inference1 - t_inference0).count() * 1000.0;
+        result.time_post_process += static_cast<std::chrono::duration<double>>(t_post_process1 - t_post_process0).count() * 1000.0;
+    }
+
+    /* NMS (merge boxes cut at borders of regions) */
+    const auto& t_post_process0 = std::chrono::steady_clock::now();
+    nms_.SetParam(threshold_nms_iou_, NMS_NUM_MAX_PRE_NMS, NMS_NUM_MAX_DETECTION, NMS_CHECK_CLASS_ID);
+    nms_.RunTiled(bbox_list_, tile_id_list_, threshold_tile_merge_ios_, result.bbox_list);
+    const auto& t_post_process1 = std::chrono::steady_clock::now();
+
+    /* Return the results */
+    result.crop.x = 0;
+    result.crop.y = 0;
+    result.crop.w = original_mat.cols;
+    result.crop.h = original_mat.rows;
+    result.time_post_process += static_cast<std::chrono::duration<double>>(t_post_process1 - t_post_process0).count() * 1000.0;
+
+    return kRetOk;
+}
+
+
+int32_t DetectionEngine::ProcessBatch(const std::vector<cv::Mat>& original_mat_list, std::vector<Result>& result_list)
+{
+    result_list.resize(original_mat_list.size());
+    if (original_mat_list.empty()) return kRetOk;
+    return ProcessBatch(original_mat_list.data(), result_list.data(), static_cast<int32_t>(original_mat_list.size()));
+}
+
+int32_t DetectionEngine::ProcessBatch(const cv::Mat* original_mat_list, Result* result_list, int32_t num)
+{
+    if (!inference_helper_) {
+        PRINT_E("Inference helper is not created\n");
+        return kRetErr;
+    }
+    if (GetTileNum() > 1) {
+        /* Tiles of each image already fill the batch */
+        for (int32_t i = 0; i < num; i++) {
+            if (ProcessTiled(original_mat_list[i], result_list[i]) != kRetOk) return kRetErr;
+        }
+        return kRetOk;
+    }
+
+    InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
+    const int32_t batch_size = GetBatchSize();
+    for (int32_t batch_start = 0; batch_start < num; batch_start += batch_size) {
+        const int32_t batch_num = (std::min)(batch_size, num - batch_start);
+
+        /*** PreProcess ***/
+        /* Each image is written into its own area of the blob. (images, or rows of each image, are processed in parallel) */
+        const auto& t_pre_process0 = std::chrono::steady_clock::now();
+        if (batch_blob_.WriteImageList(original_mat_list + batch_start, batch_num) != BatchBlob::kRetOk) {
+            PRINT_E("Input image must be 3-channel uint8\n");
+            return kRetErr;
+        }
+        input_tensor_info.data = batch_blob_.GetData();
+        input_tensor_info.data_type = InputTensorInfo::kDataTypeBlobNchw;
+        if (inference_helper_->PreProcess(input_tensor_info_list_) != InferenceHelper::kRetOk) {
+            return kRetErr;
+        }
+        const auto& t_pre_process1 = std::chrono::steady_clock::now();
+
+        /*** Inference ***/
+        const auto& t_inference0 = std::chrono::steady_clock::now();
+        if (inference_helper_->Process(output_tensor_info_list_) != InferenceHelper::kRetOk) {
+            return kRetErr;
+        }
+        const auto& t_inference1 = std::chrono::steady_clock::now();
+
+        /*** PostProcess ***/
+        /* Decode each item of the batch with the crop area of the image. (the remaining items of the last batch are ignored) */
+        const CommonHelper::HostTensorView output_data = GetOutputView(output_tensor_info_list_[0]);
+        for (int32_t i_batch = 0; i_batch < batch_num; i_batch++) {
+            const auto& t_post_process0 = std::chrono::steady_clock::now();
+            const cv::Rect& crop = batch_blob_.GetCrop(i_batch);
+            Result& result = result_list[batch_start + i_batch];
+            bbox_list_.clear();
+            GetBoundingBox(output_data.Offset(i_batch * static_cast<int32_t>(grid_table_.size()) * kElementNumOfAnchor), batch_blob_.GetScaleX(i_batch), batch_blob_.GetScaleY(i_batch), bbox_list_);
+            for (auto& bbox : bbox_list_) {
+                bbox.x += crop.x;
+                bbox.y += crop.y;
+            }
+            nms_.SetParam(threshold_nms_iou_, NMS_NUM_MAX_PRE_NMS, NMS_NUM_MAX_DETECTION, NMS_CHECK_CLASS_ID);
+            nms_.Run(bbox_list_, result.bbox_list);
+            const auto& t_post_process1 = std::chrono::steady_clock::now();
+
+            /* Return the results */
+            const cv::Rect& image_crop = batch_blob_.GetImageCrop(i_batch);
+            result.crop.x = image_crop.x;
+            result.crop.y = image_crop.y;
+            result.crop.w = image_crop.width;
+            result.crop.h = image_crop.height;
+            result.time_pre_process = static_cast<std::chrono::duration<double>>(t_pre_process1 - t_pre_process0).count() * 1000.0;
+            result.time_inference = static_cast<std::chrono::duration<double>>(t_inference1 - t_inference0).count() * 1000.0;
+            result.time_post_process = static_cast<std::chrono::duration<double>>(t_post_process1 - t_post_process0).count() * 1000.0;
+        }
+    }
+
+    return kRetOk;
+}
+
+
 int32_t DetectionEngine::ReadLabel(const std::string& filename, std::vector<std::string>& label_list)
 {
     std::ifstream ifs(filename);
@@ -252,3 +645,9 @@ int32_t DetectionEngine::ReadLabel(const std::string& filename, std::vector<std:
     return kRetOk;
 }
 
+const std::string& DetectionEngine::GetLabel(int32_t class_id) const
+{
+    static const std::string kUnknownLabel = "";
+    if (class_id < 0 || class_id >= static_cast<int32_t>(label_list_.size())) return kUnknownLabel;
+    return label_list_[class_id];
+}
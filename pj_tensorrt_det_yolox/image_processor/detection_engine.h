@@ -29,6 +29,10 @@ limitations under the License.
 /* for My modules */
 #include "inference_helper.h"
 #include "bounding_box.h"
+#include "batched_nms.h"
+#include "image_preprocess.h"
+#include "batch_blob.h"
+#include "host_tensor.h"
 
 
 class DetectionEngine {
@@ -59,30 +63,87 @@ public:
         threshold_box_confidence_ = 0.4f;
         threshold_class_confidence_ = 0.2f;
         threshold_nms_iou_ = 0.5f;
+        tile_num_x_ = 1;
+        tile_num_y_ = 1;
+        tile_overlap_ratio_ = 0.2f;
+        threshold_tile_merge_ios_ = 0.6f;
+        batch_size_ = 1;
+        region_cell_num_x_ = 0;
+        region_cell_num_y_ = 0;
     }
     ~DetectionEngine() {}
     int32_t Initialize(const std::string& work_dir, const int32_t num_threads);
     int32_t Finalize(void);
     int32_t Process(const cv::Mat& original_mat, Result& result);
+    /* Process multiple images (e.g. from multiple cameras) with one inference for each batch_size images. The result of original_mat_list[i] is stored in result_list[i] */
+    /* time_pre_process and time_inference are the time of the batch which the image belongs to */
+    int32_t ProcessBatch(const std::vector<cv::Mat>& original_mat_list, std::vector<Result>& result_list);
+    /* Detect objects only in the regions (e.g. around tracked objects). To run them at once, regions are packed into a mosaic */
+    /* of cell_num_x * cell_num_y cells in each model input (each region is resized into a cell keeping aspect ratio) */
+    int32_t ProcessRegion(const cv::Mat& original_mat, const std::vector<cv::Rect>& region_list, int32_t cell_num_x, int32_t cell_num_y, Result& result);
     void SetThreshold(float threshold_box_confidence, float threshold_class_confidence, float threshold_nms_iou) {
         threshold_box_confidence_ = threshold_box_confidence;
         threshold_class_confidence_ = threshold_class_confidence;
         threshold_nms_iou_ = threshold_nms_iou;
     }
+    /* Tiled mode for high resolution image: the image is split into tile_num_x * tile_num_y overlapping tiles which are processed as one batch */
+    /* Call before Initialize because the batch size of the model is decided by the number of tiles (the model needs to accept the batch size) */
+    void SetTileParam(int32_t tile_num_x, int32_t tile_num_y, float overlap_ratio, float threshold_merge_ios = 0.6f) {
+        tile_num_x_ = tile_num_x;
+        tile_num_y_ = tile_num_y;
+        tile_overlap_ratio_ = overlap_ratio;
+        threshold_tile_merge_ios_ = threshold_merge_ios;
+    }
+    /* Call before Initialize. The model needs to accept the batch size (the larger of batch_size and the number of tiles is used) */
+    void SetBatchSize(int32_t batch_size) {
+        batch_size_ = batch_size;
+    }
+    const std::string& GetLabel(int32_t class_id) const;
+    /* Batch size of the model input. (ProcessRegion packs regions into GetBatchSize() * cell_num_x * cell_num_y cells in one inference) */
+    int32_t GetBatchSize() const { return (batch_size_ > GetTileNum()) ? batch_size_ : GetTileNum(); }
+
+private:
+    typedef struct GridInfo_ {
+        float grid_x;
+        float grid_y;
+        float stride;
+    } GridInfo;
 
 private:
     int32_t ReadLabel(const std::string& filename, std::vector<std::string>& label_list);
-    void GetBoundingBox(const float* data, float scale_x, float  scale_y, int32_t grid_w, int32_t grid_h, std::vector<BoundingBox>& bbox_list);
+    void CreateGridTable(int32_t input_width, int32_t input_height);
+    void GetBoundingBox(const CommonHelper::HostTensorView& data, float scale_x, float  scale_y, std::vector<BoundingBox>& bbox_list);
+    int32_t ProcessTiled(const cv::Mat& original_mat, Result& result);
+    int32_t ProcessBatch(const cv::Mat* original_mat_list, Result* result_list, int32_t num);
+    int32_t GetTileNum() const { return tile_num_x_ * tile_num_y_; }
 
 private:
     std::unique_ptr<InferenceHelper> inference_helper_;
     std::vector<InputTensorInfo> input_tensor_info_list_;
     std::vector<OutputTensorInfo> output_tensor_info_list_;
     std::vector<std::string> label_list_;
+    BatchedNms nms_;
+    std::vector<GridInfo> grid_table_;          /* grid offset and stride for each anchor */
+    std::vector<int32_t> anchor_index_list_;    /* work buffer to keep anchors whose box confidence is over the threshold */
+    std::vector<BoundingBox> bbox_list_;        /* work buffer to keep bbox before NMS */
+    std::vector<cv::Rect> tile_list_;           /* work buffer for tiled mode */
+    std::vector<cv::Rect> region_crop_list_;    /* work buffer for tiled / region mode (crop area of each region) */
+    std::vector<int32_t> tile_id_list_;         /* work buffer for tiled / region mode (region index of each bbox in bbox_list_) */
+    std::vector<BoundingBox> bbox_cell_list_;   /* work buffer for tiled / region mode (bbox in model input coordinate) */
+    BatchBlob batch_blob_;                      /* work buffer for pre-process (NCHW blob of all batches in HOST_TENSOR_TYPE, and crop area of each item) */
+    std::vector<uint8_t> region_blob_;          /* work buffer for tiled / region mode (NCHW blob of all batches. separated from batch_blob_ to keep the padding of each) */
+    std::vector<CommonHelper::ResizePlan> region_plan_list_;    /* pre-process plan for each cell of region_blob_ (tiled / region mode) */
+    int32_t region_cell_num_x_;                 /* cell layout of region_plan_list_ at the last ProcessRegion */
+    int32_t region_cell_num_y_;
 
     float threshold_box_confidence_;
     float threshold_class_confidence_;
     float threshold_nms_iou_;
+    int32_t tile_num_x_;
+    int32_t tile_num_y_;
+    float tile_overlap_ratio_;
+    float threshold_tile_merge_ios_;
+    int32_t batch_size_;
 };
 
 #endif
@@ -25,6 +25,7 @@ limitations under the License.
 #include <chrono>
 #include <fstream>
 #include <memory>
+#include <mutex>
 
 /* for OpenCV */
 #include <opencv2/opencv.hpp>
@@ -35,6 +36,8 @@ limitations under the License.
 #include "bounding_box.h"
 #include "detection_engine.h"
 #include "tracker.h"
+#include "tracker_manager.h"
+#include "detection_trace.h"
 #include "image_processor.h"
 
 /*** Macro ***/
@@ -42,9 +45,54 @@ limitations under the License.
 #define PRINT(...)   COMMON_HELPER_PRINT(TAG, __VA_ARGS__)
 #define PRINT_E(...) COMMON_HELPER_PRINT_E(TAG, __VA_ARGS__)
 
+/* Tiled mode for high resolution input (1 x 1 = no tiling). The model must accept batch size = TILE_NUM_X * TILE_NUM_Y */
+#define TILE_NUM_X          1
+#define TILE_NUM_Y          1
+#define TILE_OVERLAP_RATIO  0.2f
+
+/* Record detection results to replay tracker offline with trace_replay in common_helper/benchmark ("" = no recording) */
+#define DETECTION_TRACE_FILE    ""
+
+/* Tracker-guided ROI scheduling. Full frame detection runs every ROI_KEYFRAME_INTERVAL frames (1 = every frame) */
+/* In other frames, detection runs only around the predicted position of tracks and on a part of the rest of the image (scanned in turn) */
+/* Regions of tracks are merged to fit in the cells. Full frame detection is used only when a merged region gets larger than the area which one cell covers in full frame detection */
+#define ROI_KEYFRAME_INTERVAL   1
+#define ROI_MARGIN_RATIO        0.5f    /* expand the predicted bbox by this ratio of its size */
+#define ROI_CELL_NUM_X          2       /* regions are packed into ROI_CELL_NUM_X * ROI_CELL_NUM_Y cells of each model input */
+#define ROI_CELL_NUM_Y          2
+#define ROI_BATCH_SIZE          1       /* model inputs (batch items) of one inference. The model must accept the batch size */
+#define ROI_SCAN_CELL_NUM_MIN   1       /* cells kept for scan even when there are many tracks */
+#define ROI_SCAN_TILE_NUM_X     4       /* the image is divided into tiles for scan */
+#define ROI_SCAN_TILE_NUM_Y     4
+
+/* Trackers are managed per stream. This processor handles one stream */
+#define STREAM_ID               0
+
+/*** Type ***/
+/* Copy of a track to draw it without the lock of the tracker */
+typedef struct {
+    BoundingBox bbox;
+    int32_t id;
+    int32_t detected_count;
+    int32_t history_start;      /* index in the point list */
+    int32_t history_num;
+} TrackSnapshot;
+
 /*** Global variable ***/
 std::unique_ptr<DetectionEngine> s_engine;
-Tracker s_tracker;
+DetectionTraceWriter s_trace_writer;
+TrackerManager s_tracker_manager;
+std::mutex s_tracker_mutex;             /* Process and Render may be called from different threads. Held only to update / copy the tracks, not while drawing */
+std::vector<TrackSnapshot> s_track_snapshot_list;   /* work buffer for Process */
+std::vector<cv::Point> s_track_history_list;        /* work buffer for Process (history of each track in s_track_snapshot_list) */
+std::vector<BoundingBox> s_render_bbox_list;        /* work buffer for Render */
+std::vector<const Track*> s_render_track_list;      /* work buffer for Render */
+std::vector<TrackSnapshot> s_render_snapshot_list;  /* work buffer for Render */
+DetectionEngine::Result s_det_result;   /* keep it to reuse the buffer every frame */
+int32_t s_frame_count = 0;
+int32_t s_scan_index = 0;
+std::vector<cv::Rect> s_region_list;
+std::vector<cv::Rect> s_scan_tile_list;
 
 /*** Function ***/
 static void DrawFps(cv::Mat& mat, double time_inference, cv::Point pos, double font_scale, int32_t thickness, cv::Scalar color_front, cv::Scalar color_back, bool is_text_on_rect = true)
@@ -71,6 +119,91 @@ static cv::Scalar GetColorForId(int32_t id)
     return color_list[id % kMaxNum];
 }
 
+static bool IsCovered(const cv::Rect& rect, const std::vector<cv::Rect>& region_list)
+{
+    for (const auto& region : region_list) {
+        if ((rect & region) == rect) return true;
+    }
+    return false;
+}
+
+/* Merge regions until the number of regions is up to region_num_max. The pair whose union adds the least area is merged first */
+/* Overlapping regions are merged anyway if the union is not larger than the sum of them */
+/* Return false if the regions can't be merged into region_num_max regions within size_max_w x size_max_h */
+static bool MergeRegion(std::vector<cv::Rect>& region_list, int32_t region_num_max, int32_t size_max_w, int32_t size_max_h)
+{
+    while (region_list.size() > 1) {
+        const int32_t region_num = static_cast<int32_t>(region_list.size());
+        int32_t best_i = 0;
+        int32_t best_j = 1;
+        int64_t best_cost = INT64_MAX;
+        for (int32_t i = 0; i < region_num; i++) {
+            for (int32_t j = i + 1; j < region_num; j++) {
+                const int64_t cost = static_cast<int64_t>((region_list[i] | region_list[j]).area()) - region_list[i].area() - region_list[j].area();
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_i = i;
+                    best_j = j;
+                }
+            }
+        }
+        const bool is_over = region_num > region_num_max;
+        if (!is_over && best_cost > 0) break;
+        const cv::Rect merged = region_list[best_i] | region_list[best_j];
+        if (merged.width > size_max_w || merged.height > size_max_h) {
+            if (is_over) return false;
+            break;
+        }
+        region_list[best_i] = merged;
+        region_list[best_j] = region_list.back();
+        region_list.pop_back();
+    }
+    return static_cast<int32_t>(region_list.size()) <= region_num_max;
+}
+
+static int32_t RunDetection(const cv::Mat& mat, DetectionEngine::Result& det_result)
+{
+    s_region_list.clear();
+    const bool is_keyframe = (s_frame_count % ROI_KEYFRAME_INTERVAL == 0);
+    s_frame_count++;
+    if (is_keyframe) {
+        return s_engine->Process(mat, det_result);
+    }
+
+    /* Regions around the predicted position of tracks (clipped by the image) */
+    const int32_t cell_num = s_engine->GetBatchSize() * ROI_CELL_NUM_X * ROI_CELL_NUM_Y;
+    const cv::Rect image_rect(0, 0, mat.cols, mat.rows);
+    {
+        std::lock_guard<std::mutex> lock(s_tracker_mutex);     /* not to block Render during inference */
+        for (const auto& track : s_tracker_manager.GetOrCreateTracker(STREAM_ID).GetTrackPool()) {
+            const BoundingBox bbox = track.GetPredictedBoundingBox();
+            const int32_t margin_x = static_cast<int32_t>(bbox.w * ROI_MARGIN_RATIO);
+            const int32_t margin_y = static_cast<int32_t>(bbox.h * ROI_MARGIN_RATIO);
+            const cv::Rect region = cv::Rect(bbox.x - margin_x, bbox.y - margin_y, bbox.w + 2 * margin_x, bbox.h + 2 * margin_y) & image_rect;
+            if (region.area() > 0) s_region_list.push_back(region);
+        }
+    }
+    /* Nearby regions are merged to leave cells for scan. A cell of a region larger than this has lower resolution than full frame detection */
+    const int32_t size_max_w = mat.cols / ROI_CELL_NUM_X;
+    const int32_t size_max_h = mat.rows / ROI_CELL_NUM_Y;
+    if (!MergeRegion(s_region_list, (std::max)(1, cell_num - ROI_SCAN_CELL_NUM_MIN), size_max_w, size_max_h)) {
+        s_region_list.clear();
+        return s_engine->Process(mat, det_result);
+    }
+
+    /* Fill the rest cells with tiles not covered by the regions, in turn, to find new objects */
+    CommonHelper::CreateTileList(mat.cols, mat.rows, ROI_SCAN_TILE_NUM_X, ROI_SCAN_TILE_NUM_Y, 0.1f, s_scan_tile_list);
+    for (int32_t i = 0; i < static_cast<int32_t>(s_scan_tile_list.size()) && static_cast<int32_t>(s_region_list.size()) < cell_num; i++) {
+        const cv::Rect& tile = s_scan_tile_list[s_scan_index];
+        s_scan_index = (s_scan_index + 1) % s_scan_tile_list.size();
+        if (!IsCovered(tile, s_region_list)) {
+            s_region_list.push_back(tile);
+        }
+    }
+
+    return s_engine->ProcessRegion(mat, s_region_list, ROI_CELL_NUM_X, ROI_CELL_NUM_Y, det_result);
+}
+
 int32_t ImageProcessor::Initialize(const ImageProcessor::InputParam& input_param)
 {
     if (s_engine) {
@@ -78,12 +211,19 @@ int32_t ImageProcessor::Initialize(const ImageProcessor::InputParam& input_param
         return -1;
     }
 
+    s_frame_count = 0;
+    s_scan_index = 0;
     s_engine.reset(new DetectionEngine());
+    s_engine->SetTileParam(TILE_NUM_X, TILE_NUM_Y, TILE_OVERLAP_RATIO);
+    if (ROI_KEYFRAME_INTERVAL > 1) s_engine->SetBatchSize(ROI_BATCH_SIZE);
     if (s_engine->Initialize(input_param.work_dir, input_param.num_threads) != DetectionEngine::kRetOk) {
         s_engine->Finalize();
         s_engine.reset();
         return -1;
     }
+    if (DETECTION_TRACE_FILE[0] != '\0') {
+        s_trace_writer.Open(DETECTION_TRACE_FILE);
+    }
     return 0;
 }
 
@@ -94,6 +234,7 @@ int32_t ImageProcessor::Finalize(void)
         return -1;
     }
 
+    s_trace_writer.Close();
     if (s_engine->Finalize() != DetectionEngine::kRetOk) {
         return -1;
     }
@@ -119,20 +260,46 @@ int32_t ImageProcessor::Command(int32_t cmd)
 
 
 
-int32_t ImageProcessor::Process(cv::Mat& mat, ImageProcessor::Result& result)
+int32_t ImageProcessor::Process(cv::Mat& mat, ImageProcessor::Result& result, double timestamp)
 {
     if (!s_engine) {
         PRINT_E("Not initialized\n");
         return -1;
     }
 
-    DetectionEngine::Result det_result;
-    if (s_engine->Process(mat, det_result) != DetectionEngine::kRetOk) {
+    /* Engine and tracker reuse work buffers not to allocate heap memory every frame. (checked by alloc_check in common_helper/benchmark) */
+    DetectionEngine::Result& det_result = s_det_result;
+    if (RunDetection(mat, det_result) != DetectionEngine::kRetOk) {
         return -1;
     }
+    if (s_trace_writer.IsOpened()) {
+        s_trace_writer.Write(timestamp, det_result.crop.x, det_result.crop.y, det_result.crop.w, det_result.crop.h, det_result.bbox_list);
+    }
+    s_track_snapshot_list.clear();
+    s_track_history_list.clear();
+    {
+        std::lock_guard<std::mutex> lock(s_tracker_mutex);
+        s_tracker_manager.Update(STREAM_ID, det_result.bbox_list, timestamp);
+        for (const auto& track : s_tracker_manager.GetOrCreateTracker(STREAM_ID).GetTrackPool()) {
+            TrackSnapshot snapshot;
+            snapshot.bbox = track.GetLatestData().bbox;
+            snapshot.id = track.GetId();
+            snapshot.detected_count = track.GetDetectedCount();
+            snapshot.history_start = static_cast<int32_t>(s_track_history_list.size());
+            const auto& track_history = track.GetDataHistory();
+            for (size_t i = 0; i < track_history.size(); i++) {
+                s_track_history_list.push_back(cv::Point(track_history[i].bbox.x + track_history[i].bbox.w / 2, track_history[i].bbox.y + track_history[i].bbox.h));
+            }
+            snapshot.history_num = static_cast<int32_t>(track_history.size());
+            s_track_snapshot_list.push_back(snapshot);
+        }
+    }
 
     /* Display target area  */
     cv::rectangle(mat, cv::Rect(det_result.crop.x, det_result.crop.y, det_result.crop.w, det_result.crop.h), CommonHelper::CreateCvColor(0, 0, 0), 2);
+    for (const auto& region : s_region_list) {
+        cv::rectangle(mat, region, CommonHelper::CreateCvColor(128, 128, 128), 1);
+    }
 
     /* Display detection result (black rectangle) */
     int32_t num_det = 0;
@@ -142,22 +309,18 @@ int32_t ImageProcessor::Process(cv::Mat& mat, ImageProcessor::Result& result)
     }
 
     /* Display tracking result  */
-    s_tracker.Update(det_result.bbox_list);
     int32_t num_track = 0;
-    auto& track_list = s_tracker.GetTrackList();
-    for (auto& track : track_list) {
-        if (track.GetDetectedCount() < 2) continue;
-        const auto& bbox = track.GetLatestData().bbox;
+    for (const auto& snapshot : s_track_snapshot_list) {
+        if (snapshot.detected_count < 2) continue;
+        const auto& bbox = snapshot.bbox;
         /* Use white rectangle for the object which was not detected but just predicted */
-        cv::Scalar color = bbox.score == 0 ? CommonHelper::CreateCvColor(255, 255, 255) : GetColorForId(track.GetId());
+        cv::Scalar color = bbox.score == 0 ? CommonHelper::CreateCvColor(255, 255, 255) : GetColorForId(snapshot.id);
         cv::rectangle(mat, cv::Rect(bbox.x, bbox.y, bbox.w, bbox.h), color, 2);
-        CommonHelper::DrawText(mat, std::to_string(track.GetId()) + ": " + bbox.label, cv::Point(bbox.x, bbox.y), 0.35, 1, CommonHelper::CreateCvColor(0, 0, 0), CommonHelper::CreateCvColor(220, 220, 220));
+        CommonHelper::DrawText(mat, std::to_string(snapshot.id) + ": " + s_engine->GetLabel(bbox.class_id), cv::Point(bbox.x, bbox.y), 0.35, 1, CommonHelper::CreateCvColor(0, 0, 0), CommonHelper::CreateCvColor(220, 220, 220));
 
-        auto& track_history = track.GetDataHistory();
-        for (size_t i = 1; i < track_history.size(); i++) {
-            cv::Point p0(track_history[i].bbox.x + track_history[i].bbox.w / 2, track_history[i].bbox.y + track_history[i].bbox.h);
-            cv::Point p1(track_history[i - 1].bbox.x + track_history[i - 1].bbox.w / 2, track_history[i - 1].bbox.y + track_history[i - 1].bbox.h);
-            cv::line(mat, p0, p1, CommonHelper::CreateCvColor(255, 0, 0));
+        const cv::Point* track_history = s_track_history_list.data() + snapshot.history_start;
+        for (int32_t i = 1; i < snapshot.history_num; i++) {
+            cv::line(mat, track_history[i], track_history[i - 1], CommonHelper::CreateCvColor(255, 0, 0));
         }
         num_track++;
     }
@@ -167,10 +330,10 @@ int32_t ImageProcessor::Process(cv::Mat& mat, ImageProcessor::Result& result)
 
     /* Return the results */
     int32_t bbox_num = 0;
-    for (auto& track : track_list) {
-        const auto& bbox = track.GetLatestData().bbox;
+    for (const auto& snapshot : s_track_snapshot_list) {
+        const auto& bbox = snapshot.bbox;
         result.object_list[bbox_num].class_id = bbox.class_id;
-        snprintf(result.object_list[bbox_num].label, sizeof(result.object_list[bbox_num].label), "%s", bbox.label.c_str());
+        snprintf(result.object_list[bbox_num].label, sizeof(result.object_list[bbox_num].label), "%s", s_engine->GetLabel(bbox.class_id).c_str());
         result.object_list[bbox_num].score = bbox.score;
         result.object_list[bbox_num].x = bbox.x;
         result.object_list[bbox_num].y = bbox.y;
@@ -188,3 +351,53 @@ int32_t ImageProcessor::Process(cv::Mat& mat, ImageProcessor::Result& result)
     return 0;
 }
 
+
+int32_t ImageProcessor::Render(cv::Mat& mat, double timestamp, ImageProcessor::Result& result)
+{
+    if (!s_engine) {
+        PRINT_E("Not initialized\n");
+        return -1;
+    }
+
+    s_render_snapshot_list.clear();
+    {
+        /* Track is referred only here. Drawing is done without the lock not to block Process */
+        std::lock_guard<std::mutex> lock(s_tracker_mutex);
+        s_tracker_manager.GetOrCreateTracker(STREAM_ID).GetExtrapolatedBoundingBoxList(timestamp, s_render_bbox_list, s_render_track_list);
+        for (size_t i = 0; i < s_render_track_list.size(); i++) {
+            const Track& track = *s_render_track_list[i];
+            if (track.GetDetectedCount() < 2) continue;
+            TrackSnapshot snapshot;
+            snapshot.bbox = s_render_bbox_list[i];
+            snapshot.id = track.GetId();
+            snapshot.detected_count = track.GetDetectedCount();
+            snapshot.history_start = 0;
+            snapshot.history_num = 0;
+            s_render_snapshot_list.push_back(snapshot);
+        }
+    }
+
+    /* Display extrapolated tracking result */
+    int32_t bbox_num = 0;
+    for (const auto& snapshot : s_render_snapshot_list) {
+        const BoundingBox& bbox = snapshot.bbox;
+        cv::rectangle(mat, cv::Rect(bbox.x, bbox.y, bbox.w, bbox.h), GetColorForId(snapshot.id), 2);
+        CommonHelper::DrawText(mat, std::to_string(snapshot.id) + ": " + s_engine->GetLabel(bbox.class_id), cv::Point(bbox.x, bbox.y), 0.35, 1, CommonHelper::CreateCvColor(0, 0, 0), CommonHelper::CreateCvColor(220, 220, 220));
+
+        if (bbox_num >= NUM_MAX_RESULT) continue;
+        result.object_list[bbox_num].class_id = bbox.class_id;
+        snprintf(result.object_list[bbox_num].label, sizeof(result.object_list[bbox_num].label), "%s", s_engine->GetLabel(bbox.class_id).c_str());
+        result.object_list[bbox_num].score = bbox.score;
+        result.object_list[bbox_num].x = bbox.x;
+        result.object_list[bbox_num].y = bbox.y;
+        result.object_list[bbox_num].width = bbox.w;
+        result.object_list[bbox_num].height = bbox.h;
+        bbox_num++;
+    }
+    result.object_num = bbox_num;
+    result.time_pre_process = 0;
+    result.time_inference = 0;
+    result.time_post_process = 0;
+
+    return 0;
+}
@@ -53,7 +53,8 @@ typedef struct {
 } Result;
 
 int32_t Initialize(const InputParam& input_param);
-int32_t Process(cv::Mat& mat, Result& result);
+int32_t Process(cv::Mat& mat, Result& result, double timestamp = -1);  /* timestamp [sec] of mat. (negative: one frame interval has passed) */
+int32_t Render(cv::Mat& mat, double timestamp, Result& result);         /* draw tracks extrapolated to timestamp [sec] without inference */
 int32_t Finalize(void);
 int32_t Command(int32_t cmd);
 
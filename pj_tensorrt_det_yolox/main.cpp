@@ -19,6 +19,10 @@ limitations under the License.
 #include <string>
 #include <algorithm>
 #include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 /* for OpenCV */
 #include <opencv2/opencv.hpp>
@@ -32,7 +36,84 @@ limitations under the License.
 #define DEFAULT_INPUT_IMAGE           RESOURCE_DIR"/kite.jpg"
 #define LOOP_NUM_FOR_TIME_MEASUREMENT 10
 
+/* 1: Inference runs on another thread at its own rate, and tracks extrapolated to the capture time are drawn at capture rate */
+#define ASYNC_INFERENCE               0
+
 /*** Function ***/
+/* Frames are passed to the inference thread one by one. A frame not taken yet is overwritten by the newer one (skipped) */
+static int32_t RunAsyncInference(cv::VideoCapture& cap, const std::string& input_name, cv::VideoWriter& writer)
+{
+    std::mutex mutex;
+    std::condition_variable cond;
+    cv::Mat frame_for_inference;
+    double timestamp_for_inference = 0;
+    bool is_frame_ready = false;
+    bool is_stop = false;
+    std::atomic<int32_t> inference_cnt(0);
+
+    std::thread thread_inference([&]() {
+        cv::Mat frame;
+        double timestamp = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&]() { return is_frame_ready || is_stop; });
+                if (is_stop) break;
+                frame = frame_for_inference;
+                timestamp = timestamp_for_inference;
+                is_frame_ready = false;
+            }
+            ImageProcessor::Result result;
+            ImageProcessor::Process(frame, result, timestamp);
+            inference_cnt++;
+        }
+    });
+
+    /* Timestamp is the position in the source. A video file is played at its frame rate to keep it same as the wall clock */
+    const double fps = (cap.isOpened() && cap.get(cv::CAP_PROP_FPS) > 0) ? cap.get(cv::CAP_PROP_FPS) : 30.0;
+    const auto time_start = std::chrono::steady_clock::now();
+    int32_t frame_cnt = 0;
+    for (frame_cnt = 0; cap.isOpened() || frame_cnt < LOOP_NUM_FOR_TIME_MEASUREMENT; frame_cnt++) {
+        const double timestamp = frame_cnt / fps;
+        std::this_thread::sleep_until(time_start + std::chrono::microseconds(static_cast<int64_t>(timestamp * 1000000)));
+        cv::Mat image;
+        if (cap.isOpened()) {
+            cap.read(image);
+        } else {
+            image = cv::imread(input_name);
+        }
+        if (image.empty()) break;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            frame_for_inference = image.clone();    /* image is drawn by Render */
+            timestamp_for_inference = timestamp;
+            is_frame_ready = true;
+        }
+        cond.notify_one();
+
+        ImageProcessor::Result result;
+        ImageProcessor::Render(image, timestamp, result);
+
+        if (writer.isOpened()) writer.write(image);
+        cv::imshow("test", image);
+        if (cap.isOpened()) {
+            if (CommonHelper::InputKeyCommand(cap)) break;
+        };
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_stop = true;
+    }
+    cond.notify_one();
+    thread_inference.join();
+
+    const double time_all = (std::chrono::steady_clock::now() - time_start).count() / 1000000000.0;
+    printf("=== Display: %.1f [FPS], Inference: %.1f [FPS] ===\n", frame_cnt / time_all, inference_cnt / time_all);
+    return 0;
+}
+
 int32_t main(int argc, char* argv[])
 {
     /*** Initialize ***/
@@ -62,6 +143,13 @@ int32_t main(int argc, char* argv[])
         return -1;
     }
 
+    if (ASYNC_INFERENCE) {
+        RunAsyncInference(cap, input_name, writer);
+        ImageProcessor::Finalize();
+        if (writer.isOpened()) writer.release();
+        return 0;
+    }
+
     /*** Process for each frame ***/
     int32_t frame_cnt = 0;
     for (frame_cnt = 0; cap.isOpened() || frame_cnt < LOOP_NUM_FOR_TIME_MEASUREMENT; frame_cnt++) {
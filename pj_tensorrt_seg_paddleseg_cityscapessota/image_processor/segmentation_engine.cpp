@@ -89,6 +89,14 @@ int32_t SegmentationEngine::Initialize(const std::string& work_dir, const int32_
         return kRetErr;
     }
 
+    /* Allocate work buffer for pre-process and post-process in advance */
+    img_src_ = cv::Mat::zeros(input_tensor_info_list_[0].GetHeight(), input_tensor_info_list_[0].GetWidth(), CV_8UC3);
+    mat_separated_list_.resize(OUTPUT_CHANNEL);
+    for (auto& mat : mat_separated_list_) {
+        mat = cv::Mat::zeros(input_tensor_info_list_[0].GetHeight(), input_tensor_info_list_[0].GetWidth(), CV_32FC1);
+    }
+    mat_max_ = cv::Mat::zeros(input_tensor_info_list_[0].GetHeight(), input_tensor_info_list_[0].GetWidth(), CV_8UC1);
+
     return kRetOk;
 }
 
@@ -119,7 +127,7 @@ int32_t SegmentationEngine::Process(const cv::Mat& original_mat, Result& result)
     int32_t crop_y = 0;
     int32_t crop_w = original_mat.cols;
     int32_t crop_h = original_mat.rows;
-    cv::Mat img_src = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
+    cv::Mat& img_src = img_src_;   /* allocated in Initialize */
     CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeStretch);
 
     input_tensor_info.data = img_src.data;
@@ -150,13 +158,14 @@ int32_t SegmentationEngine::Process(const cv::Mat& original_mat, Result& result)
     /* Retrieve the result */
     const int32_t output_height = input_tensor_info.image_info.height;
     const int32_t output_width = input_tensor_info.image_info.width;
-    const std::vector<float> value_list(output_tensor_info_list_[0].GetDataAsFloat(), output_tensor_info_list_[0].GetDataAsFloat() + output_height * output_width * OUTPUT_CHANNEL);
+    const float* value_list = output_tensor_info_list_[0].GetDataAsFloat();   /* refer the tensor directly without copy */
     //printf("%f, %f, %f\n", value_list[0], value_list[100], value_list[400]);
 
     /* Scores for all the classes */
-    std::vector<cv::Mat> mat_separated_list(OUTPUT_CHANNEL);
+    /* Work buffers are allocated in Initialize (create does nothing when the size is the same). All pixels are overwritten, so no need to clear */
+    std::vector<cv::Mat>& mat_separated_list = mat_separated_list_;
     for (int32_t c = 0; c < OUTPUT_CHANNEL; c++) {
-        mat_separated_list[c] = cv::Mat::zeros(output_height, output_width, CV_32FC1);
+        mat_separated_list[c].create(output_height, output_width, CV_32FC1);
     }
  #pragma omp parallel for
     for (int32_t y = 0; y < output_height; y++) {
@@ -164,8 +173,8 @@ int32_t SegmentationEngine::Process(const cv::Mat& original_mat, Result& result)
 #if 0
             /* Use Score [0.0, 1.0] */
             size_t offset = (size_t)y * output_width * OUTPUT_CHANNEL + (size_t)x * OUTPUT_CHANNEL;
-            std::vector<float> score_list(OUTPUT_CHANNEL, 0);
-            CommonHelper::SoftMaxFast(value_list.data() + offset, score_list.data(), OUTPUT_CHANNEL);
+            float score_list[OUTPUT_CHANNEL];
+            CommonHelper::SoftMaxFast(value_list + offset, score_list, OUTPUT_CHANNEL);
             for (int32_t c = 0; c < OUTPUT_CHANNEL; c++) {
                 mat_separated_list[c].at<float>(cv::Point(x, y)) = score_list[c];
             }
@@ -182,11 +191,12 @@ int32_t SegmentationEngine::Process(const cv::Mat& original_mat, Result& result)
 
     /* Argmax */
     /* ref: https://github.com/PaddlePaddle/PaddleSeg/blob/release/2.3/paddleseg/core/infer.py#L244 */
-    cv::Mat mat_max = cv::Mat::zeros(output_height, output_width, CV_8UC1);
+    cv::Mat& mat_max = mat_max_;
+    mat_max.create(output_height, output_width, CV_8UC1);
 #pragma omp parallel for
     for (int32_t y = 0; y < output_height; y++) {
         for (int32_t x = 0; x < output_width; x++) {
-            const auto& current_iter = value_list.begin() + y * output_width * OUTPUT_CHANNEL + x * OUTPUT_CHANNEL;
+            const auto& current_iter = value_list + y * output_width * OUTPUT_CHANNEL + x * OUTPUT_CHANNEL;
             const auto& max_iter = std::max_element(current_iter, current_iter + OUTPUT_CHANNEL);
             float max_score = *max_iter;
             auto max_c = std::distance(current_iter, max_iter);
@@ -37,6 +37,7 @@ public:
         kRetErr = -1,
     };
 
+    /* Mats of the result share the work buffers of the engine and are overwritten by the next Process. Clone them to keep them */
     typedef struct Result_ {
         std::vector<cv::Mat> mat_out_list;      // [height, width, 1]. value is 0 - 1.0 (float)
         cv::Mat           mat_out_max;          // [height, width, 1]. value is 0 - 18  (uint8_t)
@@ -59,6 +60,9 @@ private:
     std::unique_ptr<InferenceHelper> inference_helper_;
     std::vector<InputTensorInfo> input_tensor_info_list_;
     std::vector<OutputTensorInfo> output_tensor_info_list_;
+    cv::Mat img_src_;                           /* work buffer for pre-process */
+    std::vector<cv::Mat> mat_separated_list_;   /* work buffer for post-process */
+    cv::Mat mat_max_;
 };
 
 #endif
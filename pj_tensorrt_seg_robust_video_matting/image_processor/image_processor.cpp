@@ -136,33 +136,29 @@ int32_t ImageProcessor::Process(cv::Mat& mat, Result& result)
     cv::Mat mat_fgr = segmentation_result.mat_fgr;
     cv::Mat mat_pha = segmentation_result.mat_pha;
 #if 0
-    mat_fgr.convertTo(mat_fgr, CV_8UC3, 255);
-    mat_pha.convertTo(mat_pha, CV_8UC1, 255);
     cv::imshow("mat_fgr", mat_fgr);
     cv::imshow("mat_pha", mat_pha);
     cv::waitKey(1);
 #else
     /*** Create result image ***/
     /* binalization */
-    //cv::threshold(mat_pha, mat_pha, 0.5, 1.0, cv::THRESH_BINARY);
+    //cv::threshold(mat_pha, mat_pha, 127, 255, cv::THRESH_BINARY);
 
     /* Select masking area (just to show a nice demo) */
     UpdateMaskArea();
-    cv::rectangle(mat_pha, cv::Rect(static_cast<int32_t>(s_mask_area_border_x_ratio * mat_pha.cols), 0, static_cast<int32_t>((1.0f - s_mask_area_border_x_ratio) * mat_pha.cols), mat_pha.rows), cv::Vec<float, 1>(1.0f), -1);
+    cv::rectangle(mat_pha, cv::Rect(static_cast<int32_t>(s_mask_area_border_x_ratio * mat_pha.cols), 0, static_cast<int32_t>((1.0f - s_mask_area_border_x_ratio) * mat_pha.cols), mat_pha.rows), cv::Scalar(255), -1);
 
-    /* Extact masked area */
+    /* Extact masked area (composited in uint8. alpha is 0 - 255) */
     cv::Mat mat_composit;
     cv::resize(mat_pha, mat_pha, mat.size());
     mat_pha = CommonHelper::CombineMat1to3(mat_pha, mat_pha, mat_pha);  /* 1 channel to 3 channel for masking */
-    mat.convertTo(mat_composit, CV_32FC3);
-    cv::multiply(mat_composit, mat_pha, mat_composit);
-    mat_composit.convertTo(mat_composit, CV_8UC3);
+    cv::multiply(mat, mat_pha, mat_composit, 1.0 / 255);
 
     /* draw background */
-    static const cv::Mat kMatOnes = cv::Mat(mat_pha.size(), CV_32FC3, { 1.0f, 1.0f, 1.0f });
-    cv::multiply(kMatOnes - mat_pha, s_bg_color, mat_pha);
-    mat_pha.convertTo(mat_pha, CV_8UC3);
-    mat_composit = mat_composit + mat_pha;
+    cv::Mat mat_bg(mat.size(), CV_8UC3, s_bg_color);
+    cv::bitwise_not(mat_pha, mat_pha);      /* 255 - alpha */
+    cv::multiply(mat_bg, mat_pha, mat_bg, 1.0 / 255);
+    mat_composit = mat_composit + mat_bg;
 
     cv::hconcat(mat, mat_composit, mat);
 #endif
@@ -31,6 +31,7 @@ limitations under the License.
 /* for My modules */
 #include "common_helper.h"
 #include "common_helper_cv.h"
+#include "host_tensor.h"
 #include "inference_helper.h"
 #include "segmentation_engine.h"
 
@@ -78,8 +79,36 @@ limitations under the License.
 #endif
 #endif
 
+/* Type of input / output tensors on host memory. fp16 halves the traffic (1088x1920: 25 MB to 12.5 MB for each direction) */
+/* Input is converted to NCHW blob in this class for fp16 / uint8 (uint8 input is the same as pixel value: scale = 1/255, zero_point = 0) */
+#define HOST_TENSOR_TYPE  CommonHelper::kHostTensorTypeFp32
+//#undef TENSORTYPE
+//#define TENSORTYPE  TensorInfo::kTensorTypeFp16       /* the inference helper needs to support fp16 tensor */
+//#define HOST_TENSOR_TYPE  CommonHelper::kHostTensorTypeFp16
+
 
 /*** Function ***/
+/* Output tensor as it is on host memory. fp16 / uint8 tensor is not converted to float as a whole (GetDataAsFloat does) */
+static CommonHelper::HostTensorView GetOutputView(const OutputTensorInfo& output_tensor_info)
+{
+    return CommonHelper::HostTensorView(output_tensor_info.data, HOST_TENSOR_TYPE, output_tensor_info.quant.scale, output_tensor_info.quant.zero_point);
+}
+
+/* Copy the output tensor (0.0 - 1.0) to uint8 Mat (0 - 255) row by row. Only one row is converted to float at a time (fp16 / uint8 tensor is not widened as a whole) */
+static void CopyToUint8Mat(const CommonHelper::HostTensorView& view, int32_t rows, int32_t cols, int32_t type, std::vector<float>& row_work, cv::Mat& mat)
+{
+    mat.create(rows, cols, type);
+    const int32_t channel = mat.channels();
+    const int32_t row_num = cols * channel;
+    if (static_cast<int32_t>(row_work.size()) < row_num) row_work.resize(row_num);
+    for (int32_t y = 0; y < rows; y++) {
+        const float* src = view.Read(y * row_num, row_num, row_work.data());
+        const cv::Mat mat_src_row(1, cols, CV_MAKETYPE(CV_32F, channel), const_cast<float*>(src));
+        cv::Mat mat_dst_row = mat.row(y);
+        mat_src_row.convertTo(mat_dst_row, CV_8U, 255);
+    }
+}
+
 int32_t SegmentationEngine::Initialize(const std::string& work_dir, const int32_t num_threads)
 {
     /* Set model information */
@@ -143,6 +172,12 @@ int32_t SegmentationEngine::Initialize(const std::string& work_dir, const int32_
         return kRetErr;
     }
 
+    /* Allocate work buffer for pre-process in advance */
+    img_src_ = cv::Mat::zeros(input_tensor_info_list_[0].GetHeight(), input_tensor_info_list_[0].GetWidth(), CV_8UC3);
+    if (HOST_TENSOR_TYPE != CommonHelper::kHostTensorTypeFp32) {
+        input_blob_.resize(3 * input_tensor_info_list_[0].GetHeight() * input_tensor_info_list_[0].GetWidth() * CommonHelper::GetHostTensorElementSize(HOST_TENSOR_TYPE));
+    }
+
     return kRetOk;
 }
 
@@ -173,20 +208,31 @@ int32_t SegmentationEngine::Process(const cv::Mat& original_mat, Result& result)
     int32_t crop_y = 0;
     int32_t crop_w = original_mat.cols;
     int32_t crop_h = original_mat.rows;
-    cv::Mat img_src = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
-    CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeStretch);
+    if (HOST_TENSOR_TYPE != CommonHelper::kHostTensorTypeFp32 && IS_NCHW) {
+        /* Resize, color conversion and normalization are done here in one pass to write the blob of HOST_TENSOR_TYPE */
+        if (!CommonHelper::CropResizeNormalizeNchw(original_mat, input_blob_.data(), HOST_TENSOR_TYPE, resize_plan_, input_tensor_info.GetWidth(), input_tensor_info.GetHeight(),
+            crop_x, crop_y, crop_w, crop_h, input_tensor_info.normalize.mean, input_tensor_info.normalize.norm, IS_RGB, CommonHelper::kCropTypeStretch)) {
+            PRINT_E("Input image must be 3-channel uint8\n");
+            return kRetErr;
+        }
+        input_tensor_info.data = input_blob_.data();
+        input_tensor_info.data_type = InputTensorInfo::kDataTypeBlobNchw;
+    } else {
+        cv::Mat& img_src = img_src_;   /* allocated in Initialize */
+        CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeStretch);
 
-    input_tensor_info.data = img_src.data;
-    input_tensor_info.data_type = InputTensorInfo::kDataTypeImage;
-    input_tensor_info.image_info.width = img_src.cols;
-    input_tensor_info.image_info.height = img_src.rows;
-    input_tensor_info.image_info.channel = img_src.channels();
-    input_tensor_info.image_info.crop_x = 0;
-    input_tensor_info.image_info.crop_y = 0;
-    input_tensor_info.image_info.crop_width = img_src.cols;
-    input_tensor_info.image_info.crop_height = img_src.rows;
-    input_tensor_info.image_info.is_bgr = false;
-    input_tensor_info.image_info.swap_color = false;
+        input_tensor_info.data = img_src.data;
+        input_tensor_info.data_type = InputTensorInfo::kDataTypeImage;
+        input_tensor_info.image_info.width = img_src.cols;
+        input_tensor_info.image_info.height = img_src.rows;
+        input_tensor_info.image_info.channel = img_src.channels();
+        input_tensor_info.image_info.crop_x = 0;
+        input_tensor_info.image_info.crop_y = 0;
+        input_tensor_info.image_info.crop_width = img_src.cols;
+        input_tensor_info.image_info.crop_height = img_src.rows;
+        input_tensor_info.image_info.is_bgr = false;
+        input_tensor_info.image_info.swap_color = false;
+    }
     if (inference_helper_->PreProcess(input_tensor_info_list_) != InferenceHelper::kRetOk) {
         return kRetErr;
     }
@@ -202,19 +248,20 @@ int32_t SegmentationEngine::Process(const cv::Mat& original_mat, Result& result)
     /*** PostProcess ***/
     const auto& t_post_process0 = std::chrono::steady_clock::now();
     /* Retrieve the result */
-    const int32_t output_height = input_tensor_info.image_info.height;
-    const int32_t output_width = input_tensor_info.image_info.width;
+    const int32_t output_height = input_tensor_info.GetHeight();
+    const int32_t output_width = input_tensor_info.GetWidth();
     //std::vector<float> fgr_list(output_tensor_info_list_[0].GetDataAsFloat(), output_tensor_info_list_[0].GetDataAsFloat() + output_height * output_width * 3);
     //std::vector<float> pha_list(output_tensor_info_list_[1].GetDataAsFloat(), output_tensor_info_list_[1].GetDataAsFloat() + output_height * output_width * 1);
     //printf("FGR: [%f, %f], %f, %f, %f\n", *std::min_element(fgr_list.begin(), fgr_list.end()), *std::max_element(fgr_list.begin(), fgr_list.end()), fgr_list[0], fgr_list[100], fgr_list[400]);
     //printf("PHA: [%f, %f], %f, %f, %f\n", *std::min_element(pha_list.begin(), pha_list.end()), *std::max_element(pha_list.begin(), pha_list.end()), pha_list[0], pha_list[100], pha_list[400]);
-    cv::Mat mat_fgr = cv::Mat(output_height, output_width, CV_32FC3, output_tensor_info_list_[0].GetDataAsFloat()).clone();  // need to clone because the data itself is on tensor and will be deleted
-    cv::Mat mat_pha = cv::Mat(output_height, output_width, CV_32FC1, output_tensor_info_list_[1].GetDataAsFloat()).clone();
+    /* need to copy because the data itself is on tensor and will be deleted. Copy to member buffers to avoid allocation every frame */
+    CopyToUint8Mat(GetOutputView(output_tensor_info_list_[0]), output_height, output_width, CV_8UC3, row_work_, mat_fgr_);
+    CopyToUint8Mat(GetOutputView(output_tensor_info_list_[1]), output_height, output_width, CV_8UC1, row_work_, mat_pha_);
     const auto& t_post_process1 = std::chrono::steady_clock::now();
 
     /* Return the results */
-    result.mat_fgr = mat_fgr;
-    result.mat_pha = mat_pha;
+    result.mat_fgr = mat_fgr_;
+    result.mat_pha = mat_pha_;
     result.time_pre_process = static_cast<std::chrono::duration<double>>(t_pre_process1 - t_pre_process0).count() * 1000.0;
     result.time_inference = static_cast<std::chrono::duration<double>>(t_inference1 - t_inference0).count() * 1000.0;
     result.time_post_process = static_cast<std::chrono::duration<double>>(t_post_process1 - t_post_process0).count() * 1000.0;;
@@ -28,6 +28,7 @@ limitations under the License.
 
 /* for My modules */
 #include "inference_helper.h"
+#include "image_preprocess.h"
 
 
 class SegmentationEngine {
@@ -37,9 +38,10 @@ public:
         kRetErr = -1,
     };
 
+    /* mat_fgr and mat_pha are views of the work buffers of the engine, valid until the next Process. Clone them to keep them longer */
     typedef struct Result_ {
-        cv::Mat           mat_fgr;             // [height, width, 3], float (0.0 - 1.0)
-        cv::Mat           mat_pha;             // [height, width, 1], float (0.0 - 1.0)
+        cv::Mat           mat_fgr;             // [height, width, 3], uint8 (0 - 255)
+        cv::Mat           mat_pha;             // [height, width, 1], uint8 (0 - 255)
         double            time_pre_process;		// [msec]
         double            time_inference;		// [msec]
         double            time_post_process;	// [msec]
@@ -59,6 +61,12 @@ private:
     std::unique_ptr<InferenceHelper> inference_helper_;
     std::vector<InputTensorInfo> input_tensor_info_list_;
     std::vector<OutputTensorInfo> output_tensor_info_list_;
+    cv::Mat img_src_;                           /* work buffer for pre-process */
+    std::vector<uint8_t> input_blob_;           /* work buffer for pre-process (NCHW blob in HOST_TENSOR_TYPE. used if not fp32) */
+    CommonHelper::ResizePlan resize_plan_;
+    cv::Mat mat_fgr_;                           /* work buffer for post-process */
+    cv::Mat mat_pha_;
+    std::vector<float> row_work_;               /* work buffer for post-process (one row of the output tensor as float) */
 };
 
 #endif